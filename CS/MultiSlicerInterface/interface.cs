@@ -176,6 +176,16 @@ namespace MultiSlicerInterface {
         public int ntool;
     }
 
+    [StructLayout(LayoutKind.Sequential)]
+    public unsafe struct FlatOutputSliceInfo {
+        public void* flatpaths;
+        public int numpaths;
+        public long* offsetsArray;
+        public long* coordsArray;
+        public double z;
+        public int ntool;
+    }
+
     [StructLayout(LayoutKind.Sequential)]
     public unsafe struct InputSliceInfo {
         public void* slice;
@@ -305,6 +315,14 @@ namespace MultiSlicerInterface {
         public unsafe delegate void freeResultDelegate(void* result);
         public freeResultDelegate freeResult;
 
+        [UnmanagedFunctionPointer(CallingConvention.Cdecl), SuppressUnmanagedCodeSecurity]
+        public unsafe delegate FlatOutputSliceInfo getFlatOutputSliceInfoDelegate(void* result, int ntool, int pathtype);
+        public getFlatOutputSliceInfoDelegate getFlatOutputSliceInfo;
+
+        [UnmanagedFunctionPointer(CallingConvention.Cdecl), SuppressUnmanagedCodeSecurity]
+        public unsafe delegate void freeFlatPathsDelegate(void* flatpaths);
+        public freeFlatPathsDelegate freeFlatPaths;
+
         [UnmanagedFunctionPointer(CallingConvention.Cdecl), SuppressUnmanagedCodeSecurity]
         public unsafe delegate Slices3DSpecInfo computeSlicesZsDelegate(void* state, double zmin, double zmax);
         public computeSlicesZsDelegate computeSlicesZs;
@@ -401,6 +419,8 @@ namespace MultiSlicerInterface {
                     alsoComplementary                 = (alsoComplementaryDelegate)                Marshal.GetDelegateForFunctionPointer(GetProcAddress(DllPointer, "alsoComplementary"),                 typeof(alsoComplementaryDelegate));
                     getOutputSliceInfo                = (getOutputSliceInfoDelegate)               Marshal.GetDelegateForFunctionPointer(GetProcAddress(DllPointer, "getOutputSliceInfo"),                typeof(getOutputSliceInfoDelegate));
                     freeResult                        = (freeResultDelegate)                       Marshal.GetDelegateForFunctionPointer(GetProcAddress(DllPointer, "freeResult"),                        typeof(freeResultDelegate));
+                    getFlatOutputSliceInfo            = (getFlatOutputSliceInfoDelegate)           Marshal.GetDelegateForFunctionPointer(GetProcAddress(DllPointer, "getFlatOutputSliceInfo"),            typeof(getFlatOutputSliceInfoDelegate));
+                    freeFlatPaths                     = (freeFlatPathsDelegate)                    Marshal.GetDelegateForFunctionPointer(GetProcAddress(DllPointer, "freeFlatPaths"),                     typeof(freeFlatPathsDelegate));
                     computeSlicesZs                   = (computeSlicesZsDelegate)                  Marshal.GetDelegateForFunctionPointer(GetProcAddress(DllPointer, "computeSlicesZs"),                   typeof(computeSlicesZsDelegate));
                     receiveAdditionalAdditiveContours = (receiveAdditionalAdditiveContoursDelegate)Marshal.GetDelegateForFunctionPointer(GetProcAddress(DllPointer, "receiveAdditionalAdditiveContours"), typeof(receiveAdditionalAdditiveContoursDelegate));
                     receiveInputSlice                 = (receiveInputSliceDelegate)                Marshal.GetDelegateForFunctionPointer(GetProcAddress(DllPointer, "receiveInputSlice"),                 typeof(receiveInputSliceDelegate));
@@ -692,6 +712,11 @@ namespace MultiSlicerInterface {
             return dll.getOutputSliceInfo(obj, idx, (int)pathtype);
         }
 
+        //the caller has to release the result with dll.freeFlatPaths(info.flatpaths)
+        public unsafe FlatOutputSliceInfo readFlatOutputSlice(void* obj, int idx, MultiCfg.PathType pathtype) {
+            return dll.getFlatOutputSliceInfo(obj, idx, (int)pathtype);
+        }
+
         public unsafe void* computeSlice2D(void* slice) {
             void* result = null;
             try {
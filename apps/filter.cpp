@@ -12,37 +12,23 @@ std::string filterMatchesFromFile(const char * filename, const char *outputname,
     FileHeader fileheader;
     std::string err = fileheader.readFromFile(i.f);    if (!err.empty()) { return str("Error reading file header for ", filename, ": ", err); }
 
-    int64 inputNumRecords  = fileheader.numRecords;
-    int64 outputNumRecords = 0;
-    
-    std::string e = fileheader.writeToFile(o.f, true); if (!e.empty())   { return str("error writing file ", outputname, ": ", e); }
-    
-    SliceHeader sliceheader;
-    std::vector<T64> data;
-    
-    for (int currentRecord = 0; currentRecord < inputNumRecords; ++currentRecord) {
-        err = seekNextMatchingPathsFromFile(i.f, fileheader, currentRecord, spec, sliceheader);
-        if (!err.empty()) { return str("Error reading file ", filename, ": ", err); }
-        if (currentRecord >= inputNumRecords) break;
-
-        e = sliceheader.writeToFile(o.f);
-        if (!e.empty())                                                    { return str("error trying to write ", currentRecord, "-th slice header of ", filename, " in ", outputname, ": ", e); }
-        
-        int64 sizeT64 = (sliceheader.totalSize - sliceheader.headerSize) / sizeof(T64);
-        data.resize(sizeT64);
-        
-        if (fread (&(data.front()), sizeof(int64), sizeT64, i.f) != sizeT64) { return str("error trying to read ",  currentRecord, "-th slice payload in ", filename); }
-        if (fwrite(&(data.front()), sizeof(int64), sizeT64, o.f) != sizeT64) { return str("error trying to write ", currentRecord, "-th slice payload of ", filename, " in ", outputname); }
-        ++outputNumRecords;
+    //the index is either read from the end of the file or built seeking over the payloads
+    RecordIndex index;
+    err = index.load(i.f, fileheader);                 if (!err.empty()) { return str("Error reading file ", filename, ": ", err); }
+
+    std::vector<size_t> selected;
+    for (size_t k = 0; k < index.entries.size(); ++k) {
+        if (matchesEntry(spec, index.entries[k])) selected.push_back(k);
     }
+
+    fileheader.numRecords = (int64)selected.size();
+    std::string e = fileheader.writeToFile(o.f, true); if (!e.empty())   { return str("error writing file ", outputname, ": ", e); }
+
+    e = copyRecords(i.f, o.f, index, selected);        if (!e.empty())   { return str("error copying records from ", filename, " to ", outputname, ": ", e); }
     i.close();
-    
-    int numToSkip = fileheader.numRecordsOffset();
-    if (fseek(o.f, numToSkip, SEEK_SET) != 0)                                { return str( "fseek failed: could not write numRecords to file ", filename); }
-    if (fwrite(&outputNumRecords, sizeof(outputNumRecords), 1, o.f) != 1)    { return str("fwrite failed: could not write numRecords to file ", filename); }
     o.close();
 
-    if (outputNumRecords == 0) {
+    if (selected.empty()) {
         return str("could not match any results to the specification for file ", filename);
     }
 
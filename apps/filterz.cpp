@@ -5,7 +5,7 @@
 
 typedef std::pair<std::function<bool(double, double)>, double> Operand;
 
-std::string filterMatchesFromFile(const char * filename, const char *outputname, std::vector<Operand> ops) {
+std::string filterMatchesFromFile(const char * filename, const char *outputname, std::vector<Operand> ops, PathInFileSpec spec) {
     FILEOwner i(filename, "rb");
     if (!i.isopen()) { return str("Could not open file ", filename); }
 
@@ -15,46 +15,32 @@ std::string filterMatchesFromFile(const char * filename, const char *outputname,
     FileHeader fileheader;
     std::string err = fileheader.readFromFile(i.f);    if (!err.empty()) { return str("Error reading file header for ", filename, ": ", err); }
 
-    int64 inputNumRecords  = fileheader.numRecords;
-    int64 outputNumRecords = 0;
-    
-    std::string e = fileheader.writeToFile(o.f, true); if (!e.empty())   { return str("error writing file ", outputname, ": ", e); }
-    
-    SliceHeader sliceheader;
-    std::vector<T64> data;
-    
-    for (int currentRecord = 0; currentRecord < inputNumRecords; ++currentRecord) {
-        err = sliceheader.readFromFile(i.f);
-        if (!err.empty()) { return str("Error reading ", currentRecord, "-th slice header: ", err); }
-        if (sliceheader.alldata.size() < 7) { return str("Error reading ", currentRecord, "-th slice header: header is too short!"); }
-        bool seeked = false;
+    //the index is either read from the end of the file or built seeking over the payloads
+    RecordIndex index;
+    err = index.load(i.f, fileheader);                 if (!err.empty()) { return str("Error reading file ", filename, ": ", err); }
+
+    std::vector<size_t> selected;
+    for (size_t k = 0; k < index.entries.size(); ++k) {
+        RecordIndexEntry &entry = index.entries[k];
+        if (!matchesEntry(spec, entry)) continue;
+        bool matches = true;
         for (auto &op : ops) {
-            if (!op.first(sliceheader.z, op.second)) {
-                if (fseek(i.f, (long)(sliceheader.totalSize - sliceheader.headerSize), SEEK_CUR)!=0) { return str("Error reading ", currentRecord, "-th slice header: could not skip the payload!"); }
-                seeked = true;
+            if (!op.first(entry.z, op.second)) {
+                matches = false;
                 break;
             }
         }
-        if (seeked) continue;
-
-        e = sliceheader.writeToFile(o.f);
-        if (!e.empty())                                                    { return str("error trying to write ", currentRecord, "-th slice header of ", filename, " in ", outputname, ": ", e); }
-        
-        int64 sizeT64 = (sliceheader.totalSize - sliceheader.headerSize) / sizeof(T64);
-        data.resize(sizeT64);
-        
-        if (fread (&(data.front()), sizeof(int64), sizeT64, i.f) != sizeT64) { return str("error trying to read ",  currentRecord, "-th slice payload in ", filename); }
-        if (fwrite(&(data.front()), sizeof(int64), sizeT64, o.f) != sizeT64) { return str("error trying to write ", currentRecord, "-th slice payload of ", filename, " in ", outputname); }
-        ++outputNumRecords;
+        if (matches) selected.push_back(k);
     }
+
+    fileheader.numRecords = (int64)selected.size();
+    std::string e = fileheader.writeToFile(o.f, true); if (!e.empty())   { return str("error writing file ", outputname, ": ", e); }
+
+    e = copyRecords(i.f, o.f, index, selected);        if (!e.empty())   { return str("error copying records from ", filename, " to ", outputname, ": ", e); }
     i.close();
-    
-    int numToSkip = fileheader.numRecordsOffset();
-    if (fseek(o.f, numToSkip, SEEK_SET) != 0)                                { return str( "fseek failed: could not write numRecords to file ", filename); }
-    if (fwrite(&outputNumRecords, sizeof(outputNumRecords), 1, o.f) != 1)    { return str("fwrite failed: could not write numRecords to file ", filename); }
     o.close();
 
-    if (outputNumRecords == 0) {
+    if (selected.empty()) {
         return str("could not match any results to the specification for file ", filename);
     }
 
@@ -62,11 +48,12 @@ std::string filterMatchesFromFile(const char * filename, const char *outputname,
 }
 
 const char *ERR =
-"\nArguments: PATHSFILENAME_INPUT PATHSFILENAME_OUTPUT [OPERAND VALUE]+\n\n"
+"\nArguments: PATHSFILENAME_INPUT PATHSFILENAME_OUTPUT [OPERAND VALUE]+ [SPECTYPE VALUE]*\n\n"
 "    -PATHSFILENAME_INPUT and PATHSFILENAME_OUTPUT are required (input/output paths file names).\n\n"
 "    -OPERAND must be one of the following: > < >= <= == !=\n\n"
 "    -VALUE is a floating point value.\n\n"
-"This tool filters the contents of PATHSFILENAME_INPUT, writing in PATHSFILENAME_OUTPUT only the contents that have Z values matching the specifications Z OPERAND VALUE, for all pairs OPERAND VALUE.\n\n";
+"    -SPECTYPE can be either 'type' or 'ntool', with the same values as in the filter tool. They can be interleaved with the pairs OPERAND VALUE.\n\n"
+"This tool filters the contents of PATHSFILENAME_INPUT, writing in PATHSFILENAME_OUTPUT only the contents that have Z values matching the specifications Z OPERAND VALUE, for all pairs OPERAND VALUE (and also the pairs SPECTYPE VALUE, if specified).\n\n";
 
 void printError(ParamReader &rd) {
     rd.fmt << ERR;
@@ -91,9 +78,19 @@ int main(int argc, const char** argv) {
     if (!rd.readParam(pathsfilename_output,   "PATHSFILENAME_OUTPUT"))          { printError(rd); return -1; }
     
     std::vector<Operand> ops;
+    PathInFileSpec spec;
 
     while (true) {
         if (!rd.readParam(operand, "OPERAND")) break;
+        if ((strcmp(operand, "type") == 0) || (strcmp(operand, "ntool") == 0)) {
+            --rd.argidx;
+            std::string err = spec.readFromCommandLine(rd, 1, true);
+            if (!err.empty()) {
+                fprintf(stderr, "Error reading the specification: %s\n", err.c_str());
+                return -1;
+            }
+            continue;
+        }
         if (!rd.readParam(value,   "VALUE"))   { printError(rd); return -1; }
         
         Operand op;
@@ -122,7 +119,7 @@ int main(int argc, const char** argv) {
         return -1;
     }
 
-    std::string err = filterMatchesFromFile(pathsfilename_input, pathsfilename_output, std::move(ops));
+    std::string err = filterMatchesFromFile(pathsfilename_input, pathsfilename_output, std::move(ops), spec);
 
     if (!err.empty()) {
         fprintf(stderr, "Error while trying to get a set of paths according to the specification: %s", err.c_str());
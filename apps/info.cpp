@@ -1,9 +1,154 @@
 #include "pathsfile.hpp"
 #include "simpleparsing.hpp"
 #include "apputil.hpp"
+#include "parallel.hpp"
 #include <limits>
+#include <map>
 
-std::string printPathInfo(const char * filename, int verbose) {
+void printRecordSummary(int currentRecord, int64 type, int64 ntool, double z) {
+    fprintf(stdout, "Record %d: ", currentRecord);
+    switch (type) {
+    case PATHTYPE_RAW_CONTOUR:        fprintf(stdout, "type=raw (from mesh file),        z=%.20g\n", z); break;
+    case PATHTYPE_PROCESSED_CONTOUR:  fprintf(stdout, "type=contour,            ntool=%lld, z=%.20g\n", ntool, z); break;
+    case PATHTYPE_TOOLPATH_PERIMETER: fprintf(stdout, "type=perimeter toolpath, ntool=%lld, z=%.20g\n", ntool, z); break;
+    case PATHTYPE_TOOLPATH_SURFACE:   fprintf(stdout, "type=surface   toolpath, ntool=%lld, z=%.20g\n", ntool, z); break;
+    case PATHTYPE_TOOLPATH_INFILLING: fprintf(stdout, "type=infilling toolpath, ntool=%lld, z=%.20g\n", ntool, z); break;
+    default:                          fprintf(stdout, "type=%lld (unknown),        ntool=%lld, z=%.20g\n", type, ntool, z);
+    }
+}
+
+//statistics for all the records with the same type and ntool
+typedef struct RecordStats {
+    int64 numRecords, numPaths, numPoints;
+    double minz, maxz, minx, maxx, miny, maxy;
+    RecordStats() : numRecords(0), numPaths(0), numPoints(0),
+        minz( std::numeric_limits<double>::infinity()), maxz(-std::numeric_limits<double>::infinity()),
+        minx( std::numeric_limits<double>::infinity()), maxx(-std::numeric_limits<double>::infinity()),
+        miny( std::numeric_limits<double>::infinity()), maxy(-std::numeric_limits<double>::infinity()) {}
+    void merge(const RecordStats &s) {
+        numRecords += s.numRecords; numPaths += s.numPaths; numPoints += s.numPoints;
+        minz = fmin(minz, s.minz); maxz = fmax(maxz, s.maxz);
+        minx = fmin(minx, s.minx); maxx = fmax(maxx, s.maxx);
+        miny = fmin(miny, s.miny); maxy = fmax(maxy, s.maxy);
+    }
+} RecordStats;
+
+typedef std::map<std::pair<int64, int64>, RecordStats> StatsByTypeAndTool;
+
+/*the payload is parsed in place, without building the paths: the number of paths, then
+for each path the number of points followed by its coordinates (2 or 3 values per point)*/
+std::string addRecordStats(std::vector<T64> &record, RecordStats &stats) {
+    size_t headerWords = (size_t)(record[1].i / sizeof(T64));
+    int64  saveFormat  = record[5].i;
+    double scaling     = record[6].d;
+    size_t dims        = saveFormat == PATHFORMAT_DOUBLE_3D ? 3 : 2;
+    if ((saveFormat != PATHFORMAT_INT64) && (saveFormat != PATHFORMAT_DOUBLE) && (saveFormat != PATHFORMAT_DOUBLE_3D)) {
+        return str("unknown save format type: ", saveFormat);
+    }
+    size_t pos = headerWords, size = record.size();
+    if (pos >= size) return std::string("the payload is empty");
+    int64 numpaths = record[pos++].i;
+    double minx = stats.minx, maxx = stats.maxx, miny = stats.miny, maxy = stats.maxy;
+    for (int64 p = 0; p < numpaths; ++p) {
+        if (pos >= size) return std::string("the payload is truncated");
+        int64 numpoints = record[pos++].i;
+        if ((numpoints < 0) || ((size - pos) / dims < (size_t)numpoints)) return std::string("the payload is truncated");
+        T64 *point = &record[pos], *end = point + numpoints*dims;
+        if (saveFormat == PATHFORMAT_INT64) {
+            for (; point != end; point += dims) {
+                double x = point[0].i * scaling, y = point[1].i * scaling;
+                minx = fmin(minx, x); maxx = fmax(maxx, x);
+                miny = fmin(miny, y); maxy = fmax(maxy, y);
+            }
+        } else {
+            for (; point != end; point += dims) {
+                minx = fmin(minx, point[0].d); maxx = fmax(maxx, point[0].d);
+                miny = fmin(miny, point[1].d); maxy = fmax(maxy, point[1].d);
+            }
+        }
+        pos += numpoints*dims;
+        stats.numPoints += numpoints;
+    }
+    stats.minx = minx; stats.maxx = maxx; stats.miny = miny; stats.maxy = maxy;
+    stats.numPaths += numpaths;
+    stats.numRecords++;
+    stats.minz = fmin(stats.minz, record[4].d);
+    stats.maxz = fmax(stats.maxz, record[4].d);
+    return std::string();
+}
+
+/*the records are split in contiguous chunks, and each chunk is read sequentially by a
+thread with its own FILE*. The statistics of the chunks are merged at the end*/
+std::string printPathStats(const char * filename, RecordIndex &index, int numthreads) {
+    size_t numrecords = index.entries.size();
+    numthreads        = getNumThreads(numthreads, numrecords);
+    size_t numchunks  = std::min(numrecords, (size_t)numthreads * 4);
+    std::vector<FILEOwner> files(numthreads);
+    for (auto &file : files) {
+        if (!file.open(filename, "rb")) { return str("Could not open input file ", filename); }
+    }
+    std::vector<StatsByTypeAndTool> chunkstats(numchunks);
+    std::vector<std::string> errs(numchunks);
+    parallelFor(numchunks, numthreads, [&](size_t chunk, int numthread) {
+        FILE *f = files[numthread].f;
+        std::vector<T64> record;
+        size_t first = chunk * numrecords / numchunks, last = (chunk + 1) * numrecords / numchunks;
+        for (size_t k = first; k < last; ++k) {
+            RecordIndexEntry &e = index.entries[k];
+            record.resize((size_t)(e.totalSize / sizeof(T64)));
+            if ((record.size() < SliceHeader::numFields) || (fseek64(f, e.offset, SEEK_SET) != 0) || (fread(&record.front(), sizeof(T64), record.size(), f) != record.size())) {
+                errs[chunk] = str("Error reading ", k, "-th record");
+                return;
+            }
+            std::string err = addRecordStats(record, chunkstats[chunk][std::make_pair(e.type, e.ntool)]);
+            if (!err.empty()) {
+                errs[chunk] = str("Error reading ", k, "-th record: ", err);
+                return;
+            }
+        }
+    });
+    for (auto &err : errs) if (!err.empty()) return err;
+
+    StatsByTypeAndTool stats;
+    RecordStats total;
+    for (auto &chunk : chunkstats) {
+        for (auto &s : chunk) {
+            stats[s.first].merge(s.second);
+            total.merge(s.second);
+        }
+    }
+
+    fprintf(stdout, "Number of Records: " FMTSIZET "\n", numrecords);
+    for (auto &s : stats) {
+        int64 type = s.first.first, ntool = s.first.second;
+        switch (type) {
+        case PATHTYPE_RAW_CONTOUR:        fprintf(stdout, "type=raw (from mesh file):\n"); break;
+        case PATHTYPE_PROCESSED_CONTOUR:  fprintf(stdout, "type=contour,            ntool=%lld:\n", ntool); break;
+        case PATHTYPE_TOOLPATH_PERIMETER: fprintf(stdout, "type=perimeter toolpath, ntool=%lld:\n", ntool); break;
+        case PATHTYPE_TOOLPATH_SURFACE:   fprintf(stdout, "type=surface   toolpath, ntool=%lld:\n", ntool); break;
+        case PATHTYPE_TOOLPATH_INFILLING: fprintf(stdout, "type=infilling toolpath, ntool=%lld:\n", ntool); break;
+        default:                          fprintf(stdout, "type=%lld (unknown),        ntool=%lld:\n", type, ntool);
+        }
+        fprintf(stdout, "    number of records: %lld\n", s.second.numRecords);
+        fprintf(stdout, "   number of elements: %lld\n", s.second.numPaths);
+        fprintf(stdout, "     number of points: %lld\n", s.second.numPoints);
+        fprintf(stdout, "                    Z: min=%.20g, max=%.20g\n", s.second.minz, s.second.maxz);
+        fprintf(stdout, "                    X: min=%.20g, max=%.20g\n", s.second.minx, s.second.maxx);
+        fprintf(stdout, "                    Y: min=%.20g, max=%.20g\n", s.second.miny, s.second.maxy);
+    }
+    if (numrecords > 0) {
+        fprintf(stdout, "all records:\n");
+        fprintf(stdout, "   number of elements: %lld\n", total.numPaths);
+        fprintf(stdout, "     number of points: %lld\n", total.numPoints);
+        fprintf(stdout, "                    Z: min=%.20g, max=%.20g\n", total.minz, total.maxz);
+        fprintf(stdout, "                    X: min=%.20g, max=%.20g\n", total.minx, total.maxx);
+        fprintf(stdout, "                    Y: min=%.20g, max=%.20g\n", total.miny, total.maxy);
+    }
+    return std::string();
+}
+
+//verbose<0 means statistics mode
+std::string printPathInfo(const char * filename, int verbose, int numthreads) {
     FILEOwner i(filename, "rb");
     if (!i.isopen()) { return str("Could not open input file ", filename); }
     IOPaths iop_f(i.f);
@@ -41,6 +186,19 @@ std::string printPathInfo(const char * filename, int verbose) {
     if (verbose>0) {
         fprintf(stdout, "Number of Records: %lld\n", fileheader.numRecords);
         fprintf(stdout, "\n\n");
+    } else {
+        //the slice headers are enough, so use the record index (or build it seeking over the payloads)
+        RecordIndex index;
+        err = index.load(i.f, fileheader);
+        if (!err.empty()) { return str("Error reading ", filename, ": ", err); }
+        i.close();
+        if (verbose < 0) {
+            return printPathStats(filename, index, numthreads);
+        }
+        for (size_t k = 0; k < index.entries.size(); ++k) {
+            printRecordSummary((int)k, index.entries[k].type, index.entries[k].ntool, index.entries[k].z);
+        }
+        return std::string();
     }
 
     SliceHeader sliceheader;
@@ -50,135 +208,121 @@ std::string printPathInfo(const char * filename, int verbose) {
         const int usual = 7;
         if (sliceheader.alldata.size() < usual) { return str("Error reading ", currentRecord, "-th slice header: header is too short!"); }
 
-        if (verbose>0) {
-            fprintf(stdout, "Record %d\n", currentRecord);
-            switch (sliceheader.type) {
-            case PATHTYPE_RAW_CONTOUR:        fprintf(stdout, "                  type: raw slice (sliced from mesh file)\n"); break;
-            case PATHTYPE_PROCESSED_CONTOUR:  fprintf(stdout, "                  type: contours for tool %lld\n", sliceheader.ntool); break;
-            case PATHTYPE_TOOLPATH_PERIMETER: fprintf(stdout, "                  type: perimeter toolpaths for tool %lld\n", sliceheader.ntool); break;
-            case PATHTYPE_TOOLPATH_SURFACE:   fprintf(stdout, "                  type: surface   toolpaths for tool %lld\n", sliceheader.ntool); break;
-            case PATHTYPE_TOOLPATH_INFILLING: fprintf(stdout, "                  type: infilling toolpaths for tool %lld\n", sliceheader.ntool); break;
-            default:                          fprintf(stdout, "                  type: unknown (%lld) for tool %lld\n", sliceheader.type, sliceheader.ntool);
-            }
-            fprintf(stdout, "                  z: %.20g\n", sliceheader.z);
-            switch (sliceheader.saveFormat) {
-            case PATHFORMAT_INT64:     fprintf(stdout, "     coordinate format: 64-bit integers\n"); break;
-            case PATHFORMAT_DOUBLE:    fprintf(stdout, "     coordinate format: double floating point\n"); break;
-            case PATHFORMAT_DOUBLE_3D: fprintf(stdout, "     coordinate format: double floating point (3D paths)\n"); break;
-            default:                   fprintf(stdout, "     coordinate format: unknown (%lld)\n", sliceheader.saveFormat);
-            }
-            fprintf(stdout, "      %s scaling: %.20g\n", sliceheader.saveFormat == PATHFORMAT_INT64 ? "original" : "        ", sliceheader.scaling);
-            
-            if (sliceheader.alldata.size() > usual) {
-                for (int k = usual; k < sliceheader.alldata.size(); ++k) {
-                    fprintf(stdout, "      additional %d-th value:\n", k-usual);
-                    fprintf(stdout, "            as  int64: %lld\n", sliceheader.alldata[k].i);
-                    fprintf(stdout, "            as double: %g\n", sliceheader.alldata[k].d);
-                }
-            }
-        } else {
-            fprintf(stdout, "Record %d: ", currentRecord);
-            switch (sliceheader.type) {
-            case PATHTYPE_RAW_CONTOUR:        fprintf(stdout, "type=raw (from mesh file),        z=%.20g\n", sliceheader.z); break;
-            case PATHTYPE_PROCESSED_CONTOUR:  fprintf(stdout, "type=contour,            ntool=%lld, z=%.20g\n", sliceheader.ntool, sliceheader.z); break;
-            case PATHTYPE_TOOLPATH_PERIMETER: fprintf(stdout, "type=perimeter toolpath, ntool=%lld, z=%.20g\n", sliceheader.ntool, sliceheader.z); break;
-            case PATHTYPE_TOOLPATH_SURFACE:   fprintf(stdout, "type=surface   toolpath, ntool=%lld, z=%.20g\n", sliceheader.ntool, sliceheader.z); break;
-            case PATHTYPE_TOOLPATH_INFILLING: fprintf(stdout, "type=infilling toolpath, ntool=%lld, z=%.20g\n", sliceheader.ntool, sliceheader.z); break;
-            default:                          fprintf(stdout, "type=%lld (unknown),        ntool=%lld, z=%.20g\n", sliceheader.type, sliceheader.ntool, sliceheader.z);
+        fprintf(stdout, "Record %d\n", currentRecord);
+        switch (sliceheader.type) {
+        case PATHTYPE_RAW_CONTOUR:        fprintf(stdout, "                  type: raw slice (sliced from mesh file)\n"); break;
+        case PATHTYPE_PROCESSED_CONTOUR:  fprintf(stdout, "                  type: contours for tool %lld\n", sliceheader.ntool); break;
+        case PATHTYPE_TOOLPATH_PERIMETER: fprintf(stdout, "                  type: perimeter toolpaths for tool %lld\n", sliceheader.ntool); break;
+        case PATHTYPE_TOOLPATH_SURFACE:   fprintf(stdout, "                  type: surface   toolpaths for tool %lld\n", sliceheader.ntool); break;
+        case PATHTYPE_TOOLPATH_INFILLING: fprintf(stdout, "                  type: infilling toolpaths for tool %lld\n", sliceheader.ntool); break;
+        default:                          fprintf(stdout, "                  type: unknown (%lld) for tool %lld\n", sliceheader.type, sliceheader.ntool);
+        }
+        fprintf(stdout, "                  z: %.20g\n", sliceheader.z);
+        switch (sliceheader.saveFormat) {
+        case PATHFORMAT_INT64:     fprintf(stdout, "     coordinate format: 64-bit integers\n"); break;
+        case PATHFORMAT_DOUBLE:    fprintf(stdout, "     coordinate format: double floating point\n"); break;
+        case PATHFORMAT_DOUBLE_3D: fprintf(stdout, "     coordinate format: double floating point (3D paths)\n"); break;
+        default:                   fprintf(stdout, "     coordinate format: unknown (%lld)\n", sliceheader.saveFormat);
+        }
+        fprintf(stdout, "      %s scaling: %.20g\n", sliceheader.saveFormat == PATHFORMAT_INT64 ? "original" : "        ", sliceheader.scaling);
+        
+        if (sliceheader.alldata.size() > usual) {
+            for (int k = usual; k < sliceheader.alldata.size(); ++k) {
+                fprintf(stdout, "      additional %d-th value:\n", k-usual);
+                fprintf(stdout, "            as  int64: %lld\n", sliceheader.alldata[k].i);
+                fprintf(stdout, "            as double: %g\n", sliceheader.alldata[k].d);
             }
         }
 
-        if (verbose>0) {
-            int numpaths;
-            if (sliceheader.saveFormat == PATHFORMAT_INT64) {
-                clp::Paths paths;
-                if (!iop_f.readClipperPaths(paths)) {
-                    return str("Error reading ", currentRecord, "-th integer clipperpaths: could not read record ", currentRecord, " data!");
-                }
-                numpaths = (int)paths.size();
-                BBox bb = getBB(paths);
-                fprintf(stdout, "          bounding box:\n");
-                fprintf(stdout, "       X: min=%.20g, max=%.20g\n", bb.minx*sliceheader.scaling, bb.maxx*sliceheader.scaling);
-                fprintf(stdout, "       Y: min=%.20g, max=%.20g\n", bb.miny*sliceheader.scaling, bb.maxy*sliceheader.scaling);
-                if (verbose > 1) {
-                    int ipath = 0;
-                    for (auto &path : paths) {
-                        fprintf(stdout, "          path %d/%lld:\n", ipath, paths.size());
-                        int ipoint = 0;
-                        for (auto &point : path) {
-                            fprintf(stdout, "            point %d/%lld:\n", ipoint, path.size());
-                            fprintf(stdout, "              X: %lld\n", point.X);
-                            fprintf(stdout, "              Y: %lld\n", point.Y);
-                            ++ipoint;
-                        }
-                        ++ipath;
+        int numpaths;
+        if (sliceheader.saveFormat == PATHFORMAT_INT64) {
+            clp::Paths paths;
+            if (!iop_f.readClipperPaths(paths)) {
+                return str("Error reading ", currentRecord, "-th integer clipperpaths: could not read record ", currentRecord, " data!");
+            }
+            numpaths = (int)paths.size();
+            BBox bb = getBB(paths);
+            fprintf(stdout, "          bounding box:\n");
+            fprintf(stdout, "       X: min=%.20g, max=%.20g\n", bb.minx*sliceheader.scaling, bb.maxx*sliceheader.scaling);
+            fprintf(stdout, "       Y: min=%.20g, max=%.20g\n", bb.miny*sliceheader.scaling, bb.maxy*sliceheader.scaling);
+            if (verbose > 1) {
+                int ipath = 0;
+                for (auto &path : paths) {
+                    fprintf(stdout, "          path %d/" FMTSIZET ":\n", ipath, paths.size());
+                    int ipoint = 0;
+                    for (auto &point : path) {
+                        fprintf(stdout, "            point %d/" FMTSIZET ":\n", ipoint, path.size());
+                        fprintf(stdout, "              X: %lld\n", point.X);
+                        fprintf(stdout, "              Y: %lld\n", point.Y);
+                        ++ipoint;
                     }
+                    ++ipath;
                 }
-            } else if (sliceheader.saveFormat == PATHFORMAT_DOUBLE) {
-                DPaths paths;
-                if (!iop_f.readDoublePaths(paths)) {
-                    return str("Error reading ", currentRecord, "-th double clipperpaths: could not read record ", currentRecord, " data!");
+            }
+        } else if (sliceheader.saveFormat == PATHFORMAT_DOUBLE) {
+            DPaths paths;
+            if (!iop_f.readDoublePaths(paths)) {
+                return str("Error reading ", currentRecord, "-th double clipperpaths: could not read record ", currentRecord, " data!");
+            }
+            numpaths = (int)paths.size();
+            double minx =  std::numeric_limits<double>::infinity();
+            double maxx = -std::numeric_limits<double>::infinity();
+            double miny =  std::numeric_limits<double>::infinity();
+            double maxy = -std::numeric_limits<double>::infinity();
+            for (auto &path : paths) {
+                for (auto &point : path) {
+                    minx = fmin(minx, point.X);
+                    maxx = fmax(maxx, point.X);
+                    miny = fmin(miny, point.Y);
+                    maxy = fmax(maxy, point.Y);
                 }
-                numpaths = (int)paths.size();
-                double minx =  std::numeric_limits<double>::infinity();
-                double maxx = -std::numeric_limits<double>::infinity();
-                double miny =  std::numeric_limits<double>::infinity();
-                double maxy = -std::numeric_limits<double>::infinity();
+            }
+            fprintf(stdout, "          bounding box:\n");
+            fprintf(stdout, "       X: min=%.20g, max=%.20g\n", minx, maxx);
+            fprintf(stdout, "       Y: min=%.20g, max=%.20g\n", miny, maxy);
+            if (verbose > 1) {
+                int ipath = 0;
                 for (auto &path : paths) {
+                    fprintf(stdout, "          path %d/" FMTSIZET ":\n", ipath, paths.size());
+                    int ipoint = 0;
                     for (auto &point : path) {
-                        minx = fmin(minx, point.X);
-                        maxx = fmax(maxx, point.X);
-                        miny = fmin(miny, point.Y);
-                        maxy = fmax(maxy, point.Y);
+                        fprintf(stdout, "            point %d/" FMTSIZET ":\n", ipoint, path.size());
+                        fprintf(stdout, "              X: %.20g\n", point.X);
+                        fprintf(stdout, "              Y: %.20g\n", point.Y);
+                        ++ipoint;
                     }
+                    ++ipath;
                 }
-                fprintf(stdout, "          bounding box:\n");
-                fprintf(stdout, "       X: min=%.20g, max=%.20g\n", minx, maxx);
-                fprintf(stdout, "       Y: min=%.20g, max=%.20g\n", miny, maxy);
-                if (verbose > 1) {
-                    int ipath = 0;
-                    for (auto &path : paths) {
-                        fprintf(stdout, "          path %d/%lld:\n", ipath, paths.size());
-                        int ipoint = 0;
-                        for (auto &point : path) {
-                            fprintf(stdout, "            point %d/%lld:\n", ipoint, path.size());
-                            fprintf(stdout, "              X: %.20g\n", point.X);
-                            fprintf(stdout, "              Y: %.20g\n", point.Y);
-                            ++ipoint;
-                        }
-                        ++ipath;
-                    }
-                }
-            } else if (sliceheader.saveFormat == PATHFORMAT_DOUBLE_3D) {
-                Paths3D paths;
-                if (!read3DPaths(iop_f, paths)) {
-                    return str("Error reading ", currentRecord, "-th 3d clipperpaths: could not read record ", currentRecord, " data!");
-                }
-                numpaths = (int)paths.size();
             }
-            int payload   = (int)((sliceheader.totalSize - sliceheader.headerSize) / sizeof(int64));
-            int numpoints = (payload - numpaths - 1) / (sliceheader.saveFormat == PATHFORMAT_DOUBLE_3D ? 3 : 2);
-            fprintf(stdout, "    number of elements: %d\n", numpaths);
-            fprintf(stdout, "      number of points: %d\n", numpoints);
-            /*
-            fprintf(stdout, "   total size in bytes: %d\n", sliceheader.totalSize);
-            fprintf(stdout, "  header size in bytes: %d\n", sliceheader.headerSize);
-            fprintf(stdout, " payload size in bytes: %d\n", sliceheader.totalSize - sliceheader.headerSize);
-            fprintf(stdout, "    \"  in 8-byte words: %d\n", (sliceheader.totalSize - sliceheader.headerSize) / sizeof(int64));
-            */
-            fprintf(stdout, "\n\n");
-        } else {
-            fseek(i.f, (long)(sliceheader.totalSize - sliceheader.headerSize), SEEK_CUR);
+        } else if (sliceheader.saveFormat == PATHFORMAT_DOUBLE_3D) {
+            Paths3D paths;
+            if (!read3DPaths(iop_f, paths)) {
+                return str("Error reading ", currentRecord, "-th 3d clipperpaths: could not read record ", currentRecord, " data!");
+            }
+            numpaths = (int)paths.size();
         }
+        int payload   = (int)((sliceheader.totalSize - sliceheader.headerSize) / sizeof(int64));
+        int numpoints = (payload - numpaths - 1) / (sliceheader.saveFormat == PATHFORMAT_DOUBLE_3D ? 3 : 2);
+        fprintf(stdout, "    number of elements: %d\n", numpaths);
+        fprintf(stdout, "      number of points: %d\n", numpoints);
+        /*
+        fprintf(stdout, "   total size in bytes: %d\n", sliceheader.totalSize);
+        fprintf(stdout, "  header size in bytes: %d\n", sliceheader.headerSize);
+        fprintf(stdout, " payload size in bytes: %d\n", sliceheader.totalSize - sliceheader.headerSize);
+        fprintf(stdout, "    \"  in 8-byte words: %d\n", (sliceheader.totalSize - sliceheader.headerSize) / sizeof(int64));
+        */
+        fprintf(stdout, "\n\n");
     }
 
     return std::string();
 }
 
 const char *ERR =
-"\nArguments: PATHSFILENAME_INPUT [verbose]\n\n"
+"\nArguments: PATHSFILENAME_INPUT [verbose | s [NUMTHREADS]]\n\n"
 "    -PATHSFILENAME_INPUT is the paths file name.\n\n"
-"    -'v' or 'vv' if more information is to be printed ('v' for summary, 'vv' for full output).\n\n";
+"    -'v' or 'vv' if more information is to be printed ('v' for summary, 'vv' for full output).\n\n"
+"    -'s' to print statistics (number of records, elements and points, Z ranges and bounding boxes) for each combination of type and tool. They are computed in NUMTHREADS threads (default: as many as hardware threads).\n\n"
+"If neither 'v' nor 'vv' are specified, only the slice headers are read (or the record index, if the file has one).\n\n";
 
 void printError(ParamReader &rd) {
     rd.fmt << ERR;
@@ -198,19 +342,22 @@ int main(int argc, const char** argv) {
 
     if (!rd.readParam(pathsfilename_input, "PATHSFILENAME_INPUT"))           { printError(rd); return -1; }
     
-    int verbose = 0;
+    int verbose = 0, numthreads = 0;
     if (rd.readParam(verbose_input, "VERBOSE_INPUT")) {
         if (strcmp(verbose_input, "v") == 0) {
             verbose = 1;
         } else if (strcmp(verbose_input, "vv") == 0) {
             verbose = 2;
+        } else if (strcmp(verbose_input, "s") == 0) {
+            verbose = -1;
+            if ((rd.argidx < rd.argc) && !rd.readParam(numthreads, "NUMTHREADS")) { printError(rd); return -1; }
         } else {
-            fprintf(stderr, "if present, last argument must be either 'v' or 'vv', but it was <%s>\n", verbose_input);
+            fprintf(stderr, "if present, last argument must be either 'v', 'vv' or 's', but it was <%s>\n", verbose_input);
             return -1;
         }
     }
 
-    std::string err = printPathInfo(pathsfilename_input, verbose);
+    std::string err = printPathInfo(pathsfilename_input, verbose, numthreads);
 
     if (!err.empty()) {
         fprintf(stderr, "Error while trying to show info: %s", err.c_str());
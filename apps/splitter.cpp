@@ -25,45 +25,62 @@ bool getPaths(const char *pathsfilename, int currentRecord, SliceHeader &slicehe
     return true;
 }
 
-std::string firstPass(const char *pathsfilename, std::shared_ptr<FileHeader> &fileheader, int &numRecords, double &scaling, BBox &bb) {
+/*computes the scaling and the bounding box of the paths in the file. If the file has a record index with bounding boxes
+(it is written by PathsFileWriter), it is enough to read the index. Otherwise, the records without bounding boxes are read*/
+std::string getExtent(const char *pathsfilename, std::shared_ptr<FileHeader> &fileheader, double &scaling, BBox &bb) {
     FILEOwner i(pathsfilename, "rb");
     if (!i.isopen()) { return str("Could not open file ", pathsfilename); }
 
     std::string err = fileheader->readFromFile(i.f);
     if (!err.empty()) { return str("Error reading file header for ", pathsfilename, ": ", err); }
 
+    int numRecords = (int)fileheader->numRecords;
+    if (numRecords <= 0) { return str("Nothing was done: the file has ", numRecords, "records!"); }
+
+    RecordIndex index;
+    err = index.load(i.f, *fileheader);
+    if (!err.empty()) { return str("Error reading file ", pathsfilename, ": ", err); }
+
     SliceHeader sliceheader;
     IOPaths iop(i.f);
     clp::Paths output;
-    numRecords = (int)fileheader->numRecords;
 
     bool firstTime = true;
 
-    if (numRecords <= 0) { return str("Nothing was done: the file has ", numRecords, "records!"); }
-
     for (int currentRecord = 0; currentRecord < numRecords; ++currentRecord) {
-        std::string err = sliceheader.readFromFile(i.f);
-        if (!err.empty()) { return str("Error reading ", currentRecord, "-th slice header: ", err); }
+        RecordIndexEntry &entry = index.entries[currentRecord];
 
-        if (!getPaths(pathsfilename, currentRecord, sliceheader, iop, output, err)) {
-            break;
+        if (currentRecord == 0) {
+            scaling = entry.scaling;
+        } else if (std::abs((scaling - entry.scaling) / scaling) > 1e-3) {
+            return str("Error: the records inside file ", pathsfilename, ", have different scales: ", scaling, ", for record ", currentRecord - 1, ", ", entry.scaling, " for record ", currentRecord);
+        }
+
+        BBox recordbb;
+        if (entry.hasBB) {
+            recordbb = entry.bb;
+        } else {
+            if (fseek64(i.f, entry.offset, SEEK_SET) != 0) { return str("Error: could not seek to the ", currentRecord, "-th record"); }
+            err = sliceheader.readFromFile(i.f);
+            if (!err.empty()) { return str("Error reading ", currentRecord, "-th slice header: ", err); }
+            if (!getPaths(pathsfilename, currentRecord, sliceheader, iop, output, err)) { return err; }
+            recordbb = output.empty() ? BBox(1, 0, 1, 0) : getBB(output);
+            output.clear();
         }
 
+        //records without points do not contribute to the bounding box
+        if (recordbb.minx > recordbb.maxx) continue;
+
         if (firstTime) {
-            scaling = sliceheader.scaling;
+            bb = recordbb;
             firstTime = false;
-            bb = getBB(output);
         } else {
-            if (std::abs((scaling - sliceheader.scaling) / scaling) > 1e-3) {
-                return str("Error: the records inside file ", pathsfilename, ", have different scales: ", scaling, ", for record ", currentRecord - 1, ", ", sliceheader.scaling, " for record ", currentRecord);
-            }
-            BBox second = getBB(output);
-            bb.merge(second);
+            bb.merge(recordbb);
         }
-
-        output.clear();
     }
 
+    if (firstTime) { return str("Nothing was done: the records in file ", pathsfilename, " have no points!"); }
+
     return std::string();
 }
 
@@ -85,11 +102,13 @@ std::string processFile(const char *pathsfilename, SplittingPathWriter &writer)
         if (!err.empty()) { return str("Error reading ", currentRecord, "-th slice header: ", err); }
 
         if (!getPaths(pathsfilename, currentRecord, sliceheader, iop, output, err)) {
-            break;
+            return err;
         }
 
         bool isClosed = !((sliceheader.type == PATHTYPE_TOOLPATH_SURFACE) || (sliceheader.type == PATHTYPE_TOOLPATH_PERIMETER) || (sliceheader.type == PATHTYPE_TOOLPATH_INFILLING));
-        writer.writePaths(output, (int)sliceheader.type, 0, (int)sliceheader.ntool, sliceheader.z, sliceheader.scaling, isClosed);
+        if (!writer.writePaths(output, (int)sliceheader.type, 0, (int)sliceheader.ntool, sliceheader.z, sliceheader.scaling, isClosed)) {
+            return str("Error splitting ", currentRecord, "-th record: ", writer.err);
+        }
 
         output.clear();
     }
@@ -138,13 +157,14 @@ void createCubesFromGrid(const char *cubeNameTemplate, PathSplitterConfigs &save
 
 const char *ERR =
 "\nThis tool has two operation modes: in the operation mode SPLIT, it divides contours and toolpaths into a grid of squares, storing the contents of each square in a different output file. In the operation mode CUBES, it takes a bounding box and generates cubes (written as OFF files) that represent the grid as specified in the SPLIT mode.\n\n"
-"Arguments: (cubes MINX MAXX MINY MAXY MINZ MAXZ| split PATHFILENAME) OUTPUTNAMEPATTERN DISPLACEMENT MARGIN [ORIGIN_X ORIGIN_Y]\n\n"
+"Arguments: (cubes MINX MAXX MINY MAXY MINZ MAXZ| split PATHFILENAME) OUTPUTNAMEPATTERN DISPLACEMENT MARGIN [ORIGIN_X ORIGIN_Y] [threads NUMTHREADS]\n\n"
 "    -First argument: mode, either 'cubes' or 'split'.\n\n"
 "    -MINX MAXX MINY MAXY MINZ MAXZ: if the mode is 'cubes', these arguments define the bounding box\n\n"
 "    -PATHFILENAME: if the mode is 'split', this is the name of the *.paths input file\n\n"
 "    -OUTPUTNAMEPATTERN: the root of the name (minus the extension) of the output files\n\n"
 "    -DISPLACEMENT and MARGIN: the input paths will be divided in squares of size DISPLACEMENT+MARGIN. The squares will overlap by MARGIN.\n\n"
 "    -ORIGIN_X and ORIGIN_Y: if specified, they represent the center of coordinates of the grid of squares. If not specified, the squares will be adapted to the bounding box of the paths, and may be smaller than DISPLACEMENT+MARGIN.\n\n"
+"    -NUMTHREADS: in the mode 'split', the number of threads used to clip the paths to the squares (default: as many as hardware threads).\n\n"
 "All metric parameters are in the units of the original mesh from which the paths were sliced (usually, millimeters).\n\n";
 
 
@@ -186,10 +206,15 @@ int main(int argc, const char** argv) {
     if (!rd.readParam(outputPattern, "pattern for output files (without the suffix .paths)")) { printError(rd); return -1; }
     if (!rd.readParam(displacement,  "DISPLACEMENT (in mesh file units)"))                    { printError(rd); return -1; }
     if (!rd.readParam(margin, "MARGIN (in mesh file units)"))                                 { printError(rd); return -1; }
-    use_origin = rd.readParam(origin_x, "ORIGIN_X (in mesh file units)");
+    use_origin = (rd.argidx < rd.argc) && (strcmp(rd.argv[rd.argidx], "threads") != 0) && rd.readParam(origin_x, "ORIGIN_X (in mesh file units)");
     if (use_origin) {
         if (!rd.readParam(origin_y, "ORIGIN_Y (in mesh file units)")) { printError(rd); printf(" (If ORIGIN_X is present, ORIGIN_Y must also be present)\n"); return -1; }
     }
+    int numthreads = 0;
+    if ((rd.argidx < rd.argc) && (strcmp(rd.argv[rd.argidx], "threads") == 0)) {
+        ++rd.argidx;
+        if (!rd.readParam(numthreads, "NUMTHREADS"))                                          { printError(rd); return -1; }
+    }
 
     PathSplitterConfigs conf(1);
     conf[0].wallAngle      = 90; //no need to set conf[0].zmin
@@ -204,11 +229,11 @@ int main(int argc, const char** argv) {
         tm.measureTime();
         
         std::shared_ptr<FileHeader> header = std::make_shared<FileHeader>();
-        int numtools, numrecords;
+        int numtools;
         double scaling;
         BBox bb;
 
-        std::string err = firstPass(pathsfilename, header, numrecords, scaling, bb);
+        std::string err = getExtent(pathsfilename, header, scaling, bb);
         if (!err.empty()) { fprintf(stderr, err.c_str()); return -1; }
 
         conf[0].displacement.X = conf[0].displacement.Y = (clp::cInt)(displacement / scaling);
@@ -230,9 +255,12 @@ int main(int argc, const char** argv) {
             return std::make_shared<PathsFileWriter>(resume, fname+suffix, (FILE*)NULL, header, PATHFORMAT_INT64);
         };
         SplittingPathWriter writer(false, clipres, numtools, callback, std::move(conf), outputPattern, generic_type, generic_ntool, generic_z);
+        if (!writer.err.empty()) { fprintf(stderr, "%s\n", writer.err.c_str()); return -1; }
+        writer.setNumThreads(numthreads);
 
         err = processFile(pathsfilename, writer);
         if (!err.empty()) { fprintf(stderr, err.c_str()); return -1; }
+        if (!writer.close()) { fprintf(stderr, "%s\n", writer.err.c_str()); return -1; }
         
         tm.measureTime();
         tm.printLastMeasurement(stdout, "TOTAL TIME: CPU %f, WALL TIME %f\n");
@@ -6,7 +6,13 @@
 #include "pathwriter_dxf.hpp"
 #include "pathwriter_nanoscribe.hpp"
 #include "apputil.hpp"
+#include "daemon.hpp"
+#include "parallel.hpp"
 #include <iostream>
+#include <set>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
 
 //if macro STANDALONE_USEPYTHON is defined, SHOWCONTOUR support is baked in
 #ifdef STANDALONE_USEPYTHON
@@ -120,6 +126,8 @@ typedef struct MainSpec {
     int perProcOptsIdx;
     MainSpec();
     void slurpAllOptions(int argc, const char ** argv);
+    void overrideOptions(std::vector<po::parsed_options> &jobOpts);
+    void removeOption(int idx, const char *name);
     void usage();
     inline po::variables_map getMap(int idx) {
         po::variables_map map;
@@ -166,6 +174,9 @@ MainSpec::MainSpec() {
         ("save-format",
             po::value<std::string>()->default_value("integer"),
             "Format of coordinates in the save file, either 'integer' or 'double'. The default is 'integer'")
+        ("async-write",
+            po::value<int>()->value_name("QUEUE_SIZE"),
+            "if specified, output files (*.paths, DXF, GWL) are written in background threads, so the computation is not stalled by slow filesystems. Up to QUEUE_SIZE sets of paths can be waiting to be written to each file (if the queue is full, the computation waits). Write errors are reported with a delay")
         ("checkpoint-save",
             po::value<std::vector<std::string>>()->multitoken(),
             "This option takes two arguments: FILENAME NUM_ITERATION. If specified, just before reading raw slice NUM_ITERATION, application state is dumped to FILENAME, and the program exits. The computation can be restarted later with --checkpoint-load. This option is primarily intended for debugging. While it may be used for actual checkpointing, it will be cumbersome to use, very low performance, and more crucially it does not detect if an error ocurred mid-computation. Also, very limited support is provided for saving the results (*.paths files will be correctly resumed, but DXF and GWL files will be overwritten when restarting the computation with --checkpoint-load). Finally, output with --save-in-grid will have a different ordering, because each element in the grid has a diferent state for motion planning, and these states are not saved in the checkpoint")
@@ -182,9 +193,15 @@ MainSpec::MainSpec() {
 #endif
         ("dry-run",
             "if this option is specified, the system only shows information about the slices. First, it displays the Z values of the slices to be received from the input mesh file (raw slices). This is useful for crafting feedback pathsfiles to be used with the --feedback option. Then, if --slicing-scheduler was specified, it displays the ordered sequence of slices to be computed, exactly in the same format as the arguments of --slicing-manual (pairs NTool and Z), so this can be used as input for this option. Finally, the application terminates without doing anything else.")
+        ("estimate-cost",
+            po::value<int>()->value_name("samples_per_tool"),
+            "if this option is specified, the system behaves as with --dry-run, but it also computes the specified number of sample slices for each process (plus the slices of lower-resolution processes they depend on), and uses them to estimate the computing time and the peak memory used by the computed slices for the whole schedule. Only for --slicing-scheduler, --slicing-manual or --slicing-adaptive.")
         ("just-save-raw",
             po::value<std::string>()->value_name("filename"),
             "if this option is specified, the system does not compute anything, it only asks for the raw slices and stores them in a pathsfile with the specified filename.")
+        ("daemon",
+            po::value<std::vector<std::string>>()->multitoken()->value_name("SOCKET [MAX_JOBS]"),
+            "(only in POSIX systems) if this option is specified, the application becomes a server listening for jobs on the Unix domain socket SOCKET. Each job is a single line with command line options (for example, '--load mesh.stl --save output.paths'), which are merged with the options specified alongside --daemon: the job options override the daemon options with the same name, and per-process options in the job (if any) replace all per-process options of the daemon. The configuration file is read only once (if the job does not specify a different one), and each job runs in a worker process forked from the server, with its output sent back through the socket. The last line sent back is '" JOB_EXIT_TAG " N', where N is the return code of the job. At most MAX_JOBS jobs are run at the same time (the default is 1). To shut down the server, send the line '" JOB_SHUTDOWN "'.")
         ;
     addResponseFileOption(*opts_toparse.back());
 
@@ -238,6 +255,28 @@ void MainSpec::slurpAllOptions(int argc, const char ** argv) {
     optsBySystem = sortOptions(opts_toparse_naked, po::positional_options_description(), mainOptsIdx, NULL, args);
 }
 
+//options present in the job override the options with the same name, except per-process options, which are overriden as a whole, because they are position-dependent
+void MainSpec::overrideOptions(std::vector<po::parsed_options> &jobOpts) {
+    for (int k = 0; k < (int)optsBySystem.size(); ++k) {
+        std::vector<po::option> &base = optsBySystem[k].options;
+        std::vector<po::option> &job  = jobOpts[k].options;
+        if (job.empty()) continue;
+        if (k == perProcOptsIdx) {
+            base = std::move(job);
+            continue;
+        }
+        std::set<std::string> jobkeys;
+        for (auto &option : job) jobkeys.insert(option.string_key);
+        base.erase(std::remove_if(base.begin(), base.end(), [&jobkeys](po::option &option) { return jobkeys.count(option.string_key) != 0; }), base.end());
+        for (auto &option : job) base.push_back(std::move(option));
+    }
+}
+
+void MainSpec::removeOption(int idx, const char *name) {
+    std::vector<po::option> &options = optsBySystem[idx].options;
+    options.erase(std::remove_if(options.begin(), options.end(), [name](po::option &option) { return option.string_key.compare(name) == 0; }), options.end());
+}
+
 void MainSpec::usage() {
     std::cout << "Command line interface to the multislicing engine.\n  If there is no ambiguity, options can be specified as prefixes of their full names.\n";
     for (auto opts : opts_toshow) {
@@ -257,26 +296,277 @@ bool getMeshFullPath(std::string &meshfilename) {
     return true;
 }
 
-std::string readNextSlice(int nslice, ClippingResources &clipres, std::vector<std::shared_ptr<SlicerManager>> &slicers, std::vector<clp::Paths> &rawslices, clp::Paths &rawslice) {
-    auto rawsl = rawslices.begin();
-    for (auto slicer = slicers.begin(); slicer!= slicers.end(); ++slicer, ++rawsl) {
-        rawsl->clear();
-        if (!(*slicer)->readNextSlice(*rawsl)) {
-            std::string err = (*slicer)->getErrorMessage();
-            return str("Error while trying to read the ", nslice, "-th slice from the ", slicer-slicers.begin(), "-th slicer manager: ", err.c_str(), "!!!\n");
+/*reads the slices from the slicer managers, joining them into a single slice. If there are several slicer managers
+(--load-multi), each one is driven by its own thread, which reads up to maxAhead slices in advance, so all slicers
+work concurrently. The threads are started in the first call to readNextSlice(), so the Z values have to be sent
+(and the slices to skip or cancel, skipped or cancelled) before that. requestSlices() can be called at any time*/
+class SliceReader {
+public:
+    std::vector<std::shared_ptr<SlicerManager>> &slicers;
+    SliceReader(std::vector<std::shared_ptr<SlicerManager>> &_slicers, int _maxAhead = 2) : slicers(_slicers), maxAhead(_maxAhead), numWanted(0), started(false), stopping(false) {}
+    ~SliceReader() { stop(); }
+    std::string readNextSlice(int nslice, ClippingResources &clipres, clp::Paths &rawslice);
+    std::string requestSlices(int numSlices);   //see SlicerManager::requestSlices()
+    std::string cancelSlicesFrom(int numSlice); //see SlicerManager::cancelSlicesFrom()
+    void stop(); //waits for the reader threads to finish (no more slices can be read)
+protected:
+    typedef struct ReaderState {
+        std::deque<clp::Paths> ready;
+        std::string err;
+        bool finished;
+        ReaderState() : finished(false) {}
+    } ReaderState;
+    void readerLoop(int k);
+    void joinSlices(ClippingResources &clipres, clp::Paths &rawslice);
+    size_t maxAhead;
+    int numWanted; //once the threads are started, each one passes this to its slicer manager
+    bool started, stopping;
+    std::vector<ReaderState> states;
+    std::vector<clp::Paths> rawslices;
+    std::vector<std::thread> threads;
+    std::vector<std::shared_ptr<ClippingResources>> threadres;
+    std::mutex mutex;
+    std::condition_variable sliceReady, sliceTaken;
+};
+
+void SliceReader::readerLoop(int k) {
+    auto &state = states[k];
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            sliceTaken.wait(lock, [this, &state] { return stopping || (state.ready.size() < maxAhead); });
+            if (stopping) break;
+        }
+        if (slicers[k]->reachedEnd()) break;
+        int wanted;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            wanted = numWanted;
+        }
+        clp::Paths slice;
+        bool ok = slicers[k]->requestSlices(wanted) && slicers[k]->readNextSlice(slice);
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!ok) {
+            state.err = slicers[k]->getErrorMessage();
+            break;
+        }
+        state.ready.push_back(std::move(slice));
+        sliceReady.notify_all();
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    state.finished = true;
+    sliceReady.notify_all();
+}
+
+void SliceReader::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+        sliceTaken.notify_all();
+    }
+    for (auto &thread : threads) thread.join();
+    threads.clear();
+}
+
+std::string SliceReader::readNextSlice(int nslice, ClippingResources &clipres, clp::Paths &rawslice) {
+    if (slicers.size() == 1) {
+        rawslice.clear();
+        if (!slicers[0]->readNextSlice(rawslice)) {
+            return str("Error while trying to read the ", nslice, "-th slice from the slicer manager: ", slicers[0]->getErrorMessage(), "!!!\n");
+        }
+        return std::string();
+    }
+    if (!started) {
+        started = true;
+        states.resize(slicers.size());
+        rawslices.resize(slicers.size());
+        threads.reserve(slicers.size());
+        for (int k = 0; k < (int)slicers.size(); ++k) threads.emplace_back(&SliceReader::readerLoop, this, k);
+    }
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        for (int k = 0; k < (int)slicers.size(); ++k) {
+            auto &state = states[k];
+            sliceReady.wait(lock, [&state] { return (!state.ready.empty()) || state.finished; });
+            if (state.ready.empty()) {
+                return str("Error while trying to read the ", nslice, "-th slice from the ", k, "-th slicer manager: ", state.err.empty() ? std::string("no more slices") : state.err, "!!!\n");
+            }
+            rawslices[k] = std::move(state.ready.front());
+            state.ready.pop_front();
         }
+        sliceTaken.notify_all();
     }
+    joinSlices(clipres, rawslice);
+    return std::string();
+}
 
-    if (rawslices.size()==1) {
+std::string SliceReader::requestSlices(int numSlices) {
+    if (started) {
+        std::lock_guard<std::mutex> lock(mutex);
+        numWanted = std::max(numWanted, numSlices);
+        return std::string();
+    }
+    for (int k = 0; k < (int)slicers.size(); ++k) {
+        if (!slicers[k]->requestSlices(numSlices)) {
+            return str("Error while requesting slices from the ", k, "-th slicer manager: ", slicers[k]->getErrorMessage(), "!!!\n");
+        }
+    }
+    return std::string();
+}
+
+std::string SliceReader::cancelSlicesFrom(int numSlice) {
+    if (started) return str("Error: slices cannot be cancelled once the slicer managers are being read!!!\n");
+    for (int k = 0; k < (int)slicers.size(); ++k) {
+        if (!slicers[k]->cancelSlicesFrom(numSlice)) {
+            return str("Error while cancelling slices from the ", k, "-th slicer manager: ", slicers[k]->getErrorMessage(), "!!!\n");
+        }
+    }
+    return std::string();
+}
+
+static bool overlaps(BBox &a, BBox &b) {
+    return (a.minx <= b.maxx) && (b.minx <= a.maxx) && (a.miny <= b.maxy) && (b.miny <= a.maxy);
+}
+
+/*the union of the slices is computed as a pairwise reduction, each level in parallel. The union also cleans up overlaps
+and self-intersections within each slice, so every slice goes through at least one union (as it did when all of them
+were joined in a single union). Meshes in a build plate are usually separate, so the slices are checked for overlap:
+the union of two disjoint slices which have already been cleaned up by a union is just their concatenation*/
+void SliceReader::joinSlices(ClippingResources &clipres, clp::Paths &rawslice) {
+    size_t n = rawslices.size();
+    if (n == 1) {
+        //a single mesh is used as is, without a union
         rawslice = std::move(rawslices[0]);
+        rawslices[0].clear();
+        return;
+    }
+    std::vector<BBox> bbs(n);
+    std::vector<char> nonempty(n), clean(n, 0);
+    for (size_t k = 0; k < n; ++k) {
+        nonempty[k] = !rawslices[k].empty();
+        if (nonempty[k]) bbs[k] = getBB(rawslices[k]);
+    }
+    for (size_t step = 1; step < n; step *= 2) {
+        size_t numpairs = (n - step + 2 * step - 1) / (2 * step);
+        int nthreads    = getNumThreads(0, numpairs);
+        //the caller's ClippingResources may be in use by other threads (e.g. asynchronous writers), so all threads use their own
+        while ((int)threadres.size() < nthreads) {
+            threadres.push_back(std::make_shared<ClippingResources>(clipres.spec));
+        }
+        parallelFor(numpairs, nthreads, [this, &bbs, &nonempty, &clean, step](size_t p, int numthread) {
+            size_t a = p * 2 * step, b = a + step;
+            if (!nonempty[b]) return;
+            if (!nonempty[a]) {
+                std::swap(rawslices[a], rawslices[b]);
+                bbs[a]      = bbs[b];
+                clean[a]    = clean[b];
+                nonempty[a] = true;
+                return;
+            }
+            if (clean[a] && clean[b] && !overlaps(bbs[a], bbs[b])) {
+                rawslices[a].reserve(rawslices[a].size() + rawslices[b].size());
+                for (auto &path : rawslices[b]) rawslices[a].push_back(std::move(path));
+            } else {
+                clp::Clipper &clipper = threadres[numthread]->clipper;
+                clipper.AddPaths(rawslices[a], clp::ptSubject, true);
+                clipper.AddPaths(rawslices[b], clp::ptSubject, true);
+                clipper.Execute(clp::ctUnion, rawslices[a], clp::pftNonZero, clp::pftNonZero);
+                clipper.Clear();
+                clean[a] = true;
+            }
+            rawslices[b].clear();
+            bbs[a].merge(bbs[b]);
+        });
+    }
+    //if just one slice had paths, it has not been cleaned up yet
+    if (nonempty[0] && !clean[0]) {
+        clp::Clipper &clipper = threadres[0]->clipper;
+        clipper.AddPaths(rawslices[0], clp::ptSubject, true);
+        clipper.Execute(clp::ctUnion, rawslices[0], clp::pftNonZero, clp::pftNonZero);
+        clipper.Clear();
+    }
+    rawslice = std::move(rawslices[0]);
+    rawslices[0].clear();
+}
+
+//probe slices for the adaptive scheduler. As the slicer accepts just one list of Z values, they are computed by separate, short-lived slicer processes
+std::string computeProbeSlices(Configuration &config, MetricFactors &factors, std::string &SLICER_DEBUGFILE, std::vector<std::string> &meshfilenames, ClippingResources &clipres, SimpleSlicingScheduler &sched, double minz, double maxz) {
+    sched.probeZs = sched.computeAdaptiveProbeZs(minz*factors.input_to_internal, maxz*factors.input_to_internal);
+    std::vector<double> zs = sched.probeZs;
+    for (auto &z : zs) z *= factors.internal_to_input;
+    std::vector<std::shared_ptr<SlicerManager>> probers;
+    probers.reserve(meshfilenames.size());
+    for (auto meshfilename = meshfilenames.begin(); meshfilename != meshfilenames.end(); ++meshfilename) {
+        std::shared_ptr<SlicerManager> prober = getExternalSlicerManager(config, factors, SLICER_DEBUGFILE, str(".probe", meshfilename - meshfilenames.begin()));
+        if (!prober->start(meshfilename->c_str())) {
+            return str("Error while trying to start the slicer manager for the probe slices: ", prober->getErrorMessage(), "!!!\n");
+        }
+        double dummy[6];
+        prober->getLimits(dummy, dummy + 1, dummy + 2, dummy + 3, dummy + 4, dummy + 5);
+        if (!prober->getErrorMessage().empty()) {
+            return str("Error while trying to start the slicer manager for the probe slices: ", prober->getErrorMessage(), "!!!\n");
+        }
+        if (!prober->sendZs(zs)) {
+            return str("Error sending Z values for the probe slices to slicer manager: ", prober->getErrorMessage(), "!!!\n");
+        }
+        probers.push_back(std::move(prober));
+    }
+    sched.probeSlices.resize(zs.size());
+    {
+        SliceReader reader(probers);
+        for (int i = 0; i < (int)zs.size(); ++i) {
+            std::string err = reader.readNextSlice(i, clipres, sched.probeSlices[i]);
+            if (!err.empty()) return err;
+        }
+    }
+    for (auto &prober : probers) prober->finalize();
+    return std::string();
+}
+
+//computes some sample slices of the schedule, and prints the estimated cost of the whole schedule
+std::string estimateScheduleCost(int numPerTool, bool useloadraw, std::vector<double> &rawZs, ClippingResources &clipres, SliceReader &reader, SimpleSlicingScheduler &sched) {
+    CostSamples samples;
+    sched.selectCostSamples(numPerTool, samples);
+    //the records in a raw slices file have to be read in order, so in that case all raw slices are requested
+    std::vector<double> zs;
+    if (useloadraw) {
+        zs = rawZs;
     } else {
-        for (auto &rawsl : rawslices) {
-            clipres.clipper.AddPaths(rawsl, clp::ptSubject, true);
-            rawsl.clear();
+        zs.reserve(samples.raws.size());
+        for (int r : samples.raws) zs.push_back(rawZs[r]);
+    }
+    if (!zs.empty()) {
+        for (auto &slicer : reader.slicers) {
+            if (!slicer->sendZs(zs)) return str("Error sending Z values to slicer manager: ", slicer->getErrorMessage(), "\n");
+        }
+    }
+    std::vector<clp::Paths> sampleslices(samples.raws.size());
+    clp::Paths discarded;
+    int nextraw = 0;
+    for (int s = 0; s < (int)samples.raws.size(); ++s) {
+        if (useloadraw) {
+            for (; nextraw < samples.raws[s]; ++nextraw) {
+                std::string err = reader.readNextSlice(nextraw, clipres, discarded);
+                if (!err.empty()) return err;
+            }
+            ++nextraw;
         }
-        clipres.clipper.Execute(clp::ctUnion, rawslice, clp::pftNonZero, clp::pftNonZero);
-        clipres.clipper.Clear();
+        std::string err = reader.readNextSlice(s, clipres, sampleslices[s]);
+        if (!err.empty()) return err;
+    }
+
+    CostEstimate estimate;
+    if (!sched.estimateCost(samples, sampleslices, estimate)) return str("Error while estimating the cost of the schedule: ", sched.err, "\n");
+
+    const double MB = 1024.0 * 1024.0;
+    printf("\nCost estimation (extrapolated from sample slices):\n");
+    for (int t = 0; t < (int)estimate.numSlices.size(); ++t) {
+        if (estimate.numSlices[t] == 0) continue;
+        printf("    process %d: %d slices, %d samples, %.4f seconds and %.3f MB per slice, %d slices held at the memory peak\n",
+            t, estimate.numSlices[t], estimate.numSamples[t], estimate.secondsPerSlice[t], estimate.bytesPerSlice[t] / MB, estimate.peakRetained[t]);
     }
+    printf("    computing time: %.1f seconds\n", estimate.totalSeconds);
+    printf("    peak memory of computed slices: %.1f MB\n", estimate.peakBytes / MB);
     return std::string();
 }
 
@@ -344,7 +634,14 @@ public:
     }
 };
 
-int Main(int argc, const char** argv) {
+//in daemon mode, these resources are set up once and reused for all jobs
+typedef struct DaemonResources {
+    std::string configfilename;
+    std::shared_ptr<Configuration> config;
+    std::shared_ptr<ClippingResources> clipres;
+} DaemonResources;
+
+int runJob(MainSpec &mainSpec, DaemonResources *daemon) {
     std::vector<std::string> meshfilenames;
     bool useloadraw, useload, usemultiload;
 
@@ -370,6 +667,8 @@ int Main(int argc, const char** argv) {
     std::string singleoutputfilename, outputrawslicesfilename;
 
     bool dryrun, dryrunOpt, justSaveRaw;
+    int costSamplesPerTool = 0;
+    int asyncQueueSize = 0;
     
     std::shared_ptr<Configuration> config = std::make_shared<Configuration>();
     std::shared_ptr<MultiSpec>  multispec = std::make_shared<MultiSpec>(config);
@@ -385,24 +684,21 @@ int Main(int argc, const char** argv) {
     NanoscribeSpec nanoSpec;
 
     try {
-        MainSpec mainSpec;
-        if (argc == 1) {
-            mainSpec.usage();
-            return 1;
-        }
-        mainSpec.slurpAllOptions(argc, argv);
-
         po::variables_map mainOpts = mainSpec.getMap(mainSpec.mainOptsIdx);
 
-        if (mainOpts.count("help")) {
-            mainSpec.usage();
-            return 1;
+        if (mainOpts.count("estimate-cost")) {
+            costSamplesPerTool = mainOpts["estimate-cost"].as<int>();
+            if (costSamplesPerTool <= 0) { fprintf(stderr, "the argument of --estimate-cost must be over 0, but it was %d\n", costSamplesPerTool); return -1; }
         }
-
-        dryrunOpt    = mainOpts.count("dry-run") != 0;
+        dryrunOpt    = (mainOpts.count("dry-run") != 0) || (costSamplesPerTool > 0);
         justSaveRaw  = mainOpts.count("just-save-raw") != 0;
         save         = mainOpts.count("save")    != 0;
         dryrun       = dryrunOpt || justSaveRaw;
+
+        if (mainOpts.count("async-write")) {
+            asyncQueueSize = mainOpts["async-write"].as<int>();
+            if (asyncQueueSize <= 0) { fprintf(stderr, "the argument of --async-write must be over 0, but it was %d\n", asyncQueueSize); return -1; }
+        }
         
         if (justSaveRaw) {
             outputrawslicesfilename = std::move(mainOpts["just-save-raw"].as<std::string>());
@@ -438,11 +734,15 @@ int Main(int argc, const char** argv) {
 
         std::string configfilename = std::move(mainOpts["config"].as<std::string>());
 
-        if (!fileExists(configfilename.c_str())) { fprintf(stderr, "Could not open config file %s!!!!", configfilename.c_str()); return -1; }
+        if ((daemon != NULL) && (configfilename.compare(daemon->configfilename) == 0)) {
+            *config = *daemon->config;
+        } else {
+            if (!fileExists(configfilename.c_str())) { fprintf(stderr, "Could not open config file %s!!!!", configfilename.c_str()); return -1; }
 
-        config->load(configfilename.c_str());
+            config->load(configfilename.c_str());
 
-        if (config->has_err) { fprintf(stderr, config->err.c_str()); return -1; }
+            if (config->has_err) { fprintf(stderr, config->err.c_str()); return -1; }
+        }
 
         factors.init(*config, doscale);
         if (!factors.err.empty()) { fprintf(stderr, factors.err.c_str()); return -1; }
@@ -533,7 +833,12 @@ int Main(int argc, const char** argv) {
     }
     
     if (checkpoint.test() && !multispec->global.useScheduler) {
-        fprintf(stderr, "can do checkpointing only with --slicing-scheduler or --slicing-manual!!!!\n");
+        fprintf(stderr, "can do checkpointing only with --slicing-scheduler, --slicing-manual or --slicing-adaptive!!!!\n");
+        return -1;
+    }
+
+    if ((costSamplesPerTool > 0) && !multispec->global.useScheduler) {
+        fprintf(stderr, "can estimate the cost only with --slicing-scheduler, --slicing-manual or --slicing-adaptive!!!!\n");
         return -1;
     }
 
@@ -561,7 +866,7 @@ int Main(int argc, const char** argv) {
     double minx, maxx, miny, maxy, minz, maxz;
     double slicer_to_input = 1 / factors.input_to_slicer;
     std::vector<std::shared_ptr<SlicerManager>> slicers;
-    std::vector<clp::Paths> rawslices(meshfilenames.size());
+    SliceReader reader(slicers);
     slicers.reserve(meshfilenames.size());
     std::string SLICER_DEBUGFILE;
     if (!useloadraw) SLICER_DEBUGFILE = config->getValue("SLICER_DEBUGFILE");
@@ -613,7 +918,15 @@ int Main(int argc, const char** argv) {
     }
     //printf("General bounding box:\n    minX: %f\n    maxX: %f\n    minY: %f\n    maxY: %f\n    minZ: %f\n    maxZ: %f\n", minx, maxx, miny, maxy, minz, maxz);
 
-    std::shared_ptr<ClippingResources> clipres = std::make_shared<ClippingResources>(multispec);
+    std::shared_ptr<ClippingResources> clipres;
+    if (daemon != NULL) {
+        clipres       = daemon->clipres;
+        clipres->spec = multispec;
+    } else {
+        clipres = std::make_shared<ClippingResources>(multispec);
+    }
+    //with --async-write, splitting writers clip in their own threads, so each one needs its own ClippingResources
+    auto writerClipres = [asyncQueueSize, &clipres]() { return asyncQueueSize > 0 ? std::make_shared<ClippingResources>(clipres->spec) : clipres; };
 
     clp::IntPoint bbmn, bbmx;
     bbmn.X = (clp::cInt) (minx * factors.input_to_internal);
@@ -646,7 +959,7 @@ int Main(int argc, const char** argv) {
             std::shared_ptr<FileHeader> headerForNano;
             const bool doDebug = false;
             if (doDebug) headerForNano = header; //this is for debugging purposes
-            std::shared_ptr<NanoscribeSplittingPathWriter> pathsplitter = std::make_shared<NanoscribeSplittingPathWriter>(resume, headerForNano, clipres, *multispec, std::move(nanoSpec.nanos), std::move(nanoSpec.splits), std::move(nanoSpec.filename), nanoSpec.generic_ntool, nanoSpec.generic_z);
+            std::shared_ptr<NanoscribeSplittingPathWriter> pathsplitter = std::make_shared<NanoscribeSplittingPathWriter>(resume, headerForNano, writerClipres(), *multispec, std::move(nanoSpec.nanos), std::move(nanoSpec.splits), std::move(nanoSpec.filename), nanoSpec.generic_ntool, nanoSpec.generic_z);
             pathwriters_arefiles.push_back(pathsplitter);
             pathwriters_toolpath.push_back(pathsplitter);
         }
@@ -708,7 +1021,7 @@ int Main(int argc, const char** argv) {
                 return d;
             };
             bool saveInGridConf_justone = saveInGridConf.size() == 1;
-            std::shared_ptr<PathWriter> w = std::make_shared<SplittingPathWriter>(resume, clipres, *multispec, callback, saveInGridConf, "SPLITTING_DELEGATOR");
+            std::shared_ptr<PathWriter> w = std::make_shared<SplittingPathWriter>(resume, writerClipres(), *multispec, callback, saveInGridConf, "SPLITTING_DELEGATOR");
             pathwriters_arefiles.push_back(w);
             if (save || (!dxf_filename_toolpaths.empty())) {
                 pathwriters_toolpath.push_back(w);
@@ -722,6 +1035,17 @@ int Main(int argc, const char** argv) {
                 pathwriters_contour.push_back(w);
             }
         }
+
+        if (asyncQueueSize > 0) {
+            //wrap all writers to files (the same writer may be in several lists)
+            for (auto &w : pathwriters_arefiles) {
+                std::shared_ptr<PathWriter> async = std::make_shared<AsyncPathWriter>(w, asyncQueueSize);
+                for (auto list : { &pathwriters_raw, &pathwriters_contour, &pathwriters_toolpath }) {
+                    for (auto &listed : *list) if (listed == w) listed = async;
+                }
+                w = std::move(async);
+            }
+        }
     }
 
     //for now, we do not need to store intermediate results, but let the code live in case we need it later
@@ -741,7 +1065,21 @@ int Main(int argc, const char** argv) {
                 }
             }
 
-            sched.createSlicingSchedule(minz*factors.input_to_internal, maxz*factors.input_to_internal, multispec->global.z_epsilon, ScheduleSimple);
+            SchedulingMode schedulingMode = ScheduleSimple;
+            if (multispec->global.schedMode == AdaptiveScheduling) {
+                if (useloadraw) {
+                    fprintf(stderr, "Error: --slicing-adaptive cannot be used with --load-raw, as it requires slicing the mesh at additional Z values\n");
+                    return -1;
+                }
+                std::string err = computeProbeSlices(*config, factors, SLICER_DEBUGFILE, meshfilenames, *clipres, sched, minz, maxz);
+                if (!err.empty()) {
+                    fprintf(stderr, err.c_str());
+                    return -1;
+                }
+                schedulingMode = ScheduleAdaptive;
+            }
+
+            sched.createSlicingSchedule(minz*factors.input_to_internal, maxz*factors.input_to_internal, multispec->global.z_epsilon, schedulingMode);
 
             if (sched.has_err) {
                 fprintf(stderr, "Error while trying to create the slicing schedule: %s\n", sched.err.c_str());
@@ -765,6 +1103,16 @@ int Main(int argc, const char** argv) {
                 for (const auto &input : sched.input) {
                     printf("%d %.20g\n", input.ntool, input.z*factors.internal_to_input);
                 }
+                if (costSamplesPerTool > 0) {
+                    std::string err = estimateScheduleCost(costSamplesPerTool, useloadraw, rawZs, *clipres, reader, sched);
+                    if (!err.empty()) {
+                        fprintf(stderr, err.c_str());
+                        reader.stop();
+                        for (auto &slicer : slicers) slicer->terminate();
+                        return -1;
+                    }
+                }
+                reader.stop();
                 for (auto &slicer : slicers) slicer->terminate();
                 return 0;
             }
@@ -797,16 +1145,36 @@ int Main(int argc, const char** argv) {
             
             if (checkpoint.testLoad()) checkpoint.doLoad(sched, slicers);
 
+            //if the application ends at a checkpoint, the raw slices past it are never read, so they need not be sliced
+            if (checkpoint.save && (checkpoint.numToSkipInSave < schednuminputslices)) {
+                std::string err = reader.cancelSlicesFrom((int)checkpoint.numToSkipInSave);
+                if (!err.empty()) {
+                    fprintf(stderr, err.c_str());
+                    return -1;
+                }
+            }
+
             for (int i = (int)checkpoint.numToSkipInLoad; i < schednuminputslices; ++i) {
               
                 if (checkpoint.testSave(i)) {
+                    for (auto &pathwriter : pathwriters_arefiles) {
+                        if (!pathwriter->finish()) {
+                            fprintf(stderr, "Error writing to <%s> before saving checkpoint: %s\n", pathwriter->filename.c_str(), pathwriter->err.c_str());
+                        }
+                    }
                     checkpoint.doSave(sched, i);
                     if (checkpoint.endApplication(i)) break;
                 }
 
                 printf("reading raw slice %d/%d\n", i, schednuminputslices - 1);
 
-                std::string err = readNextSlice(i, *clipres, slicers, rawslices, rawslice);
+                //the next input slice cannot be computed until all its raw slices are received, so they are all requested now
+                std::string err = reader.requestSlices(sched.numRawSlicesRequiredForNextInput());
+                if (!err.empty()) {
+                    fprintf(stderr, err.c_str());
+                    return -1;
+                }
+                err = reader.readNextSlice(i, *clipres, rawslice);
                 if (!err.empty()) {
                     fprintf(stderr, err.c_str());
                     return -1;
@@ -840,6 +1208,7 @@ int Main(int argc, const char** argv) {
                         fprintf(stderr, "Error in giveNextOutputSlice.2: %s\n", single->err.c_str());
                         return -1;
                     }
+                    if (!single->warn.empty()) fprintf(stderr, "WARNING for ntool=%d, z=%f: %s", single->ntool, single->z * factors.internal_to_input, single->warn.c_str());
                     if (saveContours) results.push_back(single);
                     printf("received output slice %d/" FMTSIZET " (ntool=%d, z=%f)\n", single->idx, sched.output.size()-1, single->ntool, single->z);
                     double zscaled = single->z                           * factors.internal_to_input;
@@ -893,6 +1262,7 @@ int Main(int argc, const char** argv) {
                 for (const auto &z : zs) {
                     printf("%.20g\n", z);
                 }
+                reader.stop();
                 for (auto &slicer : slicers) slicer->terminate();
                 return 0;
             }
@@ -934,7 +1304,7 @@ int Main(int argc, const char** argv) {
                     }
                 }
 
-                std::string err = readNextSlice(i, *clipres, slicers, rawslices, rawslice);
+                std::string err = reader.readNextSlice(i, *clipres, rawslice);
                 if (!err.empty()) {
                     fprintf(stderr, err.c_str());
                     return -1;
@@ -955,6 +1325,7 @@ int Main(int argc, const char** argv) {
                 }
 
                 for (int k = 0; k < numtools; ++k) {
+                    if (!ress[k]->warn.empty()) fprintf(stderr, "WARNING for ntool=%d, z=%f: %s", k, zs[i], ress[k]->warn.c_str());
                     double rad     = multispec->pp[k].radius * factors.internal_to_input;
                     for (auto &pathwriter : pathwriters_toolpath) {
                         if (!pathwriter->writePaths(ress[k]->ptoolpaths, PATHTYPE_TOOLPATH_PERIMETER, rad, k, zs[i], factors.internal_to_input, false)) {
@@ -988,6 +1359,7 @@ int Main(int argc, const char** argv) {
 
     results.clear();
 
+    reader.stop();
     for (auto &slicer : slicers) if (!slicer->finalize()) {
         std::string err = slicer->getErrorMessage();
         fprintf(stderr, "Error while finalizing the slicer manager: %s!!!!", err.c_str());
@@ -1009,6 +1381,84 @@ int Main(int argc, const char** argv) {
     return 0;
 }
 
+int runDaemon(MainSpec &mainSpec, po::variables_map &mainOpts) {
+    std::vector<std::string> vals = std::move(mainOpts["daemon"].as<std::vector<std::string>>());
+    if (vals.size() > 2) { fprintf(stderr, "option --daemon takes at most two arguments!!!\n"); return -1; }
+    std::string socketpath = std::move(vals[0]);
+    int maxjobs = 1;
+    if (vals.size() == 2) {
+        char *endptr;
+        maxjobs = (int)strtol(vals[1].c_str(), &endptr, 10);
+        if (((*endptr) != 0) || (maxjobs <= 0)) { fprintf(stderr, "Second argument of --daemon is invalid: <%s>\n", vals[1].c_str()); return -1; }
+    }
+    mainSpec.removeOption(mainSpec.mainOptsIdx, "daemon");
+
+    DaemonResources daemon;
+    daemon.configfilename = std::move(mainOpts["config"].as<std::string>());
+    daemon.config         = std::make_shared<Configuration>();
+    if (!fileExists(daemon.configfilename.c_str())) { fprintf(stderr, "Could not open config file %s!!!!", daemon.configfilename.c_str()); return -1; }
+    daemon.config->load(daemon.configfilename.c_str());
+    if (daemon.config->has_err) { fprintf(stderr, daemon.config->err.c_str()); return -1; }
+    //the arenas are set up just once in the server (and warmed up, so their initial chunks are already allocated), and inherited by the workers
+    daemon.clipres = std::make_shared<ClippingResources>(std::make_shared<MultiSpec>(daemon.config));
+    daemon.clipres->warmUp();
+
+    printf("listening for jobs on socket %s\n", socketpath.c_str());
+    fflush(stdout);
+
+    //this is executed in a worker process, so it is OK to modify mainSpec and daemon
+    JobRunner runner = [&mainSpec, &daemon](std::string &job) {
+        TimeMeasurements tm;
+        tm.measureTime();
+        int ret = -1;
+        try {
+            std::vector<std::string> args = normalizedSplit(job);
+            std::vector<po::parsed_options> jobOpts = sortOptions(mainSpec.opts_toparse_naked, po::positional_options_description(), mainSpec.mainOptsIdx, NULL, args);
+            mainSpec.overrideOptions(jobOpts);
+            ret = runJob(mainSpec, &daemon);
+        } catch (std::exception &e) {
+            fprintf(stderr, "Unhandled exception NOT while computing the output.\n   Exception    type: %s\n   Exception message: %s\n", typeid(e).name(), e.what());
+        }
+        tm.measureTime();
+        std::string format = str("JOB TIME", ret == 0 ? "" : " UNTIL ERROR", ": CPU %f, WALL TIME %f\n");
+        tm.printLastMeasurement(stdout, format.c_str());
+        return ret;
+    };
+
+    std::string err = serveJobsOnSocket(socketpath, maxjobs, runner);
+    if (!err.empty()) {
+        fprintf(stderr, "Error in daemon mode: %s\n", err.c_str());
+        return -1;
+    }
+    return 0;
+}
+
+int Main(int argc, const char** argv) {
+    MainSpec mainSpec;
+    try {
+        if (argc == 1) {
+            mainSpec.usage();
+            return 1;
+        }
+        mainSpec.slurpAllOptions(argc, argv);
+
+        po::variables_map mainOpts = mainSpec.getMap(mainSpec.mainOptsIdx);
+
+        if (mainOpts.count("help")) {
+            mainSpec.usage();
+            return 1;
+        }
+
+        if (mainOpts.count("daemon")) {
+            return runDaemon(mainSpec, mainOpts);
+        }
+    } catch (std::exception &e) {
+        fprintf(stderr, "%s\n", e.what()); return -1;
+    }
+
+    return runJob(mainSpec, NULL);
+}
+
 int main(int argc, const char** argv) {
     TimeMeasurements tm;
     tm.measureTime();
@@ -0,0 +1,248 @@
+#include "common.hpp"
+#include "iopaths.hpp"
+#include "config.hpp"
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <map>
+
+#ifdef _WIN32
+#   include <io.h>
+#   include <fcntl.h>
+#endif
+
+/*minimal stand-in for the external slicer, to test the protocol spoken by ExternalSlicerManager
+(both the classic one and the streaming one) without having to build Slic3r. The mesh is sliced
+by intersecting each triangle with the plane, and joining the segments into closed contours.
+It does not repair meshes, so if the mesh is not a closed manifold, the results are undefined.
+
+It is started exactly as the real slicer:
+
+    stubslicer [DEBUGFILE] (repair|norepair) (incremental|noincremental) [streaming] STLFILE
+
+(DEBUGFILE is only present if SLICER_USE_DEBUG_FILE is defined, and it is ignored)*/
+
+//same value as Slic3r's SCALING_FACTOR: the inverse of INPUT_TO_SLICER_FACTOR in the configuration file
+#define STUB_SCALING_FACTOR 0.000001
+
+typedef struct Vertex { double x, y, z; } Vertex;
+typedef struct Triangle { Vertex v[3]; } Triangle;
+
+static bool lessVertex(const Vertex &a, const Vertex &b) {
+    if (a.x != b.x) return a.x < b.x;
+    if (a.y != b.y) return a.y < b.y;
+    return a.z < b.z;
+}
+
+static std::string readBinarySTL(FILE *f, std::vector<Triangle> &triangles) {
+    char header[80];
+    unsigned int num;
+    if (fread(header, 1, 80, f) != 80) return "could not read the header of the binary STL";
+    if (fread(&num, sizeof(num), 1, f) != 1) return "could not read the number of triangles of the binary STL";
+    triangles.resize(num);
+    for (unsigned int k = 0; k < num; ++k) {
+        float data[12];
+        unsigned short attribute;
+        if ((fread(data, sizeof(float), 12, f) != 12) || (fread(&attribute, sizeof(attribute), 1, f) != 1)) {
+            return str("could not read the ", k, "-th triangle of the binary STL");
+        }
+        //the normal (first three values) is discarded, the orientation is taken from the order of the vertices
+        for (int v = 0; v < 3; ++v) {
+            triangles[k].v[v].x = data[3 + v * 3];
+            triangles[k].v[v].y = data[4 + v * 3];
+            triangles[k].v[v].z = data[5 + v * 3];
+        }
+    }
+    return std::string();
+}
+
+static std::string readAsciiSTL(FILE *f, std::vector<Triangle> &triangles) {
+    char word[256];
+    Triangle t;
+    int numv = 0;
+    while (fscanf(f, "%255s", word) == 1) {
+        if (strcmp(word, "vertex") != 0) continue;
+        if (numv == 3) return "found a facet with more than three vertices in the ASCII STL";
+        if (fscanf(f, "%lf %lf %lf", &t.v[numv].x, &t.v[numv].y, &t.v[numv].z) != 3) return "could not read a vertex of the ASCII STL";
+        if (++numv == 3) {
+            triangles.push_back(t);
+            numv = 0;
+        }
+    }
+    return std::string();
+}
+
+static std::string readSTL(const char *filename, std::vector<Triangle> &triangles) {
+    FILE *f = fopen(filename, "rb");
+    if (f == NULL) return str("could not open STL file ", filename);
+    //some binary STLs also start with "solid", so the file is considered to be binary if its size is consistent with the number of triangles
+    char header[84];
+    bool binary = false;
+    if (fread(header, 1, 84, f) == 84) {
+        unsigned int num;
+        memcpy(&num, header + 80, sizeof(num));
+        fseek(f, 0, SEEK_END);
+        long size = ftell(f);
+        binary = (size == (long)(84 + 50 * (long)num)) || (strncmp(header, "solid", 5) != 0);
+    }
+    fclose(f);
+    f = fopen(filename, binary ? "rb" : "r");
+    if (f == NULL) return str("could not open STL file ", filename);
+    std::string err = binary ? readBinarySTL(f, triangles) : readAsciiSTL(f, triangles);
+    fclose(f);
+    if (!err.empty()) return str("while reading ", filename, ": ", err);
+    return std::string();
+}
+
+/*intersection of the plane with the edge (a,b). The vertices are sorted before computing it, so both
+triangles sharing the edge get exactly the same point, and the segments can be joined by their endpoints*/
+static clp::IntPoint intersectEdge(Vertex a, Vertex b, double z) {
+    if (lessVertex(b, a)) std::swap(a, b);
+    double t = (z - a.z) / (b.z - a.z);
+    return clp::IntPoint((clp::cInt)std::llround((a.x + t * (b.x - a.x)) / STUB_SCALING_FACTOR),
+                         (clp::cInt)std::llround((a.y + t * (b.y - a.y)) / STUB_SCALING_FACTOR));
+}
+
+typedef std::pair<clp::cInt, clp::cInt> PointKey;
+
+const bool MemoryManagerPrintDebugMessages = false;
+
+template<typename CM = CLIPPER_MMANAGER> typename std::enable_if< CLIPPER_MMANAGER::isArena, CM>::type getManager() { return CLIPPER_MMANAGER("STUBSLICER", MemoryManagerPrintDebugMessages, BIGCHUNK_ARENA_SIZE, INITIAL_ARENA_SIZE); }
+template<typename CM = CLIPPER_MMANAGER> typename std::enable_if<!CLIPPER_MMANAGER::isArena, CM>::type getManager() { return CLIPPER_MMANAGER(); }
+
+static void sliceMesh(std::vector<Triangle> &triangles, double z, clp::Clipper &clipper, clp::Paths &slice) {
+    //segments oriented so the inside of the mesh is on their left, keyed by their starting point
+    std::multimap<PointKey, clp::IntPoint> segments;
+    for (auto &t : triangles) {
+        //vertices on the plane are considered to be below it, so each triangle is cut by either zero or two edges
+        bool above[3];
+        int numabove = 0;
+        for (int v = 0; v < 3; ++v) numabove += (above[v] = t.v[v].z > z) ? 1 : 0;
+        if ((numabove == 0) || (numabove == 3)) continue;
+        //the lonely vertex is the one on its own side of the plane
+        int lonely = 0;
+        for (int v = 0; v < 3; ++v) if (above[v] == (numabove == 1)) lonely = v;
+        clp::IntPoint p1 = intersectEdge(t.v[lonely], t.v[(lonely + 1) % 3], z);
+        clp::IntPoint p2 = intersectEdge(t.v[lonely], t.v[(lonely + 2) % 3], z);
+        if (p1 == p2) continue;
+        //the vertices are in counter-clockwise order seen from outside, so the normal (a,b,c) points outwards, and the XY projection of the normal has to be on the right of the segment
+        const Vertex &a = t.v[0], &b = t.v[1], &c = t.v[2];
+        double nx = (b.y - a.y) * (c.z - a.z) - (b.z - a.z) * (c.y - a.y);
+        double ny = (b.z - a.z) * (c.x - a.x) - (b.x - a.x) * (c.z - a.z);
+        double dx = (double)(p2.X - p1.X);
+        double dy = (double)(p2.Y - p1.Y);
+        if ((nx * dy - ny * dx) >= 0) {
+            segments.emplace(PointKey(p1.X, p1.Y), p2);
+        } else {
+            segments.emplace(PointKey(p2.X, p2.Y), p1);
+        }
+    }
+    clp::Paths loops;
+    while (!segments.empty()) {
+        auto segment = segments.begin();
+        PointKey start = segment->first;
+        clp::Path loop(1, clp::IntPoint(start.first, start.second));
+        bool closed = false;
+        while (segment != segments.end()) {
+            clp::IntPoint next = segment->second;
+            segments.erase(segment);
+            closed = (next.X == start.first) && (next.Y == start.second);
+            if (closed) break;
+            loop.push_back(next);
+            segment = segments.find(PointKey(next.X, next.Y));
+        }
+        //open chains (non-manifold meshes) are discarded
+        if (closed && (loop.size() >= 3)) loops.push_back(std::move(loop));
+    }
+    //the union cleans up overlapping shells and degenerate loops
+    clipper.AddPaths(loops, clp::ptSubject, true);
+    clipper.Execute(clp::ctUnion, slice, clp::pftNonZero, clp::pftNonZero);
+    clipper.Clear();
+}
+
+static bool writeSliceBlock(FILE *f, clp::Paths &slice, std::vector<int64> &block) {
+    block.clear();
+    block.push_back(0); //size of the rest of the block, set below
+    block.push_back((int64)slice.size());
+    for (auto &path : slice) block.push_back((int64)path.size());
+    for (auto &path : slice) for (auto &point : path) {
+        block.push_back(point.X);
+        block.push_back(point.Y);
+    }
+    block[0] = (int64)((block.size() - 1) * sizeof(int64));
+    return fwrite(&block.front(), sizeof(int64), block.size(), f) == block.size();
+}
+
+int main(int argc, const char** argv) {
+    if (argc < 4) {
+        fprintf(stderr, "Arguments: [DEBUGFILE] (repair|norepair) (incremental|noincremental) [streaming] STLFILE\n");
+        return -1;
+    }
+    bool repair = true, streaming = false;
+    for (int k = 1; k < argc - 1; ++k) {
+        if (strcmp(argv[k], "norepair")  == 0) repair    = false;
+        if (strcmp(argv[k], "streaming") == 0) streaming = true;
+    }
+#ifdef _WIN32
+    _setmode(_fileno(stdin),  _O_BINARY);
+    _setmode(_fileno(stdout), _O_BINARY);
+#endif
+
+    std::vector<Triangle> triangles;
+    std::string err = readSTL(argv[argc - 1], triangles);
+    if (!err.empty()) {
+        fprintf(stderr, "stubslicer error: %s\n", err.c_str());
+        return -1;
+    }
+
+    IOPaths iopIN(stdin), iopOUT(stdout);
+    if (!repair) {
+        //the mesh is never checked, so it is assumed not to require repairs
+        if (!iopOUT.writeInt64(0)) return -1;
+    }
+    double limits[7];
+    for (int k = 0; k < 3; ++k) {
+        limits[2 * k] = limits[2 * k + 1] = triangles.empty() ? 0.0 : (&triangles[0].v[0].x)[k];
+    }
+    for (auto &t : triangles) for (auto &v : t.v) {
+        const double *c = &v.x;
+        for (int k = 0; k < 3; ++k) {
+            limits[2 * k]     = std::min(limits[2 * k],     c[k]);
+            limits[2 * k + 1] = std::max(limits[2 * k + 1], c[k]);
+        }
+    }
+    limits[6] = STUB_SCALING_FACTOR;
+    if (!iopOUT.writeDoubleP(limits, 7)) return -1;
+    fflush(stdout);
+
+    std::vector<double> zs;
+    std::vector<int64> block;
+    clp::Paths slice;
+    CLIPPER_MMANAGER manager = getManager();
+    clp::Clipper clipper(manager);
+    while (true) {
+        int64 num;
+        if (!iopIN.readInt64(num)) {
+            fprintf(stderr, "stubslicer error: could not read the number of Z values\n");
+            return -1;
+        }
+        if ((num == 0) && streaming) break;
+        zs.resize((size_t)num);
+        if ((num > 0) && !iopIN.readDoubleP(&zs.front(), zs.size())) {
+            fprintf(stderr, "stubslicer error: could not read the Z values\n");
+            return -1;
+        }
+        for (auto z : zs) {
+            slice.clear();
+            sliceMesh(triangles, z, clipper, slice);
+            bool ok = streaming ? writeSliceBlock(stdout, slice, block) : iopOUT.writeClipperPaths(slice, PathOpen);
+            //if the other side has gone away, there is nobody to report this to
+            if (!ok) return -1;
+        }
+        fflush(stdout);
+        //the classic protocol sends all Z values at once
+        if (!streaming) break;
+    }
+    return 0;
+}
@@ -1,7 +1,10 @@
 #include "pathsfile.hpp"
 #include "simpleparsing.hpp"
 #include "apputil.hpp"
+#include "raster.hpp"
+#include "parallel.hpp"
 #include <iomanip>
+#include <limits>
 
 
 void writePolygonSVG(FILE * f, clp::Path &path, bool isContour, bool insideIsBlack, double scalingFactor, double minx, double miny) {
@@ -145,12 +148,134 @@ std::string processMatches(const char * filename, const char * svgfilename, Path
     return err;
 }
 
+typedef struct RasterOptions {
+    bool png;
+    int numthreads;
+    RasterSpec spec;
+} RasterOptions;
+
+//reads the paths of the record. They must be closed, because the rasterizer fills them
+std::string readRecordForRaster(const char * filename, FILE *f, size_t k, RecordIndexEntry &entry, clp::Paths &output) {
+    SliceHeader sliceheader;
+    if (fseek64(f, entry.offset, SEEK_SET) != 0) { return str("Error reading file ", filename, ": could not seek to the ", k, "-th record"); }
+    std::string err = sliceheader.readFromFile(f);
+    if (!err.empty()) { return str("Error reading ", k, "-th slice header in file ", filename, ": ", err); }
+    IOPaths iop(f);
+    if (sliceheader.saveFormat == PATHFORMAT_INT64) {
+        if (!iop.readClipperPaths(output)) {
+            return str("error reading integer paths from record ", k, " in file ", filename, ": error <", iop.errs[0].message, "> in ", iop.errs[0].function);
+        }
+    } else if (sliceheader.saveFormat == PATHFORMAT_DOUBLE) {
+        if (!iop.readDoublePaths(output, 1 / sliceheader.scaling)) {
+            return str("error reading double paths from record ", k, " in file ", filename, ": error <", iop.errs[0].message, "> in ", iop.errs[0].function);
+        }
+    } else if (sliceheader.saveFormat == PATHFORMAT_DOUBLE_3D) {
+        return str("In file ", filename, ", for path ", k, ", save mode is 3D, but we cannot rasterize 3D paths\n");
+    } else {
+        return str("In file ", filename, ", for path ", k, ", save mode not understood: ", sliceheader.saveFormat, "\n");
+    }
+    for (int n = 0; n < output.size(); ++n) {
+        if (!output[n].empty() && (output[n].front() != output[n].back())) {
+            return str("In file ", filename, ", pathset ", k, " matches specification, but path ", n, "-th inside it is not closed!!!");
+        }
+    }
+    return std::string();
+}
+
+/*renders the matching records as images. All images share the same frame (the bounding box of all matching
+records), so they can be used as masks. The bounding boxes are taken from the record index if possible; otherwise,
+the records are read twice. The records are read, rendered and written in parallel, each thread with its own FILE* */
+std::string processMatchesRaster(const char * filename, const char * imagefilename, PathInFileSpec spec, bool matchFirst, RasterOptions &options) {
+    FILEOwner i(filename, "rb");
+    if (!i.isopen()) { return str("Could not open file ", filename); }
+
+    FileHeader fileheader;
+    std::string err = fileheader.readFromFile(i.f);
+    if (!err.empty()) { return str("Error reading file header for ", filename, ": ", err); }
+
+    RecordIndex index;
+    err = index.load(i.f, fileheader);
+    if (!err.empty()) { return str("Error reading file ", filename, ": ", err); }
+    i.close();
+
+    std::vector<size_t> selected, withoutBB;
+    for (size_t k = 0; k < index.entries.size(); ++k) {
+        if (matchesEntry(spec, index.entries[k])) {
+            if (!index.entries[k].hasBB) withoutBB.push_back(k);
+            selected.push_back(k);
+            if (matchFirst) break;
+        }
+    }
+    if (selected.empty()) return std::string();
+
+    int numthreads = getNumThreads(options.numthreads, selected.size());
+    std::vector<FILEOwner> files(numthreads);
+    for (auto &file : files) {
+        if (!file.open(filename, "rb")) { return str("Could not open file ", filename); }
+    }
+    std::vector<std::string> errs(selected.size());
+
+    parallelFor(withoutBB.size(), numthreads, [&](size_t idx, int numthread) {
+        size_t k = withoutBB[idx];
+        clp::Paths output;
+        errs[idx] = readRecordForRaster(filename, files[numthread].f, k, index.entries[k], output);
+        if (errs[idx].empty()) index.entries[k].setBB(output);
+    });
+    for (auto &e : errs) if (!e.empty()) return e;
+
+    bool firstTime = true;
+    double minx = 0, maxx = 0, miny = 0, maxy = 0;
+    for (auto k : selected) {
+        RecordIndexEntry &entry = index.entries[k];
+        if (entry.isEmpty()) continue;
+        double s = entry.scaling;
+        if (firstTime || (entry.bb.minx * s < minx)) minx = entry.bb.minx * s;
+        if (firstTime || (entry.bb.maxx * s > maxx)) maxx = entry.bb.maxx * s;
+        if (firstTime || (entry.bb.miny * s < miny)) miny = entry.bb.miny * s;
+        if (firstTime || (entry.bb.maxy * s > maxy)) maxy = entry.bb.maxy * s;
+        firstTime = false;
+    }
+    //the number of scanlines and columns in subsamples must fit in an int
+    double maxsize = (std::max(maxx - minx, maxy - miny) / options.spec.pitch + 2) * options.spec.subsamples;
+    if (maxsize >= (double)std::numeric_limits<int>::max()) {
+        return str("The images would be too big (", maxsize, " subsamples per side): please use a bigger pixel size or fewer subsamples");
+    }
+    options.spec.fitTo(minx, maxx, miny, maxy, 1);
+
+    const char *extension = options.png ? ".png" : ".pgm";
+    parallelFor(selected.size(), numthreads, [&](size_t idx, int numthread) {
+        size_t k = selected[idx];
+        clp::Paths output;
+        errs[idx] = readRecordForRaster(filename, files[numthread].f, k, index.entries[k], output);
+        if (!errs[idx].empty()) return;
+
+        std::vector<unsigned char> image;
+        rasterizePaths(output, index.entries[k].scaling, options.spec, image);
+
+        std::string imagename;
+        if (matchFirst) {
+            imagename = str(imagefilename, extension);
+        } else {
+            imagename = str(imagefilename, '.', std::setfill('0'), std::setw(3), idx, extension);
+        }
+        if (options.png) {
+            errs[idx] = writePNG(imagename.c_str(), image, options.spec.width, options.spec.height);
+        } else {
+            errs[idx] = writePGM(imagename.c_str(), image, options.spec.width, options.spec.height);
+        }
+    });
+    for (auto &e : errs) if (!e.empty()) return e;
+
+    return std::string();
+}
+
 const char *ERR =
-"\nArguments: PATHSFILENAME SVGFILENAME (black | white) (first | all) [SPECTYPE VALUE]*\n\n"
+"\nArguments: PATHSFILENAME SVGFILENAME (black | white) (first | all) [raster (pgm | png) PITCH [aa SUBSAMPLES] [evenodd] [threads NUMTHREADS]] [SPECTYPE VALUE]*\n\n"
 "    -PATHSFILENAME is required (input paths file name).\n\n"
 "    -SVGFILENAME is required (output svg file name).\n\n"
 "    -the color inside the contours can be either 'black' or 'white'.\n\n"
 "    -if 'first' is specified, only the first eligible match is converted to SVG. If 'all' is specified, all eligible paths are converted, creating one SVG file for each one.\n\n"
+"    -if 'raster' is specified, the records are rendered as 8-bit grayscale images (PGM or PNG) instead of SVG files, with pixels of size PITCH (in the units of the original mesh, usually millimeters). All images have the same size and position, enclosing all eligible records. Optionally, 'aa SUBSAMPLES' sets antialiasing with SUBSAMPLESxSUBSAMPLES samples per pixel (SUBSAMPLES must be between 1 and 64), 'evenodd' fills the paths with the even-odd rule instead of the non-zero rule, and 'threads NUMTHREADS' sets the number of threads (default: as many as hardware threads).\n\n"
 "    -Multiple pairs SPECTYPE VALUE can be specified. SPECTYPE can be either 'type', 'ntool', or 'z'. For the first, VALUE can be either r[aw], c[ontour], p[erimeter] (perimeter toolpath type), i[nfilling] (infilling toolpath type) or t[oolpath] (any toolpath type). For the second, it is an integer, for the latter, a floating-point value. If several pairs have the same SPECTYPE, the latter overwrites the former. If nothing is specified, all paths are eligible.\n\n"
 "This tool writes as a SVG file the first record in PATHSFILENAME that matches the specification.\n\n";
 
@@ -196,6 +321,49 @@ int main(int argc, const char** argv) {
 
     if (!fileExists(pathsfilename)) { fprintf(stderr, "the input file was not found: %s!!!", pathsfilename); return -1; }
 
+    bool raster = (rd.argidx < rd.argc) && (strcmp(rd.argv[rd.argidx], "raster") == 0);
+    RasterOptions rasteroptions;
+    if (raster) {
+        const char *format;
+        ++rd.argidx;
+        if (!rd.readParam(format,                          "raster format (pgm/png)"))  { printError(rd); return -1; }
+        if (!rd.readParam(rasteroptions.spec.pitch,        "PITCH"))                    { printError(rd); return -1; }
+        if (strcmp(format, "png") == 0) {
+            rasteroptions.png = true;
+        } else if (strcmp(format, "pgm") == 0) {
+            rasteroptions.png = false;
+        } else {
+            fprintf(stderr, "the raster format should be 'pgm' or 'png', but it is: %s\n", format);
+            return -1;
+        }
+        if (rasteroptions.spec.pitch <= 0) {
+            fprintf(stderr, "the pixel size must be positive, but it is: %g\n", rasteroptions.spec.pitch);
+            return -1;
+        }
+        rasteroptions.numthreads        = 0;
+        rasteroptions.spec.inside       = insideIsBlack ? 0   : 255;
+        rasteroptions.spec.outside      = insideIsBlack ? 255 : 0;
+        while (rd.argidx < rd.argc) {
+            const char *option = rd.argv[rd.argidx];
+            if (strcmp(option, "aa") == 0) {
+                ++rd.argidx;
+                if (!rd.readParam(rasteroptions.spec.subsamples, "SUBSAMPLES"))        { printError(rd); return -1; }
+                if ((rasteroptions.spec.subsamples < 1) || (rasteroptions.spec.subsamples > RASTER_MAX_SUBSAMPLES)) {
+                    fprintf(stderr, "the number of subsamples must be between 1 and %d, but it is: %d\n", RASTER_MAX_SUBSAMPLES, rasteroptions.spec.subsamples);
+                    return -1;
+                }
+            } else if (strcmp(option, "evenodd") == 0) {
+                ++rd.argidx;
+                rasteroptions.spec.evenOdd = true;
+            } else if (strcmp(option, "threads") == 0) {
+                ++rd.argidx;
+                if (!rd.readParam(rasteroptions.numthreads,      "NUMTHREADS"))        { printError(rd); return -1; }
+            } else {
+                break;
+            }
+        }
+    }
+
     PathInFileSpec spec;
     std::string err = spec.readFromCommandLine(rd, -1, false);
     if (!err.empty()) {
@@ -204,7 +372,11 @@ int main(int argc, const char** argv) {
     }
 
     clp::Paths paths;
-    err = processMatches(pathsfilename, svgfilename, spec, matchFirst, insideIsBlack);
+    if (raster) {
+        err = processMatchesRaster(pathsfilename, svgfilename, spec, matchFirst, rasteroptions);
+    } else {
+        err = processMatches(pathsfilename, svgfilename, spec, matchFirst, insideIsBlack);
+    }
 
     if (!err.empty()) {
         fprintf(stderr, "Error while trying to get a set of paths according to the specification: %s", err.c_str());
@@ -1,6 +1,8 @@
 #include "pathsfile.hpp"
 #include "simpleparsing.hpp"
 #include "apputil.hpp"
+#include "parallel.hpp"
+#include <algorithm>
 
 //some examples of transformations for debugging:
 //just translation: 1 0 0 5 0 1 0 -10 0 0 1 3
@@ -9,71 +11,135 @@
 //0.952031 0.180332 0.247219 -0.000000 -0.301287 0.693675 0.654249 -0.000000 -0.053507 -0.697349 0.714732 0.000000 0.000000 0.000000 0.000000 1.000000
 
 
-std::string transformAndSave(IOPaths &iop, TransformationMatrix matrix, bool is2DCompatible, bool identityInZ, bool identityInXY, SliceHeader &sliceheader, DPaths &paths, clp::Paths *paths_input) {
-    if (is2DCompatible) {
-        if (!identityInZ) {
-            sliceheader.z = applyTransform2DCompatibleZ(sliceheader.z, matrix);
-            sliceheader.setBuffer();
+//a record of the input file. Records are read in batches, transformed in parallel, and written in order
+typedef struct TransformRecord {
+    SliceHeader sliceheader;
+    clp::Paths ipaths;
+    DPaths dpaths;
+    Paths3D paths3;
+    bool saveAsInt64;
+} TransformRecord;
+
+typedef struct TransformSpec {
+    double *matrix;
+    bool is2DCompatible, identityInZ, identityInXY;
+} TransformSpec;
+
+std::string readRecord(FILE *f, IOPaths &iop, int currentRecord, TransformRecord &rec) {
+    SliceHeader &sliceheader = rec.sliceheader;
+    std::string err = sliceheader.readFromFile(f);
+    if (!err.empty()) { return str("Error reading ", currentRecord, "-th slice header: ", err); }
+    if (sliceheader.alldata.size() < 7) { return str("Error reading ", currentRecord, "-th slice header: header is too short!"); }
+    if (sliceheader.saveFormat == PATHFORMAT_INT64) {
+        if (!iop.readClipperPaths(rec.ipaths)) {
+            return str("Error reading ", currentRecord, "-th integer clipperpaths!");
         }
-        if (!identityInXY) {
-            for (auto path = paths.begin(); path != paths.end(); ++path) {
-                for (auto point = path->begin(); point != path->end(); ++point) {
-                    applyTransform2DCompatibleXY(*point, matrix);
-                }
-            }
+    } else if (sliceheader.saveFormat == PATHFORMAT_DOUBLE) {
+        if (!iop.readDoublePaths(rec.dpaths)) {
+            return str("Error reading ", currentRecord, "-th double clipperpaths!");
+        }
+    } else if (sliceheader.saveFormat == PATHFORMAT_DOUBLE_3D) {
+        if (!read3DPaths(iop, rec.paths3)) {
+            return str("Error reading ", currentRecord, "-th 3d clipperpaths!");
         }
-        bool saveAsInt64 = identityInXY && (paths_input!=NULL);
-        sliceheader.saveFormat = saveAsInt64 ? PATHFORMAT_INT64 : PATHFORMAT_DOUBLE;
-        sliceheader.setBuffer();
-        std::string err = sliceheader.writeToFile(iop.f);
-        if (!err.empty()) { return err; }
-        if (saveAsInt64) {
-            if (!iop.writeClipperPaths(*paths_input, PathOpen)) {
-                return std::string("Error while writing int64 clipperpaths!!!");
+    } else {
+        return str("error: ", currentRecord, "-th path has an unknown save format type: ", sliceheader.saveFormat);
+    }
+    return std::string();
+}
+
+//this function is called concurrently for different records
+void transformRecord(TransformSpec &spec, TransformRecord &rec) {
+    SliceHeader &sliceheader = rec.sliceheader;
+    rec.saveAsInt64 = false;
+    if (sliceheader.saveFormat == PATHFORMAT_DOUBLE_3D) {
+        for (auto &path : rec.paths3) {
+            applyTransformFull3D(path.data(), path.size(), spec.matrix);
+        }
+        return;
+    }
+    bool fromInt64 = sliceheader.saveFormat == PATHFORMAT_INT64;
+    if (spec.is2DCompatible) {
+        if (!spec.identityInZ) {
+            sliceheader.z = applyTransform2DCompatibleZ(sliceheader.z, spec.matrix);
+        }
+        rec.saveAsInt64 = spec.identityInXY && fromInt64;
+        if (!rec.saveAsInt64) {
+            if (fromInt64) {
+                rec.dpaths.resize(rec.ipaths.size());
+                for (size_t k = 0; k < rec.ipaths.size(); ++k) {
+                    rec.dpaths[k].resize(rec.ipaths[k].size());
+                    scalePointsToDouble(rec.ipaths[k].data(), sliceheader.scaling, rec.dpaths[k].data(), rec.ipaths[k].size());
+                }
+                clp::Paths().swap(rec.ipaths);
             }
-        } else {
-            if (!iop.writeDoublePaths(paths, PathOpen)) {
-                return std::string("Error while writing double clipperpaths!!!");
+            if (!spec.identityInXY) {
+                for (auto &path : rec.dpaths) {
+                    applyTransform2DCompatibleXY(path.data(), path.size(), spec.matrix);
+                }
             }
         }
+        sliceheader.saveFormat = rec.saveAsInt64 ? PATHFORMAT_INT64 : PATHFORMAT_DOUBLE;
     } else {
-        Paths3D paths3;
-        paths3.reserve(paths.size());
-        for (auto path = paths.begin(); path != paths.end(); ++path) {
-            paths3.push_back(Path3D());
-            paths3.back().reserve(path->size());
-            for (auto point = path->begin(); point != path->end(); ++point) {
-                paths3.back().push_back(applyTransformFull3D(*point, sliceheader.z, matrix));
+        size_t numpaths = fromInt64 ? rec.ipaths.size() : rec.dpaths.size();
+        rec.paths3.resize(numpaths);
+        DPaths::value_type aux;
+        for (size_t k = 0; k < numpaths; ++k) {
+            clp::DoublePoint *input;
+            size_t numpoints;
+            if (fromInt64) {
+                numpoints = rec.ipaths[k].size();
+                aux.resize(numpoints);
+                scalePointsToDouble(rec.ipaths[k].data(), sliceheader.scaling, aux.data(), numpoints);
+                input = aux.data();
+            } else {
+                numpoints = rec.dpaths[k].size();
+                input = rec.dpaths[k].data();
             }
+            rec.paths3[k].resize(numpoints);
+            applyTransformFull3D(input, sliceheader.z, rec.paths3[k].data(), numpoints, spec.matrix);
         }
-
+        clp::Paths().swap(rec.ipaths);
+        DPaths().swap(rec.dpaths);
         sliceheader.saveFormat = PATHFORMAT_DOUBLE_3D;
-        sliceheader.totalSize = getPathsSerializedSize(paths3, PathOpen) + sliceheader.headerSize;
-        sliceheader.setBuffer();
-        std::string err = sliceheader.writeToFile(iop.f);
-        if (!err.empty()) { return err; }
-        if (!write3DPaths(iop, paths3, PathOpen)) {
-            return std::string("Error while writing 3d clipperpaths!!!");
-        }
+        sliceheader.totalSize = getPathsSerializedSize(rec.paths3, PathOpen) + sliceheader.headerSize;
     }
-    return std::string();
+    sliceheader.setBuffer();
 }
 
-std::string transformAndSave(IOPaths &iop, TransformationMatrix matrix, SliceHeader &sliceheader, Paths3D &paths) {
-    for (auto path = paths.begin(); path != paths.end(); ++path) {
-        for (auto point = path->begin(); point != path->end(); ++point) {
-            applyTransformFull3D(*point, matrix);
-        }
-    }
-    std::string err = sliceheader.writeToFile(iop.f);
+std::string writeRecord(IOPaths &iop, TransformRecord &rec) {
+    std::string err = rec.sliceheader.writeToFile(iop.f);
     if (!err.empty()) { return err; }
-    if (!write3DPaths(iop, paths, PathOpen)) {
-        return std::string("Error writing 3D clipperpaths!!!");
+    if (rec.sliceheader.saveFormat == PATHFORMAT_DOUBLE_3D) {
+        if (!write3DPaths(iop, rec.paths3, PathOpen)) {
+            return std::string("Error while writing 3d clipperpaths!!!");
+        }
+    } else if (rec.saveAsInt64) {
+        if (!iop.writeClipperPaths(rec.ipaths, PathOpen)) {
+            return std::string("Error while writing int64 clipperpaths!!!");
+        }
+    } else {
+        if (!iop.writeDoublePaths(rec.dpaths, PathOpen)) {
+            return std::string("Error while writing double clipperpaths!!!");
+        }
     }
     return std::string();
 }
 
-std::string transformPaths(const char * filename, const char *outputname, TransformationMatrix matrix) {
+//limits for the size of each batch of records. At least one record is always read
+const int64 maxBatchBytes = 64 * 1024 * 1024;
+const int recordsPerThreadInBatch = 4;
+
+//joins the thread when going out of scope, so an exception cannot destroy it while it is still joinable (which would call std::terminate)
+typedef struct ThreadJoiner {
+    std::thread &thread;
+    ThreadJoiner(std::thread &t) : thread(t) {}
+    ~ThreadJoiner() { if (thread.joinable()) thread.join(); }
+} ThreadJoiner;
+
+/*the records are processed in batches: a batch is read and transformed in parallel
+while the previous one is written in a separate thread, to keep the original order*/
+std::string transformPaths(const char * filename, const char *outputname, TransformationMatrix matrix, int numthreads) {
     FILEOwner i(filename, "rb");
     if (!i.isopen()) { return str("Could not open input file ", filename); }
     IOPaths iop_f(i.f);
@@ -88,52 +154,48 @@ std::string transformPaths(const char * filename, const char *outputname, Transf
 
     fileheader.writeToFile(o.f, true);
 
-    bool is2DCompatible = transformationIs2DCOmpatible(matrix);
-    bool identityInZ, identityInXY;
-    if (is2DCompatible) {
-        identityInZ  = transform2DIsIdentityInZ (matrix);
-        identityInXY = transform2DIsIdentityInXY(matrix);
-    }
+    TransformSpec spec;
+    spec.matrix         = matrix;
+    spec.is2DCompatible = transformationIs2DCOmpatible(matrix);
+    spec.identityInZ    = spec.is2DCompatible && transform2DIsIdentityInZ (matrix);
+    spec.identityInXY   = spec.is2DCompatible && transform2DIsIdentityInXY(matrix);
 
-    SliceHeader sliceheader;
-    for (int currentRecord = 0; currentRecord < fileheader.numRecords; ++currentRecord) {
-        std::string err = sliceheader.readFromFile(i.f);
-        if (!err.empty()) { return str("Error reading ", currentRecord, "-th slice header: ", err); }
-        if (sliceheader.alldata.size() < 7) { return str("Error reading ", currentRecord, "-th slice header: header is too short!"); }
-        if (sliceheader.saveFormat == PATHFORMAT_INT64) {
-            DPaths paths;
-            clp::Paths paths_input;
-            if (!iop_f.readClipperPaths(paths_input)) {
-                return str("Error reading ", currentRecord, "-th integer clipperpaths: header is too short!");
-            }
-            paths.resize(paths_input.size());
-            for (int k = 0; k < paths.size(); ++k) {
-                paths[k].reserve(paths_input[k].size());
-                auto endp = paths_input[k].end();
-                for (auto point = paths_input[k].begin(); point != endp; ++point) {
-                    paths[k].push_back(clp::DoublePoint(point->X * sliceheader.scaling, point->Y * sliceheader.scaling));
-                }
-            }
-            err = transformAndSave(iop_o, matrix, is2DCompatible, identityInZ, identityInXY, sliceheader, paths, &paths_input);
-            if (!err.empty()) return err;
-        } else if (sliceheader.saveFormat == PATHFORMAT_DOUBLE) {
-            DPaths paths;
-            if (!iop_f.readDoublePaths(paths)) {
-                return str("Error reading ", currentRecord, "-th double clipperpaths: header is too short!");
-            }
-            err = transformAndSave(iop_o, matrix, is2DCompatible, identityInZ, identityInXY, sliceheader, paths, NULL);
-            if (!err.empty()) return err;
-        } else if (sliceheader.saveFormat == PATHFORMAT_DOUBLE_3D) {
-            Paths3D paths;
-            if (read3DPaths(iop_f, paths)) {
-                return str("Error reading ", currentRecord, "-th 3d clipperpaths: header is too short!");
-            }
-            err = transformAndSave(iop_o, matrix, sliceheader, paths);
-            if (!err.empty()) return err;
-        } else {
-            return str("error: ", currentRecord, "-th path in ", filename, " has an unknown save format type: ", sliceheader.saveFormat);
+    numthreads = getNumThreads(numthreads, (size_t)std::max(fileheader.numRecords, (int64)1));
+    size_t maxBatchRecords = numthreads * recordsPerThreadInBatch;
+
+    std::vector<TransformRecord> batch, written;
+    std::string readErr, writeErr;
+    std::thread writer;
+    ThreadJoiner joinWriter(writer);
+    int currentRecord = 0;
+    while (currentRecord < fileheader.numRecords && readErr.empty()) {
+        batch.clear();
+        int64 batchBytes = 0;
+        while ((currentRecord < fileheader.numRecords) && (batch.size() < maxBatchRecords) && (batchBytes < maxBatchBytes)) {
+            batch.emplace_back();
+            readErr = readRecord(i.f, iop_f, currentRecord, batch.back());
+            if (!readErr.empty()) { batch.pop_back(); break; }
+            batchBytes += batch.back().sliceheader.totalSize;
+            ++currentRecord;
         }
+
+        parallelFor(batch.size(), numthreads, [&spec, &batch](size_t idx, int) {
+            transformRecord(spec, batch[idx]);
+        });
+
+        if (writer.joinable()) writer.join();
+        if (!writeErr.empty()) return writeErr;
+        batch.swap(written);
+        writer = std::thread([&iop_o, &written, &writeErr]() {
+            for (auto &rec : written) {
+                writeErr = writeRecord(iop_o, rec);
+                if (!writeErr.empty()) break;
+            }
+        });
     }
+    if (writer.joinable()) writer.join();
+    if (!writeErr.empty()) return writeErr;
+    if (!readErr.empty()) return str(readErr, " in ", filename);
 
     return std::string();
 }
@@ -141,7 +203,8 @@ std::string transformPaths(const char * filename, const char *outputname, Transf
 const char *ERR =
 "\nArguments: PATHSFILENAME_INPUT PATHSFILENAME_OUTPUT TRANSFORMATION_MATRIX\n\n"
 "    -PATHSFILENAME_INPUT and PATHSFILENAME_OUTPUT are required (input/output paths file names).\n\n"
-"    -TRANSFORMATION_MATRIX is a sequence of 16 values specifying a row-wise transformation matrix. If the transformation rotates just over the Z axis, the resulting paths are 2D. Otherwise, 3D paths are generated.\n\n";
+"    -TRANSFORMATION_MATRIX is a sequence of 16 values specifying a row-wise transformation matrix. If the transformation rotates just over the Z axis, the resulting paths are 2D. Otherwise, 3D paths are generated.\n\n"
+"    -Optionally, 'threads NUMTHREADS' can be specified after the matrix to set the number of threads used to transform the records (default: as many as hardware threads).\n\n";
 
 void printError(ParamReader &rd) {
     rd.fmt << ERR;
@@ -170,12 +233,18 @@ int main(int argc, const char** argv) {
         if (!rd.readParam(matrix[i], i, "-th coefficient of the transformation matrix")) { printError(rd); return -1; }
     }
 
+    int numthreads = 0;
+    if (rd.argidx < rd.argc) {
+        if (!rd.readKeyword("threads", false, "'threads' keyword")) { printError(rd); return -1; }
+        if (!rd.readParam(numthreads, "number of threads"))         { printError(rd); return -1; }
+    }
+
     if (transformationSurelyIsAffine(matrix)) {
         fprintf(stderr, "The specified transformation matrix is not rigid!!!!");
         return -1;
     }
 
-    std::string err = transformPaths(pathsfilename_input, pathsfilename_output, matrix);
+    std::string err = transformPaths(pathsfilename_input, pathsfilename_output, matrix, numthreads);
 
     if (!err.empty()) {
         fprintf(stderr, "Error while trying to get a set of paths according to the specification: %s", err.c_str());
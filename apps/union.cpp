@@ -1,6 +1,121 @@
 #include "pathsfile.hpp"
 #include "apputil.hpp"
+#include <string.h>
+#include <deque>
+#include <queue>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
 
+//a whole record (header and payload) as raw bytes, with the fields used to sort it
+typedef struct RawRecord {
+    std::vector<char> data;
+    RecordIndexEntry entry;
+} RawRecord;
+
+/*reads the records of an input file in a background thread, keeping a bounded queue of records
+ready to be merged (there is always at least one record in the queue, even if it is bigger than the bound)*/
+class RecordReader {
+public:
+    RecordReader() : f(NULL), finished(false), stopping(false), queuedBytes(0) {}
+    ~RecordReader() { stop(); }
+    void start(FILE *_f, const char *_filename, int64 _numRecords) {
+        f = _f; filename = _filename; numRecords = _numRecords;
+        reader = std::thread(&RecordReader::readerLoop, this);
+    }
+    //waits until a record is available. Returns false if there are no more records or there was an error (then, err is set)
+    bool pop(RawRecord &record) {
+        std::unique_lock<std::mutex> lock(mutex);
+        notEmpty.wait(lock, [this] { return finished || !queue.empty(); });
+        if (queue.empty()) return false;
+        record = std::move(queue.front());
+        queue.pop_front();
+        queuedBytes -= record.data.size();
+        notFull.notify_one();
+        return true;
+    }
+    void stop() {
+        if (reader.joinable()) {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                stopping = true;
+            }
+            notFull.notify_one();
+            reader.join();
+        }
+    }
+    std::string err;
+protected:
+    static const size_t maxQueuedBytes = 32 * 1024 * 1024;
+    void readerLoop() {
+        std::string e;
+        for (int64 currentRecord = 0; currentRecord < numRecords; ++currentRecord) {
+            RawRecord record;
+            e = readRecord(record, currentRecord);
+            if (!e.empty()) break;
+            std::unique_lock<std::mutex> lock(mutex);
+            notFull.wait(lock, [this] { return stopping || queue.empty() || (queuedBytes < maxQueuedBytes); });
+            if (stopping) break;
+            queuedBytes += record.data.size();
+            queue.push_back(std::move(record));
+            notEmpty.notify_one();
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            err      = std::move(e);
+            finished = true;
+        }
+        notEmpty.notify_one();
+    }
+    std::string readRecord(RawRecord &record, int64 currentRecord) {
+        int64 sizes[2];
+        if (fread(sizes, sizeof(int64), 2, f) != 2) { return str("Error reading ", currentRecord, "-th slice header in file ", filename, ": could not read totalSize and headerSize"); }
+        int64 totalSize = sizes[0], headerSize = sizes[1];
+        if ((headerSize < (int64)(SliceHeader::numFields*sizeof(T64))) || (totalSize < headerSize)) {
+            return str("Error reading ", currentRecord, "-th slice header in file ", filename, ": bad header (totalSize: ", totalSize, ", headerSize: ", headerSize, ")");
+        }
+        record.data.resize((size_t)totalSize);
+        memcpy(&record.data.front(), sizes, sizeof(sizes));
+        size_t toread = (size_t)totalSize - sizeof(sizes);
+        if (fread(&record.data[sizeof(sizes)], 1, toread, f) != toread) { return str("error trying to read ", currentRecord, "-th slice (size: ", totalSize, ") in ", filename); }
+        T64 fields[SliceHeader::numFields];
+        memcpy(fields, &record.data.front(), sizeof(fields));
+        record.entry.totalSize  = totalSize;
+        record.entry.type       = fields[2].i;
+        record.entry.ntool      = fields[3].i;
+        record.entry.z          = fields[4].d;
+        record.entry.saveFormat = fields[5].i;
+        record.entry.scaling    = fields[6].d;
+        if (!record.entry.setBBFromPayload(record.data.data() + headerSize, (size_t)(totalSize - headerSize))) {
+            return str("Error reading ", currentRecord, "-th slice in file ", filename, ": malformed payload");
+        }
+        return std::string();
+    }
+    FILE *f;
+    const char *filename;
+    int64 numRecords;
+    std::thread reader;
+    std::mutex mutex;
+    std::condition_variable notEmpty, notFull;
+    std::deque<RawRecord> queue;
+    bool finished, stopping;
+    size_t queuedBytes;
+};
+
+//order of the records in the output: by z, then ntool, then type. Ties are resolved in favor of the first input file
+typedef std::pair<RawRecord*, int> MergeCandidate;
+struct MergeOrder {
+    bool operator()(const MergeCandidate &a, const MergeCandidate &b) const { //priority_queue puts the greatest element on top, so this is the reverse order
+        RecordIndexEntry &ea = a.first->entry, &eb = b.first->entry;
+        if (ea.z     != eb.z)     return ea.z     > eb.z;
+        if (ea.ntool != eb.ntool) return ea.ntool > eb.ntool;
+        if (ea.type  != eb.type)  return ea.type  > eb.type;
+        return a.second > b.second;
+    }
+};
+
+/*the records of all inputs are merged by (z, ntool, type). The relative order of the records of each
+input is kept, so if all inputs are sorted, so is the output. The output also has a record index*/
 std::string pathUnion(const char ** inputs, int numinputs, const char * output) {
     std::vector<FILEOwner> is(numinputs);
     std::vector<FileHeader> fileheaders_i(numinputs);
@@ -33,36 +148,50 @@ std::string pathUnion(const char ** inputs, int numinputs, const char * output)
     if (!o.isopen()) { return str("Could not open output file ", output); }
     std::string err = fileheader_o.writeToFile(o.f, true);
     if (!err.empty()) { return str("Error writing file header for ", output, ": ", err); }
+    int64 offset = ftell64(o.f);
 
-    SliceHeader sliceheader;
-    std::vector<int64> data;
+    std::vector<RecordReader> readers(numinputs);
+    std::vector<RawRecord> heads(numinputs);
+    std::priority_queue<MergeCandidate, std::vector<MergeCandidate>, MergeOrder> candidates;
     for (int i = 0; i < numinputs; ++i) {
-        for (int currentRecord = 0; currentRecord < fileheaders_i[i].numRecords; ++currentRecord) {
-            std::string err = sliceheader.readFromFile(is[i].f);
-            if (!err.empty()) { return str("Error reading ", currentRecord, "-th slice header in file ", inputs[i], ": ", err); }
-            err = sliceheader.writeToFile(o.f);
-            if (!err.empty()) { return str("Error writing ", currentRecord, "-th slice header in file ", inputs[i], " to file ", output, ": ", err); }
-
-            int numPackets = (int)((sliceheader.totalSize - sliceheader.headerSize) / sizeof(int64));
-            data.resize(numPackets);
-            size_t numread = fread(&(data[0]), sizeof(int64), numPackets, is[i].f);
-            if (numread != numPackets) {
-                return str("error trying to read ", currentRecord, "-th slice payload (size: ", numPackets, " but read ", numread, ") in ", inputs[i]);
-            }
-            size_t numwrite = fwrite(&(data[0]), sizeof(int64), numPackets, o.f);
-            if (numwrite != numPackets) {
-                return str("error trying to write ", currentRecord, "-th slice payload (size: ", numPackets, " but write ", numwrite, ") to ", output);
-            }
+        readers[i].start(is[i].f, inputs[i], fileheaders_i[i].numRecords);
+        if (readers[i].pop(heads[i])) {
+            candidates.push(MergeCandidate(&heads[i], i));
+        } else if (!readers[i].err.empty()) {
+            return readers[i].err;
         }
     }
 
+    RecordIndex index;
+    index.entries.reserve(fileheader_o.numRecords);
+    while (!candidates.empty()) {
+        int i = candidates.top().second;
+        candidates.pop();
+        RawRecord &record = heads[i];
+        if (fwrite(&record.data.front(), 1, record.data.size(), o.f) != record.data.size()) {
+            return str("error trying to write ", index.entries.size(), "-th slice (size: ", record.data.size(), ") from ", inputs[i], " to ", output);
+        }
+        record.entry.offset = offset;
+        offset += record.entry.totalSize;
+        index.entries.push_back(record.entry);
+        if (readers[i].pop(heads[i])) {
+            candidates.push(MergeCandidate(&heads[i], i));
+        } else if (!readers[i].err.empty()) {
+            return readers[i].err;
+        }
+    }
+
+    err = index.writeToFile(o.f);
+    if (!err.empty()) { return str("Error writing the record index to ", output, ": ", err); }
+
     return std::string();
 }
 
 const char *ERR =
 "\nArguments: [PATHSFILENAME_INPUT]+ PATHSFILENAME_OUTPUT\n\n"
 "    -PATHSFILENAME_INPUT: two or more file names of input pathsfiles.\n\n"
-"    -PATHSFILENAME_OUTPUT: file name of output pathsfiles.\n\n";
+"    -PATHSFILENAME_OUTPUT: file name of output pathsfiles.\n\n"
+"The records of the inputs are merged ordered by Z, tool number and type (the records of each input keep their relative order), and a record index is appended to the output.\n\n";
 
 void printError(ParamReader &rd) {
     rd.fmt << ERR;
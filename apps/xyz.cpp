@@ -1,42 +1,150 @@
 #include "pathsfile.hpp"
 #include "simpleparsing.hpp"
 #include "apputil.hpp"
-#include <fstream>
+#include "mappedfile.hpp"
+#include "fastformat.hpp"
+#include "parallel.hpp"
+#include <stdint.h>
+
+/*equivalent to strtod() applied to the token [begin, end), which is not null-terminated. Plain decimal numbers
+with at most 19 significant digits and small exponents are converted exactly with a single multiplication
+or division (both operands are exact doubles, so the result is correctly rounded). Anything else is delegated to strtod()*/
+double parseDouble(const char *begin, const char *end) {
+    static const double powersOf10[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+    const char *p = begin;
+    bool negative = false;
+    if ((p != end) && ((*p == '-') || (*p == '+'))) { negative = *p == '-'; ++p; }
+    uint64_t mantissa = 0;
+    int significant = 0, exp10 = 0, numdigits = 0;
+    bool fast = true;
+    for (; (p != end) && (*p >= '0') && (*p <= '9'); ++p, ++numdigits) {
+        if ((mantissa != 0) || (*p != '0')) {
+            if (++significant > 19) { fast = false; break; }
+            mantissa = mantissa * 10 + (*p - '0');
+        }
+    }
+    if (fast && (p != end) && (*p == '.')) {
+        for (++p; (p != end) && (*p >= '0') && (*p <= '9'); ++p, ++numdigits) {
+            if ((mantissa != 0) || (*p != '0')) {
+                if (++significant > 19) { fast = false; break; }
+                mantissa = mantissa * 10 + (*p - '0');
+            }
+            --exp10;
+        }
+    }
+    if (fast && (numdigits > 0) && (p != end) && ((*p == 'e') || (*p == 'E'))) {
+        ++p;
+        bool negexp = false;
+        if ((p != end) && ((*p == '-') || (*p == '+'))) { negexp = *p == '-'; ++p; }
+        int e = 0, expdigits = 0;
+        for (; (p != end) && (*p >= '0') && (*p <= '9'); ++p, ++expdigits) {
+            if (e < 10000) e = e * 10 + (*p - '0');
+        }
+        if (expdigits == 0) fast = false;
+        exp10 += negexp ? -e : e;
+    }
+    fast = fast && (numdigits > 0) && (p == end) && (mantissa <= (1ULL << 53)) && (exp10 >= -22) && (exp10 <= 22);
+    if (fast) {
+        double value = (double)mantissa;
+        value = (exp10 < 0) ? value / powersOf10[-exp10] : value * powersOf10[exp10];
+        return negative ? -value : value;
+    }
+    char buffer[64];
+    size_t len = end - begin;
+    if (len < sizeof(buffer)) {
+        memcpy(buffer, begin, len);
+        buffer[len] = 0;
+        return strtod(buffer, NULL);
+    }
+    std::string token(begin, end);
+    return strtod(token.c_str(), NULL);
+}
 
-#include <boost/tokenizer.hpp>
-using boost::tokenizer;
-using boost::escaped_list_separator;
-typedef escaped_list_separator<char> sep;
+//a piece of a xyz file, made of whole lines
+typedef struct XYZChunk {
+    const char *begin, *end;
+    std::vector<double> xyz;  //x, y, z values of each point
+    int numlines;             //number of lines with values in the chunk (this is what is counted for error messages)
+    const char *errline;      //if not NULL, the chunk has a line which cannot be converted to three values
+    const char *errlineEnd;
+    std::vector<char> output; //for use by the caller
+} XYZChunk;
+
+inline bool isXYZSeparator(char c) { return (c == ',') || (c == ';') || (c == ' ') || (c == '\t') || (c == '\r'); }
+
+//a line is valid if it has at least three values (the remaining values are ignored, to allow for point cloud files with more than 3 fields), and it is skipped if it has no values
+void parseXYZChunk(XYZChunk &chunk) {
+    chunk.xyz.clear();
+    chunk.numlines = 0;
+    chunk.errline  = NULL;
+    const char *p = chunk.begin, *end = chunk.end;
+    chunk.xyz.reserve((end - p) / 16);
+    while (p < end) {
+        const char *lineStart = p;
+        const char *lineEnd   = (const char*)memchr(p, '\n', end - p);
+        if (lineEnd == NULL) lineEnd = end;
+        double values[3];
+        int numvalues = 0;
+        while ((p < lineEnd) && (numvalues < 3)) {
+            while ((p < lineEnd) && isXYZSeparator(*p)) ++p;
+            const char *tokenStart = p;
+            while ((p < lineEnd) && !isXYZSeparator(*p)) ++p;
+            if (p > tokenStart) values[numvalues++] = parseDouble(tokenStart, p);
+        }
+        p = lineEnd + 1;
+        if (numvalues == 0) continue;
+        ++chunk.numlines;
+        if (numvalues != 3) {
+            chunk.errline    = lineStart;
+            chunk.errlineEnd = (lineEnd > lineStart) && (lineEnd[-1] == '\r') ? lineEnd - 1 : lineEnd;
+            return;
+        }
+        chunk.xyz.insert(chunk.xyz.end(), values, values + 3);
+    }
+}
 
-//algorithm to iterate over a xyz file
-template<typename Function> std::string withXYZDo(const char *inputfilename, int &nline, Function function) {
-    sep pointsep("", ",; \t", "");
+const size_t XYZ_CHUNK_SIZE = 8 * 1024 * 1024;
 
-    std::string line;
-    std::ifstream f(inputfilename);
+/*algorithm to iterate over a xyz file: the file is memory-mapped and split in chunks at line boundaries. The chunks are
+processed in batches: the chunks of a batch are parsed and given to process(chunk, numthread) in parallel, then
+given to consume(chunk) in order in the calling thread. If there is an error in a line, the points before it are
+still processed and consumed*/
+template<typename Process, typename Consume> std::string withXYZDo(const char *inputfilename, int numthreads, int &nline, Process process, Consume consume) {
+    MappedFile file;
     nline = 0;
-    std::vector<double> xyz;
-    xyz.reserve(3);
-    while (getline(f, line)) {
-        xyz.clear();
-
-        tokenizer<sep> tok(line, pointsep);
-
-        for (tokenizer<sep>::iterator it = tok.begin(); it != tok.end(); ++it) {
-            if (!it->empty()) {
-                xyz.push_back(strtod(it->c_str(), NULL));
+    if (!file.openForReading(inputfilename)) {
+        return str("Could not open file ", inputfilename, ", or it has no points");
+    }
+    const char *data = file.data(), *dataEnd = data + file.size();
+
+    numthreads = getNumThreads(numthreads, (file.size() + XYZ_CHUNK_SIZE - 1) / XYZ_CHUNK_SIZE);
+    std::vector<XYZChunk> chunks(numthreads);
+    const char *next = data;
+    while (next < dataEnd) {
+        size_t numchunks = 0;
+        for (; (numchunks < chunks.size()) && (next < dataEnd); ++numchunks) {
+            chunks[numchunks].begin = next;
+            if ((size_t)(dataEnd - next) <= XYZ_CHUNK_SIZE) {
+                next = dataEnd;
+            } else {
+                const char *newline = (const char*)memchr(next + XYZ_CHUNK_SIZE, '\n', dataEnd - (next + XYZ_CHUNK_SIZE));
+                next = (newline == NULL) ? dataEnd : newline + 1;
             }
-            if (xyz.size() == 3) break; //allow for point cloud files with more than 3 fields
+            chunks[numchunks].end = next;
         }
-
-        if (xyz.empty()) continue;
-
-        ++nline;
-        if (xyz.size() != 3) {
-            return str("In file ", inputfilename, ", line ", nline, " cannot be converted to three input values: ", line, "\n");
+        parallelFor(numchunks, numthreads, [&chunks, &process](size_t idx, int numthread) {
+            parseXYZChunk(chunks[idx]);
+            process(chunks[idx], numthread);
+        });
+        for (size_t k = 0; k < numchunks; ++k) {
+            XYZChunk &chunk = chunks[k];
+            consume(chunk);
+            nline += chunk.numlines;
+            if (chunk.errline != NULL) {
+                return str("In file ", inputfilename, ", line ", nline, " cannot be converted to three input values: ", std::string(chunk.errline, chunk.errlineEnd), "\n");
+            }
         }
-
-        function(xyz);
     }
 
     if (nline == 0) {
@@ -55,21 +163,35 @@ typedef struct Limits {
     double maxz = -std::numeric_limits<double>::infinity();
 } Limits;
 
-std::string bbxyz(const char *inputfilename) {
-    Limits lims;
-
-    auto getLimits = [&lims](std::vector<double> &xyz) {
-        lims.minx = fmin(lims.minx, xyz[0]);
-        lims.maxx = fmax(lims.maxx, xyz[0]);
-        lims.miny = fmin(lims.miny, xyz[1]);
-        lims.maxy = fmax(lims.maxy, xyz[1]);
-        lims.minz = fmin(lims.minz, xyz[2]);
-        lims.maxz = fmax(lims.maxz, xyz[2]);
+std::string bbxyz(const char *inputfilename, int numthreads) {
+    //each thread computes its own limits, they are merged at the end
+    std::vector<Limits> limsByThread(getNumThreads(numthreads, std::numeric_limits<size_t>::max()));
+
+    auto getLimits = [&limsByThread](XYZChunk &chunk, int numthread) {
+        Limits &lims = limsByThread[numthread];
+        for (auto xyz = chunk.xyz.begin(); xyz != chunk.xyz.end(); xyz += 3) {
+            lims.minx = fmin(lims.minx, xyz[0]);
+            lims.maxx = fmax(lims.maxx, xyz[0]);
+            lims.miny = fmin(lims.miny, xyz[1]);
+            lims.maxy = fmax(lims.maxy, xyz[1]);
+            lims.minz = fmin(lims.minz, xyz[2]);
+            lims.maxz = fmax(lims.maxz, xyz[2]);
+        }
     };
 
     int nline;
 
-    std::string res = withXYZDo(inputfilename, nline, getLimits);
+    std::string res = withXYZDo(inputfilename, numthreads, nline, getLimits, [](XYZChunk &) {});
+
+    Limits lims;
+    for (auto &l : limsByThread) {
+        lims.minx = fmin(lims.minx, l.minx);
+        lims.maxx = fmax(lims.maxx, l.maxx);
+        lims.miny = fmin(lims.miny, l.miny);
+        lims.maxy = fmax(lims.maxy, l.maxy);
+        lims.minz = fmin(lims.minz, l.minz);
+        lims.maxz = fmax(lims.maxz, l.maxz);
+    }
 
     if (res.empty()) {
         fprintf(stdout, "number of points: %d\n", nline);
@@ -83,38 +205,114 @@ std::string bbxyz(const char *inputfilename) {
 
 }
 
+bool isSTLFile(const char *filename) {
+    size_t len = strlen(filename);
+    return (len >= 4) && (tolower(filename[len - 4]) == '.') && (tolower(filename[len - 3]) == 's') && (tolower(filename[len - 2]) == 't') && (tolower(filename[len - 1]) == 'l');
+}
+
+//meshes (binary STL) are also accepted, working on their vertices
+std::string bbSTL(const char *inputfilename) {
+    TriangleMesh mesh;
+    std::string res = readTriangleMeshFromSTL(inputfilename, mesh);
+    if (!res.empty()) return res;
+
+    Limits lims;
+    for (auto &p : mesh.points) {
+        lims.minx = fmin(lims.minx, p.x);
+        lims.maxx = fmax(lims.maxx, p.x);
+        lims.miny = fmin(lims.miny, p.y);
+        lims.maxy = fmax(lims.maxy, p.y);
+        lims.minz = fmin(lims.minz, p.z);
+        lims.maxz = fmax(lims.maxz, p.z);
+    }
+
+    fprintf(stdout, "number of vertices: " FMTSIZET "\n", mesh.points.size());
+    fprintf(stdout, "number of triangles: " FMTSIZET "\n", mesh.triangles.size());
+    fprintf(stdout, "bounding box:\n");
+    fprintf(stdout, "X: %25.20g %25.20g\n", lims.minx, lims.maxx);
+    fprintf(stdout, "Y: %25.20g %25.20g\n", lims.miny, lims.maxy);
+    fprintf(stdout, "Z: %25.20g %25.20g\n", lims.minz, lims.maxz);
+
+    return res;
+}
+
 //const int mlen = 16; //for true matrix
 const int mlen = 12; //do not care about the last row of the transformation matrix
 //the matrix is specified row-wise
 typedef double TransformationMatrix[mlen];
 
-std::string transformAndSave(const char *input, const char *output, TransformationMatrix matrix) {
+//same output as fprintf(f, "%.20g", value)
+inline void appendDouble(std::vector<char> &out, double value) {
+    size_t used = out.size();
+    out.resize(used + 40);
+    int n = formatDoubleGeneral(&out[used], value, 20);
+    if (n < 0) n = snprintf(&out[used], 40, "%.20g", value);
+    out.resize(used + n);
+}
+
+std::string transformAndSave(const char *input, const char *output, TransformationMatrix matrix, int numthreads) {
     FILEOwner o(output, "w");
     if (!o.isopen()) { return str("Could not open output file ", output); }
 
-    auto doTransform = [matrix, &o](std::vector<double> &xyz) {
-        double x = (matrix[0] * xyz[0]) + (matrix[1] * xyz[1]) + (matrix[2] * xyz[2]) + matrix[3];
-        double y = (matrix[4] * xyz[0]) + (matrix[5] * xyz[1]) + (matrix[6] * xyz[2]) + matrix[7];
-        double z = (matrix[8] * xyz[0]) + (matrix[9] * xyz[1]) + (matrix[10] * xyz[2]) + matrix[11];
+    //the points are transformed and formatted in parallel, and written in order
+    auto doTransform = [matrix](XYZChunk &chunk, int) {
+        chunk.output.clear();
+        chunk.output.reserve(chunk.xyz.size() * 24);
+        for (auto xyz = chunk.xyz.begin(); xyz != chunk.xyz.end(); xyz += 3) {
+            double x = (matrix[0] * xyz[0]) + (matrix[1] * xyz[1]) + (matrix[2] * xyz[2]) + matrix[3];
+            double y = (matrix[4] * xyz[0]) + (matrix[5] * xyz[1]) + (matrix[6] * xyz[2]) + matrix[7];
+            double z = (matrix[8] * xyz[0]) + (matrix[9] * xyz[1]) + (matrix[10] * xyz[2]) + matrix[11];
+
+            appendDouble(chunk.output, x); chunk.output.push_back(' ');
+            appendDouble(chunk.output, y); chunk.output.push_back(' ');
+            appendDouble(chunk.output, z); chunk.output.push_back('\n');
+        }
+    };
 
-        fprintf(o.f, "%.20g %.20g %.20g\n", x, y, z);
+    bool writeFailed = false;
+    auto doWrite = [&o, &writeFailed](XYZChunk &chunk) {
+        if (!chunk.output.empty() && !writeFailed) {
+            writeFailed = fwrite(&chunk.output.front(), 1, chunk.output.size(), o.f) != chunk.output.size();
+        }
     };
 
     int nline;
 
-    std::string res = withXYZDo(input, nline, doTransform);
+    std::string res = withXYZDo(input, numthreads, nline, doTransform, doWrite);
+
+    if (res.empty() && writeFailed) {
+        res = str("Could not write to output file ", output);
+    }
 
     return res;
 }
 
+std::string transformAndSaveSTL(const char *input, const char *output, TransformationMatrix matrix) {
+    TriangleMesh mesh;
+    std::string res = readTriangleMeshFromSTL(input, mesh);
+    if (!res.empty()) return res;
+
+    for (auto &p : mesh.points) {
+        double x = (matrix[0] * p.x) + (matrix[1] * p.y) + (matrix[2] * p.z) + matrix[3];
+        double y = (matrix[4] * p.x) + (matrix[5] * p.y) + (matrix[6] * p.z) + matrix[7];
+        double z = (matrix[8] * p.x) + (matrix[9] * p.y) + (matrix[10] * p.z) + matrix[11];
+        p.x = x;
+        p.y = y;
+        p.z = z;
+    }
+
+    return writeTriangleMeshToSTL(output, mesh);
+}
+
 
 const char *ERR =
 "\nArguments: INPUTFILENAME (bb | transform OUTPUTFILENAME TRANSFORMATION_MATRIX)\n\n"
-"    -INPUTFILENAME is required (point cloud in xyz format).\n\n"
+"    -INPUTFILENAME is required (point cloud in xyz format). It can also be a mesh in binary STL format (extension .stl): then, the operations are applied to its vertices, and the output of 'transform' is also a binary STL file.\n\n"
 "    -if second argument is 'bb', compute the bounding box of the point cloud.\n\n"
 "    -if second argument is 'transform':\n\n"
 "    -OUTPUTFILENAME is the name of the transformed point cloud in xyz format.\n\n"
 "    -TRANSFORMATION_MATRIX is a sequence of 16 values specifying a row-wise transformation matrix.\n\n"
+"    -Optionally, 'threads NUMTHREADS' can be specified at the end to set the number of threads used to process point clouds (default: as many as hardware threads).\n\n"
 "This tool handles point clouds in xyz format.\n\n";
 
 void printError(ParamReader &rd) {
@@ -139,8 +337,15 @@ int main(int argc, const char **argv) {
 
     std::string err;
 
+    int numthreads = 0;
+    auto readNumThreads = [&rd, &numthreads]() {
+        if (rd.argidx >= rd.argc) return true;
+        return rd.readKeyword("threads", false, "'threads' keyword") && rd.readParam(numthreads, "number of threads");
+    };
+
     if        (strcmp(mode, "bb")==0) {
-        err = bbxyz(filename_input);
+        if (!readNumThreads())                                                               { printError(rd); return -1; }
+        err = isSTLFile(filename_input) ? bbSTL(filename_input) : bbxyz(filename_input, numthreads);
     } else if (strcmp(mode, "transform") == 0) {
         const char *filename_output;
         TransformationMatrix matrix;
@@ -149,8 +354,13 @@ int main(int argc, const char **argv) {
         for (int i = 0; i < mlen; ++i) {
             if (!rd.readParam(matrix[i], i, "-th coefficient of the transformation matrix")) { printError(rd); return -1; }
         }
+        if (!readNumThreads())                                                               { printError(rd); return -1; }
 
-        err = transformAndSave(filename_input, filename_output, matrix);
+        if (isSTLFile(filename_input)) {
+            err = transformAndSaveSTL(filename_input, filename_output, matrix);
+        } else {
+            err = transformAndSave(filename_input, filename_output, matrix, numthreads);
+        }
 
     } else {
         fprintf(stderr, "mode parameter must be either 'bb' or 'transform', but was %s\n", mode);
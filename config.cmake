@@ -14,6 +14,7 @@ option(MAKEMR_FILESPLITTER  "make a grid splitter for paths files"  ON)
 option(MAKEMR_FILEINFO      "make info dumper for paths files"  ON)
 option(MAKEMR_FILEUNION     "make tool to merge several paths files into one"  ON)
 option(MAKEMR_FILETOUCH     "make slice header setter for paths files"  ON)
+option(MAKEMR_STUBSLICER    "make a minimal slicer which speaks the same protocol as the external slicer (used in the tests)"  ON)
 
 #AutoCAD configuration
 set(AUTOCAD_PATH_PREFIX        "" CACHE PATH "path to AutoCAD libraries and executables (accoremgd.dll et al)")
@@ -0,0 +1,215 @@
+#include "daemon.hpp"
+#include "config.hpp"
+
+#include <stdio.h>
+#include <stdexcept>
+
+#if defined(_WIN32) || defined(_WIN64)
+
+std::string serveJobsOnSocket(const std::string &socketpath, int maxjobs, JobRunner runJob) {
+    return std::string("daemon mode is not available in Windows");
+}
+
+#else
+
+#  include <unistd.h>
+#  include <errno.h>
+#  include <string.h>
+#  include <signal.h>
+#  include <sys/types.h>
+#  include <sys/stat.h>
+#  include <sys/select.h>
+#  include <sys/socket.h>
+#  include <sys/un.h>
+#  include <sys/wait.h>
+
+//a job description is not expected to be very long, this is just a safeguard against rogue clients
+#define MAX_JOB_LENGTH (1024*1024)
+
+static bool readJobLine(int conn, std::string &job) {
+    char buffer[4096];
+    job.clear();
+    while (job.size() < MAX_JOB_LENGTH) {
+        ssize_t n = read(conn, buffer, sizeof(buffer));
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        if (n == 0) break;
+        char *endline = (char*)memchr(buffer, '\n', n);
+        if (endline != NULL) {
+            job.append(buffer, endline - buffer);
+            break;
+        }
+        job.append(buffer, n);
+    }
+    if (!job.empty() && job.back() == '\r') job.pop_back();
+    return !job.empty();
+}
+
+static void writeToConnection(int conn, const std::string &msg) {
+    ssize_t ignored = write(conn, msg.c_str(), msg.size());
+    (void)ignored;
+}
+
+/*if there is something at socketpath, remove it only if it is a socket nobody is listening on
+(i.e., left behind by a server which did not shut down cleanly)*/
+static std::string removeStaleSocket(const std::string &socketpath, struct sockaddr_un &addr) {
+    struct stat st;
+    if (lstat(socketpath.c_str(), &st) != 0) {
+        if (errno == ENOENT) return std::string();
+        return str("could not check socket path ", socketpath, ": ", strerror(errno));
+    }
+    if (!S_ISSOCK(st.st_mode)) {
+        return str("could not use ", socketpath, " as socket path: it already exists and it is not a socket");
+    }
+    int probe = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (probe < 0) return str("could not create socket: ", strerror(errno));
+    int connected = connect(probe, (struct sockaddr*)&addr, sizeof(addr));
+    int connecterr = errno;
+    close(probe);
+    if (connected == 0) {
+        return str("there is already a server listening on socket ", socketpath);
+    }
+    if (connecterr != ECONNREFUSED) {
+        return str("could not check whether socket ", socketpath, " is stale: ", strerror(connecterr));
+    }
+    if (unlink(socketpath.c_str()) != 0) {
+        return str("could not remove stale socket ", socketpath, ": ", strerror(errno));
+    }
+    return std::string();
+}
+
+//the handler does nothing, SIGCHLD is caught just to interrupt pselect() when a worker finishes
+static void onChildFinished(int) {}
+
+std::string serveJobsOnSocket(const std::string &socketpath, int maxjobs, JobRunner runJob) {
+    struct sockaddr_un addr;
+    if (socketpath.size() >= sizeof(addr.sun_path)) {
+        return str("socket path is too long: ", socketpath);
+    }
+    if (maxjobs < 1) maxjobs = 1;
+
+    int server = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (server < 0) return str("could not create socket: ", strerror(errno));
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, socketpath.c_str());
+    std::string stale = removeStaleSocket(socketpath, addr);
+    if (!stale.empty()) {
+        close(server);
+        return stale;
+    }
+    if (bind(server, (struct sockaddr*)&addr, sizeof(addr)) != 0) {
+        std::string err = str("could not bind socket to ", socketpath, ": ", strerror(errno));
+        close(server);
+        return err;
+    }
+    if (listen(server, 16) != 0) {
+        std::string err = str("could not listen on socket ", socketpath, ": ", strerror(errno));
+        close(server);
+        unlink(socketpath.c_str());
+        return err;
+    }
+
+    /*SIGCHLD is blocked except while waiting in pselect(), so a worker finishing at any time either
+    interrupts the wait or is noticed before it starts, and it is reaped without waiting for the next job*/
+    sigset_t blockchld, oldmask, waitmask;
+    sigemptyset(&blockchld);
+    sigaddset(&blockchld, SIGCHLD);
+    sigprocmask(SIG_BLOCK, &blockchld, &oldmask);
+    waitmask = oldmask;
+    sigdelset(&waitmask, SIGCHLD);
+    struct sigaction onchld, oldchld;
+    memset(&onchld, 0, sizeof(onchld));
+    onchld.sa_handler = onChildFinished;
+    sigemptyset(&onchld.sa_mask);
+    sigaction(SIGCHLD, &onchld, &oldchld);
+
+    std::string err;
+    int numjobs = 0;
+    while (true) {
+        //reap finished workers, blocking until one finishes if there are too many
+        while (numjobs > 0) {
+            pid_t pid = waitpid(-1, NULL, numjobs >= maxjobs ? 0 : WNOHANG);
+            if (pid <= 0) break;
+            --numjobs;
+        }
+
+        fd_set readable;
+        FD_ZERO(&readable);
+        FD_SET(server, &readable);
+        if (pselect(server + 1, &readable, NULL, NULL, NULL, &waitmask) < 0) {
+            if (errno == EINTR) continue;
+            err = str("error waiting for connections on socket ", socketpath, ": ", strerror(errno));
+            break;
+        }
+
+        int conn = accept(server, NULL, NULL);
+        if (conn < 0) {
+            if (errno == EINTR) continue;
+            err = str("error accepting connections on socket ", socketpath, ": ", strerror(errno));
+            break;
+        }
+
+        std::string job;
+        if (!readJobLine(conn, job)) {
+            close(conn);
+            continue;
+        }
+        if (job.compare(JOB_SHUTDOWN) == 0) {
+            close(conn);
+            break;
+        }
+
+        //avoid duplicating buffered output in the worker
+        fflush(stdout);
+        fflush(stderr);
+        pid_t pid = fork();
+        if (pid < 0) {
+            writeToConnection(conn, str("Could not start worker for the job: ", strerror(errno), "\n", JOB_EXIT_TAG, " -1\n"));
+            close(conn);
+            continue;
+        }
+        if (pid == 0) {
+            //worker process: the job may start its own subprocesses, so restore the usual SIGCHLD handling
+            close(server);
+            sigaction(SIGCHLD, &oldchld, NULL);
+            sigprocmask(SIG_SETMASK, &oldmask, NULL);
+            //if the client goes away, keep doing the job
+            signal(SIGPIPE, SIG_IGN);
+            dup2(conn, STDOUT_FILENO);
+            dup2(conn, STDERR_FILENO);
+            close(conn);
+            int ret;
+            try {
+                ret = runJob(job);
+            } catch (std::exception &e) {
+                fprintf(stderr, "Unhandled exception in job: %s\n", e.what());
+                ret = -1;
+            }
+            fflush(stderr);
+            printf("%s %d\n", JOB_EXIT_TAG, ret);
+            fflush(stdout);
+            _exit(0);
+        }
+        ++numjobs;
+        close(conn);
+    }
+
+    close(server);
+    unlink(socketpath.c_str());
+    while (numjobs > 0) {
+        if (waitpid(-1, NULL, 0) > 0) {
+            --numjobs;
+        } else if (errno != EINTR) {
+            break;
+        }
+    }
+    sigaction(SIGCHLD, &oldchld, NULL);
+    sigprocmask(SIG_SETMASK, &oldmask, NULL);
+    return err;
+}
+
+#endif
@@ -0,0 +1,24 @@
+#ifndef DAEMON_HEADER
+#define DAEMON_HEADER
+
+#include <string>
+#include <functional>
+
+//the last line written to the client for each job is JOB_EXIT_TAG followed by the job's return code
+#define JOB_EXIT_TAG "JOB FINISHED WITH CODE"
+//if a client sends this line instead of a job, the server shuts down
+#define JOB_SHUTDOWN "SHUTDOWN"
+
+typedef std::function<int(std::string &job)> JobRunner;
+
+/*listen on a Unix domain socket for jobs. A job is a single line of text sent by the client.
+Each job is run in a worker process forked from the server (so all state set up before calling
+this function is inherited by the worker without having to be recomputed), with the standard
+output and error redirected to the client. At most maxjobs workers are alive at the same time.
+Finished workers are reaped as soon as they exit. If socketpath already exists, it is removed only
+if it is a stale socket (nobody is listening on it); otherwise, this is an error.
+This function returns only if there is an error, or if the client sends JOB_SHUTDOWN.
+Only available in POSIX systems*/
+std::string serveJobsOnSocket(const std::string &socketpath, int maxjobs, JobRunner runJob);
+
+#endif
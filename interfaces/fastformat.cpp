@@ -0,0 +1,306 @@
+#include "fastformat.hpp"
+#include <stdlib.h>
+#include <stdint.h>
+
+void TextBuffer::makeRoom(size_t n) {
+    flush();
+    if (data.size() < capacity) data.resize(capacity);
+    if (data.size() < n)        data.resize(n);
+}
+
+bool TextBuffer::flush() {
+    if (used > 0) {
+        if (f == NULL || fwrite(&data[0], sizeof(char), used, f) != used) failed = true;
+        used = 0;
+    }
+    bool ok = !failed;
+    failed = false;
+    return ok;
+}
+
+//the custom conversion is disabled in Windows because the C runtime's printf is not exact in some versions, and the goal is to have the same output as printf
+#if !(defined(_WIN32) || defined(_WIN64))
+
+/*decompose a non-negative double into an integer part and a binary fraction: value = integer + fraction/2^shift,
+with fraction < 2^shift. This is always exact, but it fails if the value is too big, too small, or not finite*/
+static inline bool decomposeDouble(uint64_t bits, uint64_t &integer, uint64_t &fraction, int &shift) {
+    int biasedExp     = (int)((bits >> 52) & 0x7ff);
+    uint64_t mantissa = bits & ((1ULL << 52) - 1);
+    if (biasedExp == 0x7ff) return false; //infinity or NaN
+    if (biasedExp == 0) {
+        if (mantissa != 0) return false; //subnormal
+        integer = fraction = 0;
+        shift   = 0;
+        return true;
+    }
+    mantissa |= 1ULL << 52;
+    int exp2 = biasedExp - 1075; //value = mantissa * 2^exp2
+    if (exp2 >= 0) {
+        if (exp2 > 10) return false; //the value does not fit in a signed 64-bit integer
+        integer  = mantissa << exp2;
+        fraction = 0;
+        shift    = 0;
+        return true;
+    }
+    shift = -exp2;
+    while ((shift > 0) && ((mantissa & 1) == 0)) {
+        mantissa >>= 1;
+        --shift;
+    }
+    //the fraction is multiplied by 10 to extract each decimal digit, so it must fit in 60 bits
+    if (shift > 60) return false;
+    integer  = (shift >= 53) ? 0 : (mantissa >> shift);
+    fraction = mantissa & ((1ULL << shift) - 1);
+    return true;
+}
+
+static inline uint64_t getBits(double value) {
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+//write the digits of value (reversed) in out, return the number of digits
+static inline int reversedDigits(char *out, uint64_t value) {
+    int n = 0;
+    do {
+        out[n++] = (char)('0' + (value % 10));
+        value /= 10;
+    } while (value != 0);
+    return n;
+}
+
+/*decide how to round the digits generated so far: 1 to round up, 0 to truncate,
+-1 if it is an exact tie (there are several valid rounding conventions, so we defer to printf)*/
+static inline int roundingDirection(uint64_t fraction, int shift) {
+    if ((shift == 0) || (fraction == 0)) return 0;
+    uint64_t half = 1ULL << (shift - 1);
+    if (fraction > half) return 1;
+    if (fraction < half) return 0;
+    return -1;
+}
+
+//increment a sequence of decimal digits, return true if there is a carry out of the first digit
+static inline bool incrementDigits(char *digits, int numdigits) {
+    for (int i = numdigits - 1; i >= 0; --i) {
+        if (digits[i] == '9') {
+            digits[i] = '0';
+        } else {
+            ++digits[i];
+            return false;
+        }
+    }
+    return true;
+}
+
+#define MAX_FAST_PRECISION 40
+
+int formatDoubleFixed(char *out, double value, int precision) {
+    if ((precision < 0) || (precision > MAX_FAST_PRECISION)) return -1;
+    uint64_t bits = getBits(value);
+    uint64_t integer, fraction;
+    int shift;
+    if (!decomposeDouble(bits, integer, fraction, shift)) return -1;
+    uint64_t mask = (shift == 0) ? 0 : ((1ULL << shift) - 1);
+
+    char frac[MAX_FAST_PRECISION];
+    for (int i = 0; i < precision; ++i) {
+        fraction *= 10;
+        frac[i]   = (char)('0' + (fraction >> shift));
+        fraction &= mask;
+    }
+    int dir = roundingDirection(fraction, shift);
+    if (dir < 0) return -1;
+    if (dir > 0) {
+        if (incrementDigits(frac, precision)) {
+            if (integer == UINT64_MAX) return -1;
+            ++integer;
+        }
+    }
+
+    char *p = out;
+    if (bits >> 63) *(p++) = '-';
+    char intdigits[24];
+    int n = reversedDigits(intdigits, integer);
+    while (n > 0) *(p++) = intdigits[--n];
+    if (precision > 0) {
+        *(p++) = '.';
+        memcpy(p, frac, precision);
+        p += precision;
+    }
+    return (int)(p - out);
+}
+
+int formatDoubleGeneral(char *out, double value, int precision) {
+    if (precision == 0) precision = 1;
+    if ((precision < 0) || (precision > MAX_FAST_PRECISION)) return -1;
+    uint64_t bits = getBits(value);
+    uint64_t integer, fraction;
+    int shift;
+    if (!decomposeDouble(bits, integer, fraction, shift)) return -1;
+    uint64_t mask = (shift == 0) ? 0 : ((1ULL << shift) - 1);
+
+    char *p = out;
+    if (bits >> 63) *(p++) = '-';
+    if ((integer == 0) && (fraction == 0)) {
+        *(p++) = '0';
+        return (int)(p - out);
+    }
+
+    //generate exactly <precision> significant digits
+    char digits[MAX_FAST_PRECISION + 24];
+    int numdigits = 0;
+    int exp10;
+    if (integer > 0) {
+        char intdigits[24];
+        int n = reversedDigits(intdigits, integer);
+        //rounding inside the integer part is not supported
+        if (n > precision) return -1;
+        exp10 = n - 1;
+        while (n > 0) digits[numdigits++] = intdigits[--n];
+    } else {
+        exp10 = -1;
+        while (true) {
+            fraction *= 10;
+            char digit = (char)(fraction >> shift);
+            fraction &= mask;
+            if (digit != 0) {
+                digits[numdigits++] = (char)('0' + digit);
+                break;
+            }
+            --exp10;
+        }
+    }
+    while (numdigits < precision) {
+        fraction *= 10;
+        digits[numdigits++] = (char)('0' + (fraction >> shift));
+        fraction &= mask;
+    }
+    int dir = roundingDirection(fraction, shift);
+    if (dir < 0) return -1;
+    if (dir > 0) {
+        if (incrementDigits(digits, numdigits)) {
+            digits[0] = '1';
+            ++exp10;
+        }
+    }
+
+    //remove trailing zeros, as printf does for %g
+    while ((numdigits > 1) && (digits[numdigits - 1] == '0')) --numdigits;
+
+    if ((exp10 < -4) || (exp10 >= precision)) {
+        *(p++) = digits[0];
+        if (numdigits > 1) {
+            *(p++) = '.';
+            memcpy(p, digits + 1, numdigits - 1);
+            p += numdigits - 1;
+        }
+        *(p++) = 'e';
+        *(p++) = (exp10 < 0) ? '-' : '+';
+        int absexp = (exp10 < 0) ? -exp10 : exp10;
+        char expdigits[8];
+        int n = reversedDigits(expdigits, (uint64_t)absexp);
+        if (n < 2) expdigits[n++] = '0';
+        while (n > 0) *(p++) = expdigits[--n];
+    } else if (exp10 >= 0) {
+        int numint = exp10 + 1;
+        for (int i = 0; i < numint; ++i) *(p++) = (i < numdigits) ? digits[i] : '0';
+        if (numdigits > numint) {
+            *(p++) = '.';
+            memcpy(p, digits + numint, numdigits - numint);
+            p += numdigits - numint;
+        }
+    } else {
+        *(p++) = '0';
+        *(p++) = '.';
+        for (int i = -1; i > exp10; --i) *(p++) = '0';
+        memcpy(p, digits, numdigits);
+        p += numdigits;
+    }
+    return (int)(p - out);
+}
+
+#else
+
+int formatDoubleFixed  (char *out, double value, int precision) { return -1; }
+int formatDoubleGeneral(char *out, double value, int precision) { return -1; }
+
+#endif
+
+void FormatPlan::compile(std::string _format) {
+    format    = std::move(_format);
+    supported = true;
+    segments.clear();
+    const char *c = format.c_str();
+    std::string literal;
+    while (*c != 0) {
+        if (*c != '%') {
+            literal.push_back(*(c++));
+            continue;
+        }
+        ++c;
+        if (*c == '%') {
+            literal.push_back(*(c++));
+            continue;
+        }
+        if (!literal.empty()) {
+            segments.push_back(Segment(Literal));
+            segments.back().literal = std::move(literal);
+            literal.clear();
+        }
+        if ((*c == 'd') || (*c == 'c')) {
+            segments.push_back(Segment((*c == 'd') ? Integer : Character));
+            ++c;
+            continue;
+        }
+        //the only other supported conversions are %.Nf and %.Ng
+        if (*c != '.') { supported = false; return; }
+        ++c;
+        char *end;
+        long precision = strtol(c, &end, 10);
+        if ((end == c) || (precision > MAX_FAST_PRECISION)) { supported = false; return; }
+        c = end;
+        if ((*c != 'f') && (*c != 'g')) { supported = false; return; }
+        segments.push_back(Segment((*c == 'f') ? Fixed : General, (int)precision));
+        ++c;
+    }
+    if (!literal.empty()) {
+        segments.push_back(Segment(Literal));
+        segments.back().literal = std::move(literal);
+    }
+}
+
+//big enough for any double printed with %.Nf (N<=MAX_FAST_PRECISION)
+#define MAX_RENDER_SIZE 400
+
+void FormatPlan::render(TextBuffer &out, FormatArg *vals, int numvals) {
+    int nval = 0;
+    for (auto &segment : segments) {
+        switch (segment.type) {
+        case Literal:
+            out.append(segment.literal.c_str(), segment.literal.size());
+            break;
+        case Integer:
+            out.commit(snprintf(out.reserve(32), 32, "%lld", nval < numvals ? vals[nval].i : 0LL));
+            ++nval;
+            break;
+        case Character:
+            *out.reserve(1) = (char)(nval < numvals ? vals[nval].i : 0);
+            out.commit(1);
+            ++nval;
+            break;
+        case Fixed:
+        case General: {
+            double value = nval < numvals ? vals[nval].d : 0.0;
+            ++nval;
+            char *buf = out.reserve(MAX_RENDER_SIZE);
+            int n = (segment.type == Fixed) ? formatDoubleFixed(buf, value, segment.precision) : formatDoubleGeneral(buf, value, segment.precision);
+            if (n < 0) {
+                n = snprintf(buf, MAX_RENDER_SIZE, (segment.type == Fixed) ? "%.*f" : "%.*g", segment.precision, value);
+            }
+            out.commit(n);
+            break;
+        }
+        }
+    }
+}
@@ -0,0 +1,85 @@
+#ifndef FASTFORMAT_HEADER
+#define FASTFORMAT_HEADER
+
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+/*fast replacement for fprintf() in the hot loops of the text writers (DXF, GWL).
+
+A FormatPlan is a printf format string parsed just once. Supported conversions are
+%.Nf, %.Ng, %d, %c and %%. Doubles are rendered with an exact custom conversion, and the
+result is appended to a TextBuffer, which is written with fwrite when it is full or flushed.
+
+The output is byte-identical to fprintf(): the few values that cannot be rendered exactly
+by the custom conversion (exact rounding ties, very big or very small values) are rendered
+with snprintf(), and so are format strings with unsupported conversions*/
+
+//output buffer for a FILE*. It must be flushed before writing to the FILE* by other means
+class TextBuffer {
+public:
+    TextBuffer(size_t _capacity = 1024 * 1024) : f(NULL), capacity(_capacity), used(0), failed(false) {}
+    void setFile(FILE *_f) { f = _f; }
+    //returns a pointer to at least n free bytes, flushing if necessary
+    char *reserve(size_t n) {
+        if (used + n > data.size()) makeRoom(n);
+        return &data[used];
+    }
+    void commit(size_t n) { used += n; }
+    void append(const char *str, size_t n) { memcpy(reserve(n), str, n); commit(n); }
+    //returns false if any write to the FILE* failed since the last call
+    bool flush();
+protected:
+    void makeRoom(size_t n);
+    FILE *f;
+    std::vector<char> data;
+    size_t capacity;
+    size_t used;
+    bool failed;
+};
+
+//these functions return the number of chars written, or -1 if the value cannot be rendered exactly (the caller has to fall back to snprintf())
+int formatDoubleFixed  (char *out, double value, int precision); //equivalent to "%.<precision>f"
+int formatDoubleGeneral(char *out, double value, int precision); //equivalent to "%.<precision>g"
+
+//argument for FormatPlan::print()
+typedef struct FormatArg {
+    double d;
+    long long i;
+    FormatArg(double v) : d(v), i(0) {}
+    FormatArg(int v) : d(0), i(v) {}
+    FormatArg(char v) : d(0), i(v) {}
+} FormatArg;
+
+class FormatPlan {
+public:
+    std::string format;
+    bool supported;
+    FormatPlan() : supported(false) {}
+    FormatPlan(std::string _format) { compile(std::move(_format)); }
+    void compile(std::string _format);
+    template<typename... Args> void print(TextBuffer &out, Args... args) {
+        if (supported) {
+            FormatArg vals[] = { FormatArg(args)... };
+            render(out, vals, sizeof...(Args));
+        } else {
+            int n = snprintf(NULL, 0, format.c_str(), args...);
+            if (n > 0) {
+                out.commit(snprintf(out.reserve(n + 1), n + 1, format.c_str(), args...));
+            }
+        }
+    }
+protected:
+    enum SegmentType { Literal, Fixed, General, Integer, Character };
+    typedef struct Segment {
+        SegmentType type;
+        int precision;
+        std::string literal;
+        Segment(SegmentType t, int p = 0) : type(t), precision(p) {}
+    } Segment;
+    std::vector<Segment> segments;
+    void render(TextBuffer &out, FormatArg *vals, int numvals);
+};
+
+#endif
@@ -0,0 +1,123 @@
+#include "mappedfile.hpp"
+#include "config.hpp"
+
+#if defined(_WIN32) || defined(_WIN64)
+#  define INWINDOWS
+#  include <windows.h>
+#else
+#  include <sys/mman.h>
+#  include <sys/stat.h>
+#  include <fcntl.h>
+#  include <unistd.h>
+#endif
+
+#ifdef INWINDOWS
+
+MappedFile::MappedFile() : ptr(NULL), length(0), opened(false), file(INVALID_HANDLE_VALUE), mapping(NULL) {}
+
+bool MappedFile::openForReading(const char *filename) {
+    if (!close()) return false;
+    name = filename;
+    file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (file == INVALID_HANDLE_VALUE) { err = str("Could not open file ", filename); return false; }
+    opened = true;
+    LARGE_INTEGER filesize;
+    if (!GetFileSizeEx((HANDLE)file, &filesize)) { err = str("Could not get the size of file ", filename); close(); return false; }
+    length = (size_t)filesize.QuadPart;
+    if (length == 0) return true; //empty files cannot be mapped
+    mapping = CreateFileMappingA((HANDLE)file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (mapping == NULL) { err = str("Could not map file ", filename); close(); return false; }
+    ptr = (char*)MapViewOfFile((HANDLE)mapping, FILE_MAP_READ, 0, 0, 0);
+    if (ptr == NULL) { err = str("Could not map file ", filename); close(); return false; }
+    return true;
+}
+
+bool MappedFile::createForWriting(const char *filename, size_t size) {
+    if (!close()) return false;
+    name = filename;
+    file = CreateFileA(filename, GENERIC_READ | GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) { err = str("Could not open output file ", filename); return false; }
+    opened = true;
+    length = size;
+    if (length == 0) return true;
+    //the mapping extends the file to the requested size
+    mapping = CreateFileMappingA((HANDLE)file, NULL, PAGE_READWRITE, (DWORD)((unsigned long long)size >> 32), (DWORD)(size & 0xFFFFFFFF), NULL);
+    if (mapping == NULL) { err = str("Could not map output file ", filename); close(); return false; }
+    ptr = (char*)MapViewOfFile((HANDLE)mapping, FILE_MAP_WRITE, 0, 0, 0);
+    if (ptr == NULL) { err = str("Could not map output file ", filename); close(); return false; }
+    return true;
+}
+
+bool MappedFile::close() {
+    bool ok = true;
+    if (ptr != NULL) {
+        ok = UnmapViewOfFile(ptr) != 0;
+        ptr = NULL;
+    }
+    if (mapping != NULL) {
+        ok = (CloseHandle((HANDLE)mapping) != 0) && ok;
+        mapping = NULL;
+    }
+    if (file != INVALID_HANDLE_VALUE) {
+        ok = (CloseHandle((HANDLE)file) != 0) && ok;
+        file = INVALID_HANDLE_VALUE;
+    }
+    if (!ok) err = str("Error closing mapped file ", name);
+    opened = false;
+    length = 0;
+    return ok;
+}
+
+#else
+
+MappedFile::MappedFile() : ptr(NULL), length(0), opened(false), fd(-1) {}
+
+bool MappedFile::openForReading(const char *filename) {
+    if (!close()) return false;
+    name = filename;
+    fd = open(filename, O_RDONLY);
+    if (fd < 0) { err = str("Could not open file ", filename); return false; }
+    opened = true;
+    struct stat st;
+    if (fstat(fd, &st) != 0) { err = str("Could not get the size of file ", filename); close(); return false; }
+    length = (size_t)st.st_size;
+    if (length == 0) return true; //empty files cannot be mapped
+    void *p = mmap(NULL, length, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (p == MAP_FAILED) { err = str("Could not map file ", filename); close(); return false; }
+    ptr = (char*)p;
+    madvise(p, length, MADV_SEQUENTIAL);
+    return true;
+}
+
+bool MappedFile::createForWriting(const char *filename, size_t size) {
+    if (!close()) return false;
+    name = filename;
+    fd = open(filename, O_RDWR | O_CREAT | O_TRUNC, 0666);
+    if (fd < 0) { err = str("Could not open output file ", filename); return false; }
+    opened = true;
+    length = size;
+    if (length == 0) return true;
+    if (ftruncate(fd, (off_t)size) != 0) { err = str("Could not set the size of output file ", filename); close(); return false; }
+    void *p = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (p == MAP_FAILED) { err = str("Could not map output file ", filename); close(); return false; }
+    ptr = (char*)p;
+    return true;
+}
+
+bool MappedFile::close() {
+    bool ok = true;
+    if (ptr != NULL) {
+        ok = munmap(ptr, length) == 0;
+        ptr = NULL;
+    }
+    if (fd >= 0) {
+        ok = (::close(fd) == 0) && ok;
+        fd = -1;
+    }
+    if (!ok) err = str("Error closing mapped file ", name);
+    opened = false;
+    length = 0;
+    return ok;
+}
+
+#endif
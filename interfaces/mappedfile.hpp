@@ -0,0 +1,35 @@
+#ifndef MAPPEDFILE_HEADER
+#define MAPPEDFILE_HEADER
+
+#include <stddef.h>
+#include <string>
+
+/*memory-mapped file, to read or write big files without copying them through stdio buffers.
+The whole file is mapped. If there is an error, the methods return false and err is set*/
+class MappedFile {
+public:
+    std::string err;
+    MappedFile();
+    ~MappedFile() { close(); }
+    //maps an existing file for reading
+    bool openForReading(const char *filename);
+    //creates (or truncates) a file with the specified size, and maps it for writing
+    bool createForWriting(const char *filename, size_t size);
+    bool close();
+    bool isopen() { return opened; }
+    char  *data() { return ptr; }
+    size_t size() { return length; }
+protected:
+    char *ptr;
+    size_t length;
+    bool opened;
+    std::string name;
+    //the native handles are opaque here, to avoid including system headers
+#if defined(_WIN32) || defined(_WIN64)
+    void *file, *mapping;
+#else
+    int fd;
+#endif
+};
+
+#endif
@@ -124,6 +124,11 @@ po::options_description globalOptionsGenerator(AddNano useNano, AddResponseFile
             "If this option is specified, the processed and raw contours will be provided as output (in addition to the toolpaths)")
         ("correct-input",
             "If this option is specified, the orientation of raw contours will be corrected. Useful if the raw contours are not generated with Slic3r::TriangleMeshSlicer")
+        ("snap-strict",
+            "If this option is specified, the computation is aborted if a toolpath cannot be snapped to the grid. Otherwise, the toolpath is snapped after a small opening (of the size of the grid step) or, if that also fails, it is left unsnapped, and a warning is printed")
+        ("snap-threads",
+            po::value<int>()->default_value(1)->value_name("num_threads"),
+            "Number of threads used to snap toolpaths to the grid (0 means as many as hardware threads). The result does not depend on this number")
         ("motion-planner",
             "If this option is specified, a very simple motion planner will be used to order the toolpaths (in a greedy way, and without any optimization to select circular perimeter entry points). Please note: perimeters, surfaces and infillings are planned independently and sequentially. If you want to apply motion planning to perimeters, surfaces and infillings together, set the per-process options lump-*.")
         ("subtractive-box-mode",
@@ -138,6 +143,15 @@ po::options_description globalOptionsGenerator(AddNano useNano, AddResponseFile
         ("slicing-manual",
             po::value<std::vector<double>>()->multitoken()->value_name("[ntool_1 z_1 ntool2 z_2 ...]"),
             "Same as slicing-scheduler, but the executing order is specified manually: values are NTOOL_1, Z_1, NTOOL_2, Z_2, NTOOL_3, Z_3 ..., such that for each the i-th scheduled slice is at height Z_i, and is computed with process NTOOL_i.")
+        ("slicing-adaptive",
+            po::value<std::vector<int>>()->multitoken()->zero_tokens()->value_name("[ntool_list]"),
+            "Same as slicing-scheduler (the values have the same meaning), but the mesh is first sliced at probe Zs (see slicing-adaptive-step), and the slices of each process other than the first one are placed with the Z step of the previous process wherever the material added by the process (what the previous process cannot fill) does not change between consecutive probe slices (see slicing-adaptive-threshold). This way, vertical walls do not require a full set of high-resolution slices. Requires a mesh file as input (not --load-raw).")
+        ("slicing-adaptive-threshold",
+            po::value<double>()->default_value(0.02)->value_name("fraction"),
+            "For slicing-adaptive, the material added by a process is considered to be unchanging between two consecutive probe slices if the area of its change (symmetric difference of the residues left by the previous process, plus the region swept by the contour, disregarding slivers narrower than the process) is at most this fraction of the area of the material added by the process.")
+        ("slicing-adaptive-step",
+            po::value<double>()->value_name("z_step"),
+            "For slicing-adaptive, Z step between the probe slices, in mesh file units. It cannot be larger than the slice height of any of the thinned-out processes (so no change is missed between probes): if it is not specified or it is larger, the smallest of these slice heights is used.")
         ("slicing-zbase",
             po::value<double>()->value_name("z_base"),
             "This parameter is the Z position of the first slice, in mesh file units. If it is not specified, the first Z value is either the min or the max Z position of the 3D mesh, depending on the value of slicing-direction. In mode --slicing-scheduler or --slicing-manual, this will be either the bottom or the top (depending on --slicing-direction) of the first slice.")
@@ -687,6 +701,8 @@ void parseGlobal(GlobalSpec &spec, po::variables_map &vm, MetricFactors &factors
     spec.alsoContours              = vm.count("save-contours")       != 0;
     spec.correct                   = vm.count("correct-input")       != 0;
     spec.applyMotionPlanner        = vm.count("motion-planner")      != 0;
+    spec.snapStrict                = vm.count("snap-strict")         != 0;
+    spec.snapThreads               = vm["snap-threads"].as<int>();
     spec.avoidVerticalOverwriting  = vm.count("vertical-correction") != 0;
 
     spec.addsub.addsubWorkflowMode = vm.count("addsub") != 0;
@@ -731,7 +747,7 @@ void parseGlobal(GlobalSpec &spec, po::variables_map &vm, MetricFactors &factors
         spec.z_base = vm["slicing-zbase"].as<double>();
     }
     bool schedSet = false;
-    const char * schedRepErr = "trying to specify more than one of these options: slicing-uniform, slicing-scheduler, slicing-manual";
+    const char * schedRepErr = "trying to specify more than one of these options: slicing-uniform, slicing-scheduler, slicing-manual, slicing-adaptive";
     if (vm.count("slicing-uniform")) {
         if (schedSet) throw po::error(schedRepErr);
         spec.schedMode      = UniformScheduling;
@@ -761,7 +777,16 @@ void parseGlobal(GlobalSpec &spec, po::variables_map &vm, MetricFactors &factors
         }
         schedSet = true;
     };
-    if (!schedSet) throw po::error("Exactly one of these options must be set: slicing-uniform, slicing-scheduler, slicing-manual");
+    if (vm.count("slicing-adaptive")) {
+        if (schedSet) throw po::error(schedRepErr);
+        spec.schedMode  = AdaptiveScheduling;
+        spec.schedTools = std::move(vm["slicing-adaptive"].as<std::vector<int>>());
+        schedSet        = true;
+    };
+    if (!schedSet) throw po::error("Exactly one of these options must be set: slicing-uniform, slicing-scheduler, slicing-manual, slicing-adaptive");
+    spec.adaptiveThreshold = vm["slicing-adaptive-threshold"].as<double>();
+    if (spec.adaptiveThreshold < 0) throw po::error(str("slicing-adaptive-threshold cannot be negative, but it was ", spec.adaptiveThreshold));
+    spec.adaptiveStep = vm.count("slicing-adaptive-step") ? vm["slicing-adaptive-step"].as<double>() * factors.input_to_internal : 0.0;
     spec.useScheduler = spec.schedMode != UniformScheduling;
     if (vm.count("z-epsilon")) {
         spec.z_epsilon = vm["z-epsilon"].as<double>() * factors.input_to_internal;
@@ -790,6 +815,7 @@ void parseGlobal(GlobalSpec &spec, po::variables_map &vm, MetricFactors &factors
             case SimpleScheduler:   schedmode = "sched"; break;
             case UniformScheduling: schedmode = "uniform"; break;
             case ManualScheduling:  schedmode = "manual"; break;
+            case AdaptiveScheduling: schedmode = "adaptive"; break;
             default:                schedmode = "unknown";
             }
             throw po::error(str("Error: feedback file was specified (", spec.fb.feedbackFile, "), but the scheduling mode '", schedmode, "' does not allow feedback!!!!"));
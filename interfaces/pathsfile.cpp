@@ -1,7 +1,12 @@
 #include "pathsfile.hpp"
+#include "mappedfile.hpp"
 #include <stdio.h>
 #include <ctype.h>
 #include <exception>
+#include <string.h>
+#include <stdint.h>
+#include <cmath>
+#include <algorithm>
 
 static_assert((sizeof(double) == sizeof(int64)) && (sizeof(int64) == sizeof(T64)) && (sizeof(double) == 8), "this code requires that <double>, <long long int> and their union all have a size of 8 bytes.");
 static_assert(sizeof(int) == 4, "this code requires <int> to have a size of 4 bytes.");
@@ -16,6 +21,22 @@ bool fileExists(const char *filename) {
     return true;
 }
 
+int fseek64(FILE *f, int64 offset, int origin) {
+#if (defined(_WIN32) || defined(_WIN64))
+    return _fseeki64(f, offset, origin);
+#else
+    return fseeko(f, (off_t)offset, origin);
+#endif
+}
+
+int64 ftell64(FILE *f) {
+#if (defined(_WIN32) || defined(_WIN64))
+    return _ftelli64(f);
+#else
+    return (int64)ftello(f);
+#endif
+}
+
 char *fullPath(const char *path) {
 #if (defined(_WIN32) || defined(_WIN64))
     return _fullpath(NULL, path, 1024 * 10);
@@ -167,11 +188,14 @@ std::string writeSlice(FILE *f, SliceHeader header, clp::Paths &paths, PathClose
 }
 
 bool PathInFileSpec::matchesHeader(SliceHeader &h) {
-    return (h.alldata.size()>=5) &&
-            ((!usetype)     || (h.type == type)) &&
-            ((!usetoolpath) || (h.type == PATHTYPE_TOOLPATH_PERIMETER) || (h.type == PATHTYPE_TOOLPATH_INFILLING) || (h.type == PATHTYPE_TOOLPATH_SURFACE)) &&
-            ((!usentool)    || (h.ntool == ntool)) &&
-            ((!usez)        || (std::fabs(h.z - z)<1e-6));
+    return (h.alldata.size()>=5) && matchesFields(h.type, h.ntool, h.z);
+}
+
+bool PathInFileSpec::matchesFields(int64 _type, int64 _ntool, double _z) {
+    return  ((!usetype)     || (_type == type)) &&
+            ((!usetoolpath) || (_type == PATHTYPE_TOOLPATH_PERIMETER) || (_type == PATHTYPE_TOOLPATH_INFILLING) || (_type == PATHTYPE_TOOLPATH_SURFACE)) &&
+            ((!usentool)    || (_ntool == ntool)) &&
+            ((!usez)        || (std::fabs(_z - z)<1e-6));
 }
 
 std::string PathInFileSpec::readFromCommandLine(ParamReader &rd, int maxtimes, bool furtherArgs) {
@@ -215,8 +239,178 @@ std::string seekNextMatchingPathsFromFile(FILE * f, FileHeader &fileheader, int
         if (spec.matchesHeader(sliceheader)) {
             break;
         } else {
-            fseek(f, (long)(sliceheader.totalSize - sliceheader.headerSize), SEEK_CUR);
+            fseek64(f, sliceheader.totalSize - sliceheader.headerSize, SEEK_CUR);
+        }
+    }
+    return std::string();
+}
+
+void RecordIndexEntry::setBB(clp::Paths &paths) {
+    hasBB = true;
+    //getBB() returns a zero-sized box at the origin for empty paths, but we need to tell them apart
+    bb    = paths.empty() ? BBox(1, 0, 1, 0) : getBB(paths);
+}
+
+bool RecordIndexEntry::setBBFromPayload(const char *payload, size_t size) {
+    hasBB = false;
+    bool isInt = saveFormat == PATHFORMAT_INT64;
+    if (!isInt && (saveFormat != PATHFORMAT_DOUBLE)) return true;
+    size_t numvalues = size / sizeof(T64);
+    //the payload may not be aligned
+    auto value = [payload](size_t k) { T64 v; memcpy(&v, payload + k*sizeof(T64), sizeof(T64)); return v; };
+    auto coord = [isInt, this, &value](size_t k) { T64 v = value(k); return isInt ? (clp::cInt)v.i : (clp::cInt)std::llround(v.d / scaling); };
+    if (numvalues < 1) return false;
+    int64 numpaths = value(0).i;
+    size_t pos     = 1;
+    //same results as setBB()
+    BBox box = (numpaths == 0) ? BBox(1, 0, 1, 0) : BBox(LLONG_MAX, LLONG_MIN, LLONG_MAX, LLONG_MIN);
+    for (int64 p = 0; p < numpaths; ++p) {
+        if (pos >= numvalues) return false;
+        int64 numpoints = value(pos++).i;
+        if ((numpoints < 0) || ((numvalues - pos) / 2 < (size_t)numpoints)) return false;
+        for (int64 q = 0; q < numpoints; ++q, pos += 2) {
+            clp::cInt x = coord(pos), y = coord(pos + 1);
+            box.minx = std::min(box.minx, x);
+            box.maxx = std::max(box.maxx, x);
+            box.miny = std::min(box.miny, y);
+            box.maxy = std::max(box.maxy, y);
+        }
+    }
+    bb    = box;
+    hasBB = true;
+    return true;
+}
+
+static const char RECORDINDEX_MAGIC[8] = { 'P', 'A', 'T', 'H', 'S', 'I', 'D', 'X' };
+static const int RECORDINDEX_TRAILER_FIELDS = 4; //numEntries, numFields, version, magic
+
+std::string RecordIndex::load(FILE *f, FileHeader &fileheader) {
+    int64 firstRecordOffset = ftell64(f);
+    if (firstRecordOffset < 0) return std::string("could not get the position of the first record");
+    if (readFromFile(f, fileheader, firstRecordOffset)) return std::string();
+    return buildFromFile(f, fileheader, firstRecordOffset);
+}
+
+bool RecordIndex::readFromFile(FILE *f, FileHeader &fileheader, int64 firstRecordOffset) {
+    entries.clear();
+    fromFile = false;
+    T64 trailer[RECORDINDEX_TRAILER_FIELDS];
+    if (fseek64(f, -(int64)sizeof(trailer), SEEK_END) != 0) return false;
+    int64 trailerOffset = ftell64(f);
+    if (fread(trailer, sizeof(T64), RECORDINDEX_TRAILER_FIELDS, f) != RECORDINDEX_TRAILER_FIELDS) return false;
+    if (memcmp(&trailer[3], RECORDINDEX_MAGIC, sizeof(T64)) != 0) return false;
+    int64 numEntries = trailer[0].i, numFields = trailer[1].i;
+    if ((numEntries != fileheader.numRecords) || (numFields < RecordIndexEntry::numFields)) return false;
+    int64 indexOffset = trailerOffset - numEntries*numFields*(int64)sizeof(T64);
+    if (indexOffset < firstRecordOffset) return false;
+    std::vector<T64> data(numEntries*numFields);
+    if (numEntries > 0) {
+        if (fseek64(f, indexOffset, SEEK_SET) != 0) return false;
+        if (fread(&data.front(), sizeof(T64), data.size(), f) != data.size()) return false;
+    }
+    entries.resize(numEntries);
+    int64 expectedOffset = firstRecordOffset;
+    for (int64 k = 0; k < numEntries; ++k) {
+        T64 *d = &data[k*numFields];
+        RecordIndexEntry &e = entries[k];
+        e.offset     = d[0].i;
+        e.totalSize  = d[1].i;
+        e.type       = d[2].i;
+        e.ntool      = d[3].i;
+        e.z          = d[4].d;
+        e.saveFormat = d[5].i;
+        e.scaling    = d[6].d;
+        e.hasBB      = d[7].i != 0;
+        e.bb.minx    = d[8].i;
+        e.bb.maxx    = d[9].i;
+        e.bb.miny    = d[10].i;
+        e.bb.maxy    = d[11].i;
+        //the records must be contiguous, otherwise the index is stale (for example, if the file was resumed)
+        if ((e.offset != expectedOffset) || (e.totalSize <= 0)) { entries.clear(); return false; }
+        expectedOffset += e.totalSize;
+    }
+    if (expectedOffset != indexOffset) { entries.clear(); return false; }
+    fromFile = true;
+    return true;
+}
+
+std::string RecordIndex::buildFromFile(FILE *f, FileHeader &fileheader, int64 firstRecordOffset, bool computeBBs) {
+    entries.clear();
+    entries.reserve(fileheader.numRecords);
+    fromFile = false;
+    if (fseek64(f, firstRecordOffset, SEEK_SET) != 0) return std::string("could not seek to the first record");
+    SliceHeader sliceheader;
+    std::vector<char> payload;
+    int64 offset = firstRecordOffset;
+    for (int currentRecord = 0; currentRecord < fileheader.numRecords; ++currentRecord) {
+        std::string err = sliceheader.readFromFile(f);
+        if (!err.empty()) { return str("Error reading ", currentRecord, "-th slice header: ", err); }
+        if (sliceheader.alldata.size() < 7) { return str("Error reading ", currentRecord, "-th slice header: header is too short!"); }
+        entries.emplace_back(sliceheader, offset);
+        if (computeBBs) {
+            payload.resize((size_t)(sliceheader.totalSize - sliceheader.headerSize));
+            if (!payload.empty() && (fread(&payload.front(), 1, payload.size(), f) != payload.size())) { return str("Error reading ", currentRecord, "-th slice: could not read the payload!"); }
+            if (!entries.back().setBBFromPayload(payload.empty() ? NULL : &payload.front(), payload.size())) { return str("Error reading ", currentRecord, "-th slice: malformed payload!"); }
         }
+        offset += sliceheader.totalSize;
+        if (fseek64(f, offset, SEEK_SET) != 0) { return str("Error reading ", currentRecord, "-th slice header: could not skip the payload!"); }
+    }
+    return std::string();
+}
+
+std::string RecordIndex::writeToFile(FILE *f) {
+    std::vector<T64> data(entries.size()*RecordIndexEntry::numFields + RECORDINDEX_TRAILER_FIELDS);
+    T64 *d = &data.front();
+    for (auto &e : entries) {
+        d[0] = e.offset;
+        d[1] = e.totalSize;
+        d[2] = e.type;
+        d[3] = e.ntool;
+        d[4] = e.z;
+        d[5] = e.saveFormat;
+        d[6] = e.scaling;
+        d[7] = (int64)e.hasBB;
+        d[8] = (int64)e.bb.minx;
+        d[9] = (int64)e.bb.maxx;
+        d[10] = (int64)e.bb.miny;
+        d[11] = (int64)e.bb.maxy;
+        d += RecordIndexEntry::numFields;
+    }
+    d[0] = (int64)entries.size();
+    d[1] = (int64)RecordIndexEntry::numFields;
+    d[2] = (int64)RECORDINDEX_VERSION;
+    memcpy(&d[3], RECORDINDEX_MAGIC, sizeof(T64));
+    if (fwrite(&data.front(), sizeof(T64), data.size(), f) != data.size()) return std::string("could not write the record index");
+    return std::string();
+}
+
+bool matchesEntry(PathInFileSpec &spec, RecordIndexEntry &e) {
+    return spec.matchesFields(e.type, e.ntool, e.z);
+}
+
+std::string copyRecords(FILE *input, FILE *output, RecordIndex &index, std::vector<size_t> &selected) {
+    const int64 blockSize = 8 * 1024 * 1024;
+    std::vector<char> buffer;
+    size_t k = 0;
+    while (k < selected.size()) {
+        //coalesce a run of contiguous records
+        RecordIndexEntry &first = index.entries[selected[k]];
+        int64 start = first.offset, end = first.offset + first.totalSize;
+        size_t nextk = k + 1;
+        while ((nextk < selected.size()) && (index.entries[selected[nextk]].offset == end)) {
+            end += index.entries[selected[nextk]].totalSize;
+            ++nextk;
+        }
+        if (fseek64(input, start, SEEK_SET) != 0) { return str("could not seek to the ", selected[k], "-th record"); }
+        size_t bufferSize = (size_t)std::min(blockSize, end - start);
+        if (buffer.size() < bufferSize) buffer.resize(bufferSize);
+        for (int64 pos = start; pos < end; ) {
+            size_t toCopy = (size_t)std::min((int64)buffer.size(), end - pos);
+            if (fread (&buffer.front(), 1, toCopy, input)  != toCopy) { return str("error trying to read records ",  selected[k], " to ", selected[nextk - 1]); }
+            if (fwrite(&buffer.front(), 1, toCopy, output) != toCopy) { return str("error trying to write records ", selected[k], " to ", selected[nextk - 1]); }
+            pos += toCopy;
+        }
+        k = nextk;
     }
     return std::string();
 }
@@ -279,3 +473,135 @@ void writeTriangleMeshToOFF(FILE *f, const char *float_format, TriangleMesh &mes
       fprintf(f, "3 %d %d %d\n", triangle.a, triangle.b, triangle.c);
     }
 }
+
+//binary STL layout: 80-byte header, uint32 number of triangles, and for each triangle: normal and 3 vertices (12 floats) and a uint16 attribute
+const size_t STL_HEADER_SIZE   = 84;
+const size_t STL_TRIANGLE_SIZE = 50;
+
+std::string writeTriangleMeshToSTL(const char *filename, TriangleMesh &mesh) {
+    size_t numtriangles = mesh.triangles.size();
+    if (numtriangles > 0xFFFFFFFFULL) return str("Cannot write ", filename, ": too many triangles for a STL file");
+    int numpoints = (int)mesh.points.size();
+    for (auto &t : mesh.triangles) {
+        if ((t.a < 0) || (t.b < 0) || (t.c < 0) || (t.a >= numpoints) || (t.b >= numpoints) || (t.c >= numpoints)) {
+            return str("Cannot write ", filename, ": the mesh has triangles with invalid vertex indexes");
+        }
+    }
+    MappedFile out;
+    if (!out.createForWriting(filename, STL_HEADER_SIZE + STL_TRIANGLE_SIZE*numtriangles)) return out.err;
+    char *data = out.data();
+    memset(data, 0, 80);
+    const char *header = "binary STL generated by multiresolution";
+    memcpy(data, header, strlen(header));
+    uint32_t n = (uint32_t)numtriangles;
+    memcpy(data + 80, &n, sizeof(n));
+    char *record = data + STL_HEADER_SIZE;
+    for (auto &t : mesh.triangles) {
+        float v[12];
+        TriangleMesh::Point *ps[3] = { &mesh.points[t.a], &mesh.points[t.b], &mesh.points[t.c] };
+        for (int k = 0; k < 3; ++k) {
+            v[3 + 3*k] = (float)ps[k]->x;
+            v[4 + 3*k] = (float)ps[k]->y;
+            v[5 + 3*k] = (float)ps[k]->z;
+        }
+        double ux = ps[1]->x - ps[0]->x, uy = ps[1]->y - ps[0]->y, uz = ps[1]->z - ps[0]->z;
+        double vx = ps[2]->x - ps[0]->x, vy = ps[2]->y - ps[0]->y, vz = ps[2]->z - ps[0]->z;
+        double nx = uy*vz - uz*vy, ny = uz*vx - ux*vz, nz = ux*vy - uy*vx;
+        double len = std::sqrt(nx*nx + ny*ny + nz*nz);
+        if (len > 0) { nx /= len; ny /= len; nz /= len; }
+        v[0] = (float)nx; v[1] = (float)ny; v[2] = (float)nz;
+        memcpy(record, v, sizeof(v));
+        record[48] = record[49] = 0;
+        record += STL_TRIANGLE_SIZE;
+    }
+    if (!out.close()) return out.err;
+    return std::string();
+}
+
+//open addressing hash table to merge vertices with the same coordinates. The keys are the bit patterns of the coordinates
+class VertexMerger {
+public:
+    VertexMerger(std::vector<TriangleMesh::Point> &_points, size_t expected) : points(_points) {
+        size_t capacity = 1024;
+        while (capacity < expected * 2) capacity *= 2;
+        slots.assign(capacity, -1);
+        keys.reserve(expected);
+    }
+    int getIndex(const float *v) {
+        Key key;
+        for (int k = 0; k < 3; ++k) {
+            uint32_t bits;
+            memcpy(&bits, &v[k], sizeof(bits));
+            //so -0.0 and 0.0 are merged (adding 0.0f does not work, the compiler removes it with -ffast-math)
+            if ((bits & 0x7fffffff) == 0) bits = 0;
+            key.c[k] = bits;
+        }
+        if ((keys.size() + 1) * 2 > slots.size()) grow();
+        size_t mask = slots.size() - 1;
+        for (size_t slot = hash(key) & mask;; slot = (slot + 1) & mask) {
+            int idx = slots[slot];
+            if (idx < 0) {
+                idx = (int)keys.size();
+                slots[slot] = idx;
+                keys.push_back(key);
+                points.emplace_back(v[0], v[1], v[2]);
+                return idx;
+            }
+            if (keys[idx] == key) return idx;
+        }
+    }
+protected:
+    typedef struct Key {
+        uint32_t c[3];
+        bool operator==(const Key &o) const { return (c[0] == o.c[0]) && (c[1] == o.c[1]) && (c[2] == o.c[2]); }
+    } Key;
+    static size_t hash(const Key &key) {
+        uint64_t h = ((uint64_t)key.c[0] * 0x9E3779B97F4A7C15ULL) ^ ((uint64_t)key.c[1] * 0xC2B2AE3D27D4EB4FULL) ^ ((uint64_t)key.c[2] * 0x165667B19E3779F9ULL);
+        return (size_t)(h ^ (h >> 29));
+    }
+    void grow() {
+        slots.assign(slots.size() * 2, -1);
+        size_t mask = slots.size() - 1;
+        for (int idx = 0; idx < (int)keys.size(); ++idx) {
+            size_t slot = hash(keys[idx]) & mask;
+            while (slots[slot] >= 0) slot = (slot + 1) & mask;
+            slots[slot] = idx;
+        }
+    }
+    std::vector<TriangleMesh::Point> &points;
+    std::vector<Key> keys;
+    std::vector<int> slots;
+};
+
+std::string readTriangleMeshFromSTL(const char *filename, TriangleMesh &mesh) {
+    MappedFile in;
+    if (!in.openForReading(filename)) return in.err;
+    const char *data = in.data();
+    size_t size = in.size();
+    if (size < STL_HEADER_SIZE) return str("File ", filename, " is too short to be a STL file");
+    uint32_t n;
+    memcpy(&n, data + 80, sizeof(n));
+    size_t numtriangles = n;
+    if (size != STL_HEADER_SIZE + STL_TRIANGLE_SIZE*numtriangles) {
+        if (strncmp(data, "solid", 5) == 0) return str("File ", filename, " seems to be an ASCII STL file, only binary STL files are supported");
+        return str("File ", filename, " has a size inconsistent with its number of triangles (", numtriangles, ")");
+    }
+    mesh.points.clear();
+    mesh.triangles.clear();
+    mesh.triangles.reserve(numtriangles);
+    //in closed meshes, there are about half as many vertices as triangles
+    mesh.points.reserve(numtriangles / 2 + 3);
+    VertexMerger merger(mesh.points, numtriangles / 2 + 3);
+    const char *record = data + STL_HEADER_SIZE;
+    for (size_t k = 0; k < numtriangles; ++k) {
+        float v[9];
+        memcpy(v, record + 12, sizeof(v)); //skip the normal
+        int a = merger.getIndex(v);
+        int b = merger.getIndex(v + 3);
+        int c = merger.getIndex(v + 6);
+        mesh.triangles.emplace_back(a, b, c);
+        record += STL_TRIANGLE_SIZE;
+    }
+    if (!in.close()) return in.err;
+    return std::string();
+}
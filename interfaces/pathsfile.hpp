@@ -36,6 +36,10 @@ typedef struct FILEOwner {
 
 bool fileExists(const char *filename);
 
+//64-bit versions of fseek() and ftell(), required for files bigger than 2GB
+int   fseek64(FILE *f, int64 offset, int origin);
+int64 ftell64(FILE *f);
+
 //Returns NULL if it could not resolve the path. The returned string must be freed with free()
 char *fullPath(const char *path);
 
@@ -102,16 +106,69 @@ typedef struct PathInFileSpec {
     PathInFileSpec(double _z) :                                                    z(_z), usetype(false), usentool(false), usez(true),  usetoolpath(false) {}
     //this function matches writeSlice()'s header
     bool matchesHeader(SliceHeader &h);
+    //common matching logic for slice headers and index entries
+    bool matchesFields(int64 _type, int64 _ntool, double _z);
     //read at most 'maxtimes' specs (as much as possible if maxtimes<0). If furtherArgs is false, tries to consume all the remaining input until all is consumed, treating anything non-conformant as an error. If it is true, it stops if it cannot recognize an argument, to enable consumption of further arguments by other code
     std::string readFromCommandLine(ParamReader &rd, int maxtimes, bool furtherArgs);
 } PathInFileSpec;
 
 std::string seekNextMatchingPathsFromFile(FILE * f, FileHeader &fileheader, int &currentRecord, PathInFileSpec &spec, SliceHeader &sliceheader);
 
+/*optional index of the records of a pathsfile, stored after the last record (readers iterating over numRecords
+do not see it). Layout: numEntries entries of numFields T64 values each, then numEntries, numFields,
+the index version, and the magic number "PATHSIDX". Later versions may add fields at the end of the entries.
+Version 2 added the scaling and the bounding box of each record, so the extent of a file can be known without reading the paths*/
+#define RECORDINDEX_VERSION 2
+typedef struct RecordIndexEntry {
+    int64 offset;    //file offset of the slice header
+    int64 totalSize; //size of the record (header+payload)
+    int64 type;
+    int64 ntool;
+    double z;
+    int64 saveFormat;
+    double scaling;
+    bool hasBB;      //false if the bounding box is not known (it is known only if the index was written along with the records)
+    BBox bb;         //in the integer coordinates of the record (multiply by scaling to get the original units). If the record has no points, minx>maxx
+    static const int numFields = 12;
+    RecordIndexEntry() = default;
+    RecordIndexEntry(SliceHeader &h, int64 _offset) : offset(_offset), totalSize(h.totalSize), type(h.type), ntool(h.ntool), z(h.z), saveFormat(h.saveFormat), scaling(h.scaling), hasBB(false) {}
+    void setBB(clp::Paths &paths);
+    /*same as setBB(), but from the serialized paths (the payload of the record). For PATHFORMAT_DOUBLE, the coordinates
+    are converted back to integers with the scaling. Returns false if the payload is malformed (3D records are left without a bounding box)*/
+    bool setBBFromPayload(const char *payload, size_t size);
+    bool isEmpty() { return bb.minx > bb.maxx; }
+} RecordIndexEntry;
+
+typedef struct RecordIndex {
+    std::vector<RecordIndexEntry> entries;
+    //true if the index was read from the file, false if it was built from the slice headers
+    bool fromFile;
+    RecordIndex() : fromFile(false) {}
+    /*reads the index from the file if it is present and consistent with the file header, otherwise builds it
+    in a pass over the slice headers, seeking over the payloads. The file must be positioned just after the file header*/
+    std::string load(FILE *f, FileHeader &fileheader);
+    //returns false if there is no valid index in the file
+    bool readFromFile(FILE *f, FileHeader &fileheader, int64 firstRecordOffset);
+    //if computeBBs is false, the payloads are skipped, so the entries are left without bounding boxes
+    std::string buildFromFile(FILE *f, FileHeader &fileheader, int64 firstRecordOffset, bool computeBBs = false);
+    //writes the index at the current position of the file, which must be just after the last record
+    std::string writeToFile(FILE *f);
+} RecordIndex;
+
+bool matchesEntry(PathInFileSpec &spec, RecordIndexEntry &e);
+
+//copies the selected records (positions in index.entries) from one file to another in big blocks, coalescing the records which are contiguous in the input
+std::string copyRecords(FILE *input, FILE *output, RecordIndex &index, std::vector<size_t> &selected);
+
 bool read3DPaths(IOPaths &iop, Paths3D &paths);
 bool write3DPaths(IOPaths &iop, Paths3D &paths, PathCloseMode mode);
 int getPathsSerializedSize(Paths3D &paths, PathCloseMode mode);
 
 void writeTriangleMeshToOFF(FILE *f, const char *float_format, TriangleMesh &mesh);
 
+/*binary STL files, read and written with memory-mapped I/O. When reading, the vertices with
+exactly the same coordinates are merged (STL files store each triangle with its own vertices)*/
+std::string writeTriangleMeshToSTL(const char *filename, TriangleMesh &mesh);
+std::string readTriangleMeshFromSTL(const char *filename, TriangleMesh &mesh);
+
 #endif
\ No newline at end of file
@@ -72,6 +72,134 @@ bool PathWriterDelegator::writeEnclosedPaths(PathSplitter::EnclosedPaths &encl,
     return true;
 }
 
+AsyncPathWriter::AsyncPathWriter(std::shared_ptr<PathWriter> _sub, int _maxqueued) : sub(std::move(_sub)), maxqueued(_maxqueued < 1 ? 1 : _maxqueued), busy(false), stopping(false), failed(false), alreadyclosed(false) {
+    filename      = sub->filename;
+    resumeAtStart = sub->resumeAtStart;
+    writer        = std::thread(&AsyncPathWriter::writerLoop, this);
+}
+
+void AsyncPathWriter::writerLoop() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        queueNotEmpty.wait(lock, [this] { return stopping || !queue.empty(); });
+        if (queue.empty()) break; //stopping, and there is nothing else to write
+        QueuedPaths q = std::move(queue.front());
+        queue.pop_front();
+        bool skip = failed; //after an error, remaining paths are discarded
+        busy = true;
+        lock.unlock();
+        queueChanged.notify_all();
+        std::string e;
+        if (!skip) {
+            try {
+                if (!sub->writePaths(q.paths, q.type, q.radius, q.ntool, q.z, q.scaling, q.isClosed)) {
+                    e = str("Error writing paths to ", sub->filename, ": ", sub->err);
+                }
+            } catch (std::exception &ex) {
+                e = str("Exception while writing paths to ", sub->filename, ": ", ex.what());
+            }
+        }
+        lock.lock();
+        busy = false;
+        if (!e.empty()) {
+            failed = true;
+            suberr = std::move(e);
+        }
+        queueChanged.notify_all();
+    }
+}
+
+bool AsyncPathWriter::waitUntilIdle() {
+    std::unique_lock<std::mutex> lock(mutex);
+    queueChanged.wait(lock, [this] { return queue.empty() && !busy; });
+    if (failed) {
+        err = suberr;
+        return false;
+    }
+    return true;
+}
+
+bool AsyncPathWriter::start() {
+    if (!waitUntilIdle()) return false;
+    if (!sub->start()) {
+        err = sub->err;
+        return false;
+    }
+    return true;
+}
+
+bool AsyncPathWriter::writePaths(clp::Paths &paths, int type, double radius, int ntool, double z, double scaling, bool isClosed) {
+    if (!writer.joinable()) {
+        //already closed: behave as the decorated PathWriter, which may have been reopened, so it has to be closed again
+        alreadyclosed = false;
+        if (!sub->writePaths(paths, type, radius, ntool, z, scaling, isClosed)) {
+            err = sub->err;
+            return false;
+        }
+        return true;
+    }
+    QueuedPaths q;
+    q.paths    = paths;
+    q.type     = type;
+    q.radius   = radius;
+    q.ntool    = ntool;
+    q.z        = z;
+    q.scaling  = scaling;
+    q.isClosed = isClosed;
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        queueChanged.wait(lock, [this] { return failed || (queue.size() < maxqueued); });
+        if (failed) {
+            err = suberr;
+            return false;
+        }
+        queue.push_back(std::move(q));
+    }
+    queueNotEmpty.notify_one();
+    return true;
+}
+
+bool AsyncPathWriter::writeEnclosedPaths(PathSplitter::EnclosedPaths &encl, int type, double radius, int ntool, double z, double scaling, bool isClosed) {
+    if (!waitUntilIdle()) return false;
+    if (!sub->writeEnclosedPaths(encl, type, radius, ntool, z, scaling, isClosed)) {
+        err = sub->err;
+        return false;
+    }
+    return true;
+}
+
+bool AsyncPathWriter::finish() {
+    if (!waitUntilIdle()) return false;
+    if (!sub->finish()) {
+        err = sub->err;
+        return false;
+    }
+    return true;
+}
+
+bool AsyncPathWriter::close() {
+    if (alreadyclosed) return true;
+    bool ok = true;
+    if (writer.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        queueNotEmpty.notify_one();
+        writer.join();
+        if (failed) {
+            err = suberr;
+            ok  = false;
+        }
+    }
+    if (!sub->close()) {
+        err = ok ? sub->err : str(err, ". Also, error closing ", sub->filename, ": ", sub->err);
+        ok  = false;
+    }
+    alreadyclosed = true;
+    return ok;
+}
+
 bool PathsFileWriter::start() {
     if (!isOpen) {
         if (numRecordsSet && (numRecords < 0)) {
@@ -87,21 +215,23 @@ bool PathsFileWriter::start() {
             }
         }
         isOpen = true;
+        //the index is not written to pipes, nor if the number of records is set from the outside
+        writeIndex = !f_already_open && !numRecordsSet;
         if (resumeAtStart) {
             FileHeader fheader; //attention: this will break if the file's FileHeader has a different size than the current one!
             err = fheader.readFromFile(f);
             if (!err.empty()) return false;
             numRecords = fheader.numRecords;
             //fseek(f, 0 , SEEK_END); //fast but brittle
-            int64 totalSize;
-            for (int i = 0; i < numRecords; ++i) { //slower but more robust
-                if (fread(&totalSize,  sizeof(totalSize),  1, f) != 1) { err = str("output pathsfile <", filename, ">: could not read size of record ", i); return false; }
-                long toSkip = (long)(totalSize - sizeof(totalSize));
-                if (toSkip>0) if (fseek(f, toSkip, SEEK_CUR)!=0) { err = str("output pathsfile <", filename, ">: could skip record ", i); return false; }
-                /*there is no way to portably truncate a file using the stdio.h interface.
-                However, we assume that it is not actually necessary to do it, because we will eventually overwrite all the contents
-                (and if not, the final FileHeader's numToRecords is anyway used to iterate over the file's contents, so it is not relevant if there is some gargabe at the end of the file)*/
-            }
+            //read the existing records to resume the index. Their bounding boxes are recomputed, so the index is the same as in an uninterrupted run
+            int64 firstRecordOffset = ftell64(f);
+            std::string e = index.buildFromFile(f, fheader, firstRecordOffset, writeIndex);
+            if (!e.empty()) { err = str("output pathsfile <", filename, ">: ", e); return false; }
+            nextOffset = index.entries.empty() ? firstRecordOffset : index.entries.back().offset + index.entries.back().totalSize;
+            /*there is no way to portably truncate a file using the stdio.h interface.
+            However, we assume that it is not actually necessary to do it, because we will eventually overwrite all the contents
+            (and if not, the final FileHeader's numToRecords is anyway used to iterate over the file's contents, so it is not relevant if there is some gargabe at the end of the file;
+            a stale index is also detected because it does not match the records)*/
         } else {
             err = fileheader->writeToFile(f, false);
             if (fwrite(&numRecords, sizeof(numRecords), 1, f) != 1) {
@@ -109,6 +239,7 @@ bool PathsFileWriter::start() {
                 return false;
             }
             if (!err.empty()) return false;
+            if (writeIndex) nextOffset = ftell64(f);
         }
     }
     return true;
@@ -119,14 +250,30 @@ bool PathsFileWriter::writePaths(clp::Paths &paths, int type, double radius, int
         if (!start()) return false;
     }
     PathCloseMode mode = isClosed ? PathLoop : PathOpen;
-    err = writeSlice(f, SliceHeader(paths, mode, type, ntool, z, saveFormat, scaling), paths, mode);
+    SliceHeader sliceheader(paths, mode, type, ntool, z, saveFormat, scaling);
+    err = writeSlice(f, sliceheader, paths, mode);
     if (err.empty() && !numRecordsSet) ++numRecords;
+    if (err.empty() && writeIndex) {
+        index.entries.emplace_back(sliceheader, nextOffset);
+        index.entries.back().setBB(paths);
+        nextOffset += sliceheader.totalSize;
+    }
     return err.empty();
 }
 
 bool PathsFileWriter::close() {
     bool ok = true;
     if (isOpen) {
+        if (writeIndex) {
+            //we are just after the last record
+            std::string e = index.writeToFile(f);
+            if (!e.empty()) {
+                ok = false;
+                err = str("output pathsfile <", filename, ">: ", e);
+            }
+            index.entries.clear();
+            writeIndex = false;
+        }
         if (!numRecordsSet) {
             int numToSkip = fileheader->numRecordsOffset();
             if (fseek(f, numToSkip, SEEK_SET) == 0) {
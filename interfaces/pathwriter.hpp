@@ -3,6 +3,10 @@
 
 #include "pathsfile.hpp"
 #include "pathsplitter.hpp"
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
 
 //base abstract class with interface to serialize sequences of clp::Paths
 class PathWriter {
@@ -20,6 +24,8 @@ public:
         //this is the most sensible default definition for this method
         return writePaths(encl.paths, type, radius, ntool, z, scaling, isClosed);
     }
+    //wait until all paths passed to writePaths() have actually been written. Only asynchronous writers have to override this method
+    virtual bool finish() { return true; }
     virtual bool close() = 0;
 };
 
@@ -43,10 +49,11 @@ protected:
     bool isopen;
 };
 
-//this class implements a PathWriter using the file format specified by FileHeader and SliceHeader
+/*this class implements a PathWriter using the file format specified by FileHeader and SliceHeader.
+If the writer opens the file itself, a RecordIndex (with the bounding box of each record) is written after the last record*/
 class PathsFileWriter : public PathWriter {
 public:
-    PathsFileWriter(bool resume, std::string file, FILE *_f, std::shared_ptr<FileHeader> _fileheader, int64 _saveFormat) : f(_f), f_already_open(_f != NULL), isOpen(false), saveFormat(_saveFormat), fileheader(std::move(_fileheader)), numRecords(0), numRecordsSet(false) { filename = std::move(file); resumeAtStart = resume;}
+    PathsFileWriter(bool resume, std::string file, FILE *_f, std::shared_ptr<FileHeader> _fileheader, int64 _saveFormat) : f(_f), f_already_open(_f != NULL), isOpen(false), saveFormat(_saveFormat), fileheader(std::move(_fileheader)), numRecords(0), numRecordsSet(false), writeIndex(false), nextOffset(0) { filename = std::move(file); resumeAtStart = resume;}
     virtual ~PathsFileWriter() { close(); }
     virtual bool start();
     void setNumRecords(int64 _numRecords) { numRecordsSet = true; numRecords = _numRecords; } //this method is required when the FILE* is a pipe because of the way standalone.cpp is structured
@@ -58,6 +65,46 @@ protected:
     int64 saveFormat;
     int64 numRecords;
     bool isOpen, f_already_open, numRecordsSet;
+    bool writeIndex;
+    RecordIndex index;
+    int64 nextOffset; //file offset of the next record
+};
+
+/*decorator to do the writing of another PathWriter in a background thread, so slow I/O does not stall the computation.
+writePaths() copies the paths to a bounded queue (blocking if it is full). If the decorated PathWriter fails, the
+error is reported in the next call to writePaths(), finish() or close(), and the remaining queued paths are discarded.
+start(), writeEnclosedPaths() and finish() wait until the queue is empty, and close() also terminates the background thread*/
+class AsyncPathWriter : public PathWriter {
+public:
+    AsyncPathWriter(std::shared_ptr<PathWriter> _sub, int _maxqueued);
+    virtual ~AsyncPathWriter() { close(); }
+    virtual bool start();
+    virtual bool writePaths(clp::Paths &paths, int type, double radius, int ntool, double z, double scaling, bool isClosed);
+    virtual bool writeEnclosedPaths(PathSplitter::EnclosedPaths &encl, int type, double radius, int ntool, double z, double scaling, bool isClosed);
+    virtual bool finish();
+    virtual bool close();
+    PathWriter *getWriter() { return sub.get(); }
+protected:
+    typedef struct QueuedPaths {
+        clp::Paths paths;
+        int type;
+        double radius;
+        int ntool;
+        double z;
+        double scaling;
+        bool isClosed;
+    } QueuedPaths;
+    void writerLoop();
+    bool waitUntilIdle();
+    std::shared_ptr<PathWriter> sub;
+    std::deque<QueuedPaths> queue;
+    size_t maxqueued;
+    std::mutex mutex;
+    std::condition_variable queueNotEmpty, queueChanged;
+    std::thread writer;
+    std::string suberr;
+    bool busy, stopping, failed;
+    bool alreadyclosed;
 };
 
 typedef std::function<std::shared_ptr<PathWriter>(bool, int, PathSplitter&, std::string&, std::string, bool, bool, bool)> SplittingSubPathWriterCreator;
@@ -81,6 +128,7 @@ public:
     virtual bool writePaths(clp::Paths &paths, int type, double radius, int ntool, double z, double scaling, bool isClosed);
     virtual bool close();
     virtual bool finishBeforeClose() { return true; } //this method will get called before closing all subwritters, if everything is OK up to that point
+    void setNumThreads(int numthreads) { for (auto &state : states) state.splitter.numthreads = numthreads; }
 protected:
     SplittingPathWriter() {} //this constructor is to be used by subclasses
     bool setup(bool resume, std::shared_ptr<ClippingResources> _res, int ntools, Configuration *_cfg, SplittingSubPathWriterCreator &callback, PathSplitterConfigs splitterconfs, std::string file, bool generic_type, bool generic_ntool, bool generic_z);
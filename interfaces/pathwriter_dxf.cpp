@@ -106,27 +106,37 @@ template<DXFWMode mode> bool DXFPathWriter<mode>::specificClose() {
     return ok;
 }
 
+//in ascii mode, the polylines are formatted into a buffer, which is flushed at the end of each call to writePathsSpecific()
+static FormatPlan polylineHeaderPlan(
+    "0\nPOLYLINE\n"
+    "8\n0\n" //the layer
+    "39\n%.20g\n" //width
+    "100\nAcDb2dPolyline\n"
+    "66\n1\n" //"entities follow flag"
+    "10\n0.0\n"
+    "20\n0.0\n"
+    "30\n%.20g\n" //elevation
+    "70\n%d\n"); //isClosed
+
+static FormatPlan vertexPlan(
+    "0\nVERTEX\n"
+    "8\n0\n" //the layer
+    //"62\n[COLORNUMBER]\n" //color number
+    //"420\n[RGB]\n" //number representing color value in 24-bit format
+    "100\nAcDb2dVertex\n" //subclass marker
+    "10\n%.20g\n" //X
+    "20\n%.20g\n" //Y
+    "30\n0\n"); //Elevation (absolute or relative? if absolute, we have to repeat it here)
+
 template<DXFWMode mode> bool DXFPathWriter<mode>::writePathsSpecific(clp::Paths &paths, int type, double radius, int ntool, double z, double scaling, bool isClosed) {
     if (this->isopen && (!paths.empty())) {
         double width = this->generic_for_ntool ? (2 * radius) : 0.0;
         double elevation = this->generic_for_z ? z : 0.0;
+        if (mode == DXFAscii) buffer.setFile(this->f);
         for (auto & path : paths) {
             if (path.empty()) continue;
             if (mode == DXFAscii) {
-                if (fprintf(this->f,
-                    "0\nPOLYLINE\n"
-                    "8\n0\n" //the layer
-                    "39\n%.20g\n" //width
-                    "100\nAcDb2dPolyline\n"
-                    "66\n1\n" //"entities follow flag"
-                    "10\n0.0\n"
-                    "20\n0.0\n"
-                    "30\n%.20g\n" //elevation
-                    "70\n%d\n", //isClosed
-                    width, elevation, isClosed != 0) < 0) {
-                    this->err = str("Error writing polyline header to file <", this->filename, "> in DXFPathWriter::writePathsSpecific()");
-                    return false;
-                };
+                polylineHeaderPlan.print(buffer, width, elevation, (int)(isClosed != 0));
             } else {
                 const char POLYHEADER[] =
                     "\x00" "POLYLINE\x00"
@@ -166,21 +176,7 @@ template<DXFWMode mode> bool DXFPathWriter<mode>::writePathsSpecific(clp::Paths
             }
             for (auto &point : path) {
                 if (mode == DXFAscii) {
-                    if (fprintf(this->f,
-                        "0\nVERTEX\n"
-                        "8\n0\n" //the layer
-                        //"62\n[COLORNUMBER]\n" //color number
-                        //"420\n[RGB]\n" //number representing color value in 24-bit format
-                        "100\nAcDb2dVertex\n" //subclass marker
-                        "10\n%.20g\n" //X
-                        "20\n%.20g\n" //Y
-                        "30\n0\n", //Elevation (absolute or relative? if absolute, we have to repeat it here)
-                        point.X*scaling,
-                        point.Y*scaling
-                        ) < 0) {
-                        this->err = str("Error writing polyline points to file <", this->filename, "> in DXFPathWriter::writePathsSpecific()");
-                        return false;
-                    }
+                    vertexPlan.print(buffer, point.X*scaling, point.Y*scaling);
                 } else {
                     double val;
                     const char VERTEX[] =
@@ -215,10 +211,8 @@ template<DXFWMode mode> bool DXFPathWriter<mode>::writePathsSpecific(clp::Paths
                 }
             }
             if (mode == DXFAscii) {
-                if (fprintf(this->f, "0\nSEQEND\n") < 0) {
-                    this->err = str("Error writing polyline end to file <", this->filename, "> in DXFPathWriter::writePathsSpecific()");
-                    return false;
-                }
+                const char SEQEND[] = "0\nSEQEND\n";
+                buffer.append(SEQEND, sizeof(SEQEND) - 1);
             } else {
                 const char SEQEND[] = "\x00" "SEQEND\x00";
                 if (fwrite(SEQEND, sizeof(char), sizeof(SEQEND) - 1, this->f) != (sizeof(SEQEND) - 1)) {
@@ -227,6 +221,10 @@ template<DXFWMode mode> bool DXFPathWriter<mode>::writePathsSpecific(clp::Paths
                 }
             }
         }
+        if ((mode == DXFAscii) && !buffer.flush()) {
+            this->err = str("Error writing polylines to file <", this->filename, "> in DXFPathWriter::writePathsSpecific()");
+            return false;
+        }
     }
     return true;
 }
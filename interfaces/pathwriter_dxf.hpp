@@ -2,6 +2,7 @@
 #define PATHWRITER_DXF_HEADER
 
 #include "pathwriter_multifile.hpp"
+#include "fastformat.hpp"
 
 enum DXFWMode { DXFAscii, DXFBinary };
 
@@ -15,6 +16,8 @@ public:
     bool endWriter();
     bool writePathsSpecific(clp::Paths &paths, int type, double radius, int ntool, double z, double scaling, bool isClosed);
     bool specificClose();
+protected:
+    TextBuffer buffer; //used only in ascii mode
 };
 
 typedef DXFPathWriter<DXFAscii>  DXFAsciiPathWriter;
@@ -19,6 +19,7 @@ void SimpleNanoscribeConfig::init(MetricFactors &factors) {
     }
     stagegotoFormatting = str("StageGoto%c ", nanoscribeNumberFormatting, "\n");
     pointLineFormatting = str(nanoscribeNumberFormatting, ' ', nanoscribeNumberFormatting, " 0\n");
+    pointLinePlan.compile(pointLineFormatting);
     zoffsetFormatting   = str("AddZOffset ", nanoscribeNumberFormatting, "\n");
     addzdriveFormatting = str("AddZDrivePosition ", nanoscribeNumberFormatting, " %%change z block from %d to %d\nAddZOffset ", nanoscribeNumberFormatting, "\n");
 }
@@ -221,26 +222,24 @@ bool SimpleNanoscribePathWriter::writePathsSpecific(clp::Paths &paths, int type,
                 if (config->snapToGrid) {
                     simpleSnapPathsToGrid(paths, config->snapspec);
                 }
-                //write paths
+                //write paths (buffered, the buffer is always flushed before writing to the file by other means)
+                static FormatPlan startPathPlan("%%Write path %d/%d\n");
+                const char endPath[] = "write\n";
                 int n = (int)paths.size();
                 int k = 0;
+                buffer.setFile(this->f);
                 for (auto &path : paths) {
-                    if (fprintf(this->f, "%%Write path %d/%d\n", k, n) < 0) {
-                        err = str("error writing starting comment for path ", k, '/', n, " to file <", this->filename, "> in SimpleNanoscribePathWriter::writePathsSpecific()");
-                        return false;
-                    }
+                    startPathPlan.print(buffer, k, n);
                     for (auto &point : path) {
-                        if (fprintf(this->f, config->pointLineFormatting.c_str(), point.X*config->factor_internal_to_nanoscribe, point.Y*config->factor_internal_to_nanoscribe) < 0) {
-                            err = str("error writing point command for path ", k, '/', n, " to file <", this->filename, "> in SimpleNanoscribePathWriter::writePathsSpecific()");
-                            return false;
-                        }
-                    }
-                    if (fprintf(this->f, "write\n") < 0) {
-                        err = str("error writing end command for path ", k, '/', n, " to file <", this->filename, "> in SimpleNanoscribePathWriter::writePathsSpecific()");
-                        return false;
+                        config->pointLinePlan.print(buffer, point.X*config->factor_internal_to_nanoscribe, point.Y*config->factor_internal_to_nanoscribe);
                     }
+                    buffer.append(endPath, sizeof(endPath) - 1);
                     ++k;
                 }
+                if (!buffer.flush()) {
+                    err = str("error writing ", n, " paths to file <", this->filename, "> in SimpleNanoscribePathWriter::writePathsSpecific()");
+                    return false;
+                }
                 lastSquare = std::move(square);
             } else {
                 /*this is rather inefficient, we will optimize it (both in terms of C++ code and of generated GWL code) if necessary.
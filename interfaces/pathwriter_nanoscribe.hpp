@@ -2,6 +2,7 @@
 #define PATHWRITER_NANOSCRIBE_HEADER
 
 #include "pathwriter_multifile.hpp"
+#include "fastformat.hpp"
 
 enum NanoscribeScanMode { PiezoScanMode, GalvoScanMode };
 enum GalvoPositionMode { GalvoAlwaysCenter, GalvoMinimizeMovements };
@@ -32,6 +33,7 @@ typedef struct SimpleNanoscribeConfig {
     SnapToGridSpec snapspec;
     std::string stagegotoFormatting;
     std::string pointLineFormatting;
+    FormatPlan pointLinePlan;
     std::string zoffsetFormatting;
     std::string addzdriveFormatting;
     double NanoscribePiezoRangeInternalUnits;
@@ -75,6 +77,7 @@ protected:
     int current_z_block;
     bool firstTime, beforeFirstDifferentZ;
     bool overrideGalvoMode;
+    TextBuffer buffer;
 };
 
 //specialization of SplittingPathWriter for Nanoscribe: it writes a main GWL script that includes all other GWL scripts
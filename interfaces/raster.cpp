@@ -0,0 +1,222 @@
+#include "raster.hpp"
+#include "pathsfile.hpp"
+#include <stdint.h>
+#include <string.h>
+#include <cmath>
+#include <algorithm>
+
+void RasterSpec::fitTo(double bbminx, double bbmaxx, double bbminy, double bbmaxy, int margin) {
+    minx   = bbminx - margin * pitch;
+    maxy   = bbmaxy + margin * pitch;
+    width  = std::max(1, (int)std::ceil((bbmaxx - bbminx) / pitch) + 2 * margin);
+    height = std::max(1, (int)std::ceil((bbmaxy - bbminy) / pitch) + 2 * margin);
+}
+
+//non-horizontal edge in subsample coordinates (Y grows downwards). It is sampled by the scanlines in [first, last)
+typedef struct RasterEdge {
+    double x0, y0, dxdy;
+    int first, last;
+    int winding;
+} RasterEdge;
+
+typedef struct RasterCrossing {
+    double x;
+    int winding;
+    bool operator<(const RasterCrossing &other) const { return x < other.x; }
+} RasterCrossing;
+
+/*the scanlines are sampled at the centers of the subsamples: scanline j is at y=j+0.5, and
+subsample column k is covered by a span [x0, x1) if x0 <= k+0.5 < x1*/
+static void addEdge(std::vector<RasterEdge> &edges, double x0, double y0, double x1, double y1, int numscanlines) {
+    if (y0 == y1) return;
+    RasterEdge e;
+    e.winding = y0 < y1 ? 1 : -1;
+    if (y0 > y1) { std::swap(x0, x1); std::swap(y0, y1); }
+    e.first   = (int)std::max(0.0,                 std::ceil(y0 - 0.5));
+    e.last    = (int)std::min((double)numscanlines, std::ceil(y1 - 0.5));
+    if (e.first >= e.last) return;
+    e.x0      = x0;
+    e.y0      = y0;
+    e.dxdy    = (x1 - x0) / (y1 - y0);
+    edges.push_back(e);
+}
+
+void rasterizePaths(clp::Paths &paths, double scaling, RasterSpec &spec, std::vector<unsigned char> &image) {
+    const int n            = std::max(1, spec.subsamples);
+    const int numscanlines = spec.height * n;
+    const int numcolumns   = spec.width  * n;
+    image.assign((size_t)spec.width * spec.height, spec.outside);
+
+    //transform the points to subsample coordinates, and build the edge list
+    const double factor = scaling * n / spec.pitch;
+    const double shiftx = spec.minx * n / spec.pitch;
+    const double shifty = spec.maxy * n / spec.pitch;
+    std::vector<RasterEdge> edges;
+    for (auto &path : paths) {
+        if (path.size() < 2) continue;
+        double px = path.back().X * factor - shiftx, py = shifty - path.back().Y * factor;
+        for (auto &point : path) {
+            double x = point.X * factor - shiftx, y = shifty - point.Y * factor;
+            addEdge(edges, px, py, x, y, numscanlines);
+            px = x;
+            py = y;
+        }
+    }
+    std::sort(edges.begin(), edges.end(), [](const RasterEdge &a, const RasterEdge &b) { return a.first < b.first; });
+
+    std::vector<RasterEdge*> active;
+    std::vector<RasterCrossing> crossings;
+    std::vector<int> coverage(spec.width);
+    const int maxcoverage = n * n;
+    const int range       = (int)spec.inside - (int)spec.outside;
+    size_t nextEdge       = 0;
+
+    for (int row = 0; row < spec.height; ++row) {
+        bool anything = false;
+        for (int j = row * n; j < (row + 1) * n; ++j) {
+            //update the active edge list
+            active.erase(std::remove_if(active.begin(), active.end(), [j](RasterEdge *e) { return e->last <= j; }), active.end());
+            while ((nextEdge < edges.size()) && (edges[nextEdge].first <= j)) active.push_back(&edges[nextEdge++]);
+            if (active.empty()) continue;
+
+            crossings.clear();
+            double y = j + 0.5;
+            for (auto e : active) {
+                RasterCrossing c;
+                c.x       = e->x0 + (y - e->y0) * e->dxdy;
+                c.winding = e->winding;
+                crossings.push_back(c);
+            }
+            std::sort(crossings.begin(), crossings.end());
+
+            //fill the spans inside the polygons
+            int winding = 0;
+            double spanStart = 0;
+            for (auto &c : crossings) {
+                bool wasInside = spec.evenOdd ? (winding & 1) != 0 : winding != 0;
+                winding       += spec.evenOdd ? 1 : c.winding;
+                bool isInside  = spec.evenOdd ? (winding & 1) != 0 : winding != 0;
+                if (!wasInside && isInside) {
+                    spanStart = c.x;
+                } else if (wasInside && !isInside) {
+                    int a = (int)std::max(0.0,               std::ceil(spanStart - 0.5));
+                    int b = (int)std::min((double)numcolumns, std::ceil(c.x      - 0.5));
+                    while (a < b) {
+                        int pixel = a / n;
+                        int end   = std::min(b, (pixel + 1) * n);
+                        coverage[pixel] += end - a;
+                        a = end;
+                    }
+                    anything = true;
+                }
+            }
+        }
+        if (!anything) continue;
+        unsigned char *out = &image[(size_t)row * spec.width];
+        for (int x = 0; x < spec.width; ++x) {
+            if (coverage[x] != 0) {
+                out[x] = (unsigned char)(spec.outside + (range * coverage[x] + (range >= 0 ? maxcoverage / 2 : -maxcoverage / 2)) / maxcoverage);
+                coverage[x] = 0;
+            }
+        }
+    }
+}
+
+std::string writePGM(const char *filename, std::vector<unsigned char> &image, int width, int height) {
+    FILEOwner f(filename, "wb");
+    if (!f.isopen()) { return str("Could not open output file ", filename); }
+    fprintf(f.f, "P5\n%d %d\n255\n", width, height);
+    if (!image.empty() && (fwrite(&image.front(), 1, image.size(), f.f) != image.size())) { return str("Could not write to output file ", filename); }
+    if (!f.close()) { return str("Could not close output file ", filename); }
+    return std::string();
+}
+
+static const struct CRCTable {
+    uint32_t values[256];
+    CRCTable() {
+        for (uint32_t n = 0; n < 256; ++n) {
+            uint32_t c = n;
+            for (int k = 0; k < 8; ++k) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            values[n] = c;
+        }
+    }
+} crcTable;
+
+static void appendUint32(std::vector<unsigned char> &out, uint32_t value) {
+    out.push_back((unsigned char)(value >> 24));
+    out.push_back((unsigned char)(value >> 16));
+    out.push_back((unsigned char)(value >> 8));
+    out.push_back((unsigned char)(value));
+}
+
+//appends a PNG chunk: length, type, data and the CRC of type+data
+static void appendChunk(std::vector<unsigned char> &out, const char *type, const unsigned char *data, size_t size) {
+    appendUint32(out, (uint32_t)size);
+    size_t start = out.size();
+    out.insert(out.end(), type, type + 4);
+    if (size > 0) out.insert(out.end(), data, data + size);
+    uint32_t crc = 0xFFFFFFFFu;
+    for (size_t k = start; k < out.size(); ++k) crc = crcTable.values[(crc ^ out[k]) & 0xFF] ^ (crc >> 8);
+    appendUint32(out, crc ^ 0xFFFFFFFFu);
+}
+
+/*the image data is stored in a zlib stream made of uncompressed deflate blocks. Masks would compress
+very well, but this way the output does not depend on zlib, and writing is just copying*/
+std::string writePNG(const char *filename, std::vector<unsigned char> &image, int width, int height) {
+    //each row is preceded by its filter type (0: none)
+    std::vector<unsigned char> raw((size_t)height * (width + 1), 0);
+    for (int row = 0; row < height; ++row) {
+        if (width > 0) memcpy(&raw[(size_t)row * (width + 1) + 1], &image[(size_t)row * width], width);
+    }
+
+    const size_t maxBlock = 65535;
+    std::vector<unsigned char> zlib;
+    zlib.reserve(raw.size() + (raw.size() / maxBlock + 1) * 5 + 6);
+    zlib.push_back(0x78);
+    zlib.push_back(0x01);
+    size_t pos = 0;
+    do {
+        size_t blockSize = std::min(maxBlock, raw.size() - pos);
+        zlib.push_back((pos + blockSize) == raw.size() ? 1 : 0); //BFINAL, BTYPE=00 (stored)
+        zlib.push_back((unsigned char)(blockSize));
+        zlib.push_back((unsigned char)(blockSize >> 8));
+        zlib.push_back((unsigned char)(~blockSize));
+        zlib.push_back((unsigned char)(~blockSize >> 8));
+        zlib.insert(zlib.end(), raw.begin() + pos, raw.begin() + pos + blockSize);
+        pos += blockSize;
+    } while (pos < raw.size());
+    //Adler-32 checksum. 5552 is the biggest number of bytes that can be added before the sums overflow 32 bits
+    uint32_t adlerA = 1, adlerB = 0;
+    for (size_t start = 0; start < raw.size(); start += 5552) {
+        size_t end = std::min(raw.size(), start + 5552);
+        for (size_t k = start; k < end; ++k) {
+            adlerA += raw[k];
+            adlerB += adlerA;
+        }
+        adlerA %= 65521;
+        adlerB %= 65521;
+    }
+    appendUint32(zlib, (adlerB << 16) | adlerA);
+
+    std::vector<unsigned char> png;
+    png.reserve(zlib.size() + 64);
+    const unsigned char signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+    png.insert(png.end(), signature, signature + 8);
+    std::vector<unsigned char> ihdr;
+    appendUint32(ihdr, (uint32_t)width);
+    appendUint32(ihdr, (uint32_t)height);
+    ihdr.push_back(8); //bit depth
+    ihdr.push_back(0); //color type: grayscale
+    ihdr.push_back(0); //compression method
+    ihdr.push_back(0); //filter method
+    ihdr.push_back(0); //no interlacing
+    appendChunk(png, "IHDR", &ihdr.front(), ihdr.size());
+    appendChunk(png, "IDAT", &zlib.front(), zlib.size());
+    appendChunk(png, "IEND", NULL, 0);
+
+    FILEOwner f(filename, "wb");
+    if (!f.isopen()) { return str("Could not open output file ", filename); }
+    if (fwrite(&png.front(), 1, png.size(), f.f) != png.size()) { return str("Could not write to output file ", filename); }
+    if (!f.close()) { return str("Could not close output file ", filename); }
+    return std::string();
+}
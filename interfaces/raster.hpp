@@ -0,0 +1,34 @@
+#ifndef RASTER_HEADER
+#define RASTER_HEADER
+
+#include "auxgeom.hpp"
+#include <string>
+#include <vector>
+
+/*scanline rasterizer for slices, to generate bitmaps for mask-projection (DLP) printers.
+The paths are treated as closed polygons (the last point is joined to the first one), and
+filled with either the even-odd or the non-zero rule. With antialiasing, each pixel is sampled
+in a grid of subsamples, and its gray level is proportional to the covered fraction*/
+//upper limit for RasterSpec::subsamples, so the number of scanlines and the coverage counts stay well within the range of int
+#define RASTER_MAX_SUBSAMPLES 64
+
+typedef struct RasterSpec {
+    double pitch;                  //size of the pixels, in the units of the paths after applying the scaling
+    double minx, maxy;             //coordinates of the top-left corner of the image (rows are stored from top to bottom)
+    int width, height;
+    int subsamples;                //antialiasing: each pixel is sampled in a grid of subsamples x subsamples (1: no antialiasing)
+    bool evenOdd;                  //fill rule: even-odd if true, non-zero otherwise
+    unsigned char inside, outside; //gray levels
+    RasterSpec() : pitch(1), minx(0), maxy(0), width(0), height(0), subsamples(1), evenOdd(false), inside(255), outside(0) {}
+    //sets the position and size of the image to enclose the box (in the units of the paths after applying the scaling), plus a margin in pixels
+    void fitTo(double bbminx, double bbmaxx, double bbminy, double bbmaxy, int margin);
+} RasterSpec;
+
+//renders the paths into the image (8-bit grayscale, width*height pixels, row by row)
+void rasterizePaths(clp::Paths &paths, double scaling, RasterSpec &spec, std::vector<unsigned char> &image);
+
+//8-bit grayscale image files. PNG files are written without compression, so no external library is needed
+std::string writePGM(const char *filename, std::vector<unsigned char> &image, int width, int height);
+std::string writePNG(const char *filename, std::vector<unsigned char> &image, int width, int height);
+
+#endif
@@ -2,10 +2,23 @@
 #include "subprocess.hpp"
 #include "iopaths.hpp"
 #include <cmath>
+#include <stdlib.h>
 
 /*strictly speaking, spawning a different process for the slicer is only required if
 we are compiling under MSVS (as slic3r does not compile in MSVS). As the overhead
-seems to be fairly small, we keep it this way for all platforms.*/
+seems to be fairly small, we keep it this way for all platforms.
+
+If streamWindow is 0, all Z values are sent upfront, and the slices are read with IOPaths.
+Otherwise, the slicer is started with the argument 'streaming', and the protocol is:
+    -the Z values are sent on demand, as an int64 count followed by that many doubles, keeping
+     at least streamWindow slices requested but not read, and also all slices up to the ones
+     the consumer has declared it needs (requestSlices()). An int64 0 ends the stream, and it is
+     sent as soon as the last needed Z value has been requested: Z values which are skipped or
+     cancelled (cancelSlicesFrom()) before they have been requested are never sent (nor sliced)
+    -each slice is sent as a single block: an int64 with the size in bytes of the rest of the
+     block, then an int64 with the number of paths, an int64 with the number of points of each
+     path, and the X and Y coordinates of all points, as int64 values. This way, each slice is
+     read with just two calls to fread() instead of a few for each path*/
 class ExternalSlicerManager : public SlicerManager {
     SubProcessManager subp;
     IOPaths iopIN, iopOUT;
@@ -17,23 +30,33 @@ class ExternalSlicerManager : public SlicerManager {
     std::string workdir;
     std::string err;
     std::vector<double> values;
+    std::vector<clp::cInt> block;
     double scaled;
     double scalingFactor;
     double z_for_last_slice;
     long   scale;
     int    numSlice;
+    int    streamWindow;
+    int    numRequested;
+    int    numWanted; //slices up to this one have been declared as needed soon by the consumer
+    int    numNeeded; //slices from this one on will not be read
+    bool   streamEnded;
     bool   useIntegerScale;
     bool   repair, incremental;
+    bool requestZs();
+    bool readSliceBlock(clp::Paths &nextSlice);
+    void scaleSlice(clp::Paths &nextSlice);
 public:
     ExternalSlicerManager(
 #ifdef SLICER_USE_DEBUG_FILE
         std::string _debugfile,
 #endif
-    std::string _postfix, std::string _execpath, std::string _workdir, bool _repair, bool _incremental, double _scaled) :
+    std::string _postfix, std::string _execpath, std::string _workdir, bool _repair, bool _incremental, int _streamWindow, double _scaled) :
+    subp(true, true),
 #ifdef SLICER_USE_DEBUG_FILE
     debugfile(std::move(_debugfile)),
 #endif
-    subp(true, true), postfix(_postfix), execpath(std::move(_execpath)), workdir(std::move(_workdir)), repair(_repair), incremental(_incremental), scaled(_scaled), scale((long)_scaled), useIntegerScale(((double)scale)==scaled), scalingFactor(0.0) {}
+    postfix(_postfix), execpath(std::move(_execpath)), workdir(std::move(_workdir)), scaled(_scaled), scalingFactor(0.0), scale((long)_scaled), numSlice(0), streamWindow(_streamWindow), numRequested(0), numWanted(0), numNeeded(0), streamEnded(false), useIntegerScale(((double)scale)==scaled), repair(_repair), incremental(_incremental) {}
     virtual ~ExternalSlicerManager() { finalize(); }
     virtual bool start(const char * stlfilename);
     virtual bool terminate();
@@ -44,13 +67,20 @@ public:
     virtual bool sendZs(std::vector<double> _values);
     virtual bool readNextSlice(clp::Paths &nextSlice);
     virtual double getZForPreviousSlice() { return z_for_last_slice; }
-    virtual bool reachedEnd() { return numSlice >= values.size(); }
+    virtual bool reachedEnd() { return numSlice >= numNeeded; }
     virtual bool skipNextSlices(int numSkip);
+    virtual bool requestSlices(int numSlices);
+    virtual bool cancelSlicesFrom(int numSlice);
 };
 
 bool ExternalSlicerManager::start(const char * stlfilename) {
     if (subp.started()) { return false; }
-    numSlice = 0;
+    values.clear();
+    numSlice     = 0;
+    numRequested = 0;
+    numWanted    = 0;
+    numNeeded    = 0;
+    streamEnded  = false;
     subp.execpath = execpath;
     subp.workdir = workdir;
     subp.args.clear();
@@ -62,6 +92,7 @@ bool ExternalSlicerManager::start(const char * stlfilename) {
 #endif
     subp.args.push_back(std::string(repair ? "repair" : "norepair"));
     subp.args.push_back(std::string(incremental ? "incremental" : "noincremental"));
+    if (streamWindow > 0) subp.args.push_back(std::string("streaming"));
     subp.args.push_back(stlfilename);
     
     if (!postfix.empty()) subp.exename += postfix;
@@ -80,6 +111,11 @@ bool ExternalSlicerManager::terminate() {
 }
 
 bool ExternalSlicerManager::finalize() {
+    //in streaming mode, the slicer waits for more Z values until the stream is ended
+    if ((streamWindow > 0) && subp.started() && !streamEnded) {
+        streamEnded = true;
+        if (iopIN.writeInt64(0)) fflush(subp.pipeIN);
+    }
     subp.wait();
     return true;
 }
@@ -116,6 +152,11 @@ double ExternalSlicerManager::getScalingFactor() {
 
 bool ExternalSlicerManager::sendZs(std::vector<double> _values) {
     values    = std::move(_values);
+    numNeeded = (int)values.size();
+    if (streamWindow > 0) {
+        numRequested = 0;
+        return requestZs();
+    }
     int64 num = (int64)values.size();
     if (!iopIN.writeInt64(num)) {
         err = "could not write number of Z values to the slicer!!!";
@@ -153,12 +194,96 @@ std::vector<double> prepareSTLSimple(double zmin, double zmax, double zstep) {
     return zs;
 }
 
-bool ExternalSlicerManager::readNextSlice(clp::Paths &nextSlice) {
-    z_for_last_slice = values[numSlice];
-    if (!iopOUT.readClipperPaths(nextSlice)) {
+//requests Z values to keep the window full and to get the slices declared as needed, ending the stream after the last needed one
+bool ExternalSlicerManager::requestZs() {
+    if (streamEnded) return true;
+    int64 num = (int64)std::min(numNeeded, std::max(numSlice + streamWindow, numWanted)) - numRequested;
+    if (num > 0) {
+        if (!iopIN.writeInt64(num)) {
+            err = "could not write number of Z values to the slicer!!!";
+            return false;
+        }
+        if (!iopIN.writeDoubleP(&values[numRequested], (size_t)num)) {
+            err = "could not write Z values to the slicer!!!";
+            return false;
+        }
+        numRequested += (int)num;
+    }
+    if (numRequested >= numNeeded) {
+        if (!iopIN.writeInt64(0)) {
+            err = "could not write end of Z values to the slicer!!!";
+            return false;
+        }
+        streamEnded = true;
+    }
+    if ((num > 0) || streamEnded) fflush(subp.pipeIN);
+    return true;
+}
+
+bool ExternalSlicerManager::readSliceBlock(clp::Paths &nextSlice) {
+    int64 size;
+    if (fread(&size, sizeof(size), 1, iopOUT.f) != 1) {
+        err = "Could not read slice size from slicer!!!";
+        return false;
+    }
+    if ((size < (int64)sizeof(clp::cInt)) || ((size % sizeof(clp::cInt)) != 0)) {
+        err = str("Invalid slice size from slicer: ", size);
+        return false;
+    }
+    block.resize((size_t)(size / sizeof(clp::cInt)));
+    if (fread(&block.front(), 1, (size_t)size, iopOUT.f) != (size_t)size) {
         err = "Could not read slice from slicer!!!";
         return false;
     }
+    size_t numpaths = (size_t)block[0];
+    size_t pos      = 1 + numpaths;
+    if ((block[0] < 0) || (pos > block.size())) {
+        err = str("Invalid number of paths in slice from slicer: ", block[0]);
+        return false;
+    }
+    nextSlice.resize(numpaths);
+    for (size_t k = 0; k < numpaths; ++k) {
+        size_t numpoints = (size_t)block[1 + k];
+        if ((block[1 + k] < 0) || ((block.size() - pos) / 2 < numpoints)) {
+            err = str("Invalid number of points in slice from slicer: ", block[1 + k]);
+            return false;
+        }
+        auto &path = nextSlice[k];
+        path.resize(numpoints);
+        for (auto &point : path) {
+            point.X = block[pos++];
+            point.Y = block[pos++];
+        }
+    }
+    if (pos != block.size()) {
+        err = "Invalid slice from slicer: the block is bigger than its contents!!!";
+        return false;
+    }
+    return true;
+}
+
+bool ExternalSlicerManager::readNextSlice(clp::Paths &nextSlice) {
+    if (streamWindow > 0) {
+        if (numSlice >= numNeeded) {
+            err = (numNeeded < values.size()) ? "Trying to read a slice which was cancelled!!!" : "Trying to read more slices than Z values were sent to the slicer!!!";
+            return false;
+        }
+        if (!requestZs()) return false;
+        z_for_last_slice = values[numSlice];
+        if (!readSliceBlock(nextSlice)) return false;
+    } else {
+        z_for_last_slice = values[numSlice];
+        if (!iopOUT.readClipperPaths(nextSlice)) {
+            err = "Could not read slice from slicer!!!";
+            return false;
+        }
+    }
+    scaleSlice(nextSlice);
+    ++numSlice;
+    return true;
+}
+
+void ExternalSlicerManager::scaleSlice(clp::Paths &nextSlice) {
     if (scale != 0) {
         if (useIntegerScale) {
             for (auto &path : nextSlice) for (auto &point : path) {
@@ -172,11 +297,22 @@ bool ExternalSlicerManager::readNextSlice(clp::Paths &nextSlice) {
             }
         }
     }
-    ++numSlice;
-    return true;
 }
 
 bool ExternalSlicerManager::skipNextSlices(int numSkip) {
+    if (streamWindow > 0) {
+        //slices already requested have to be read, but the remaining ones are just never requested
+        clp::Paths dummy;
+        for (int i = 0; (i < numSkip) && (numSlice < numNeeded); ++i) {
+            if (numSlice < numRequested) {
+                if (!readSliceBlock(dummy)) return false;
+            } else {
+                numRequested = numSlice + 1;
+            }
+            ++numSlice;
+        }
+        return requestZs();
+    }
     for (int i = 0; i < numSkip; ++i) {
         clp::Paths dummy;
         if (!readNextSlice(dummy)) return false;
@@ -184,6 +320,20 @@ bool ExternalSlicerManager::skipNextSlices(int numSkip) {
     return true;
 }
 
+bool ExternalSlicerManager::requestSlices(int numSlices) {
+    if ((streamWindow <= 0) || (numSlices <= numWanted)) return true;
+    numWanted = numSlices;
+    return requestZs();
+}
+
+//if all Z values were sent upfront, the slicer computes all slices anyway, but they are not read
+bool ExternalSlicerManager::cancelSlicesFrom(int _numSlice) {
+    numNeeded = std::max(std::min(numNeeded, _numSlice), numSlice);
+    if (streamWindow <= 0) return true;
+    numNeeded = std::max(numNeeded, numRequested);
+    return requestZs();
+}
+
 std::shared_ptr<SlicerManager> getExternalSlicerManager(Configuration &config, MetricFactors &factors, std::string DEBUG_FILE_NAME, std::string postfix) {
     DEBUG_FILE_NAME += postfix;
     return std::make_shared<ExternalSlicerManager>(
@@ -195,6 +345,7 @@ std::shared_ptr<SlicerManager> getExternalSlicerManager(Configuration &config, M
         config.getValue("SLICER_PATH"),
         config.getValue("SLICER_REPAIR").compare("true") == 0,
         config.getValue("SLICER_INCREMENTAL").compare("true") == 0,
+        config.hasKey("SLICER_STREAMING") ? std::max(0, atoi(config.getValue("SLICER_STREAMING").c_str())) : 0,
         factors.slicer_to_internal);
 }
 
@@ -248,6 +399,9 @@ public:
     virtual double getZForPreviousSlice() { return z_for_last_slice; }
     virtual bool reachedEnd() { return numRead >= numRecords; }
     virtual bool skipNextSlices(int numSkip);
+    //the slices are just read from the file, so there is nothing to request or cancel
+    virtual bool requestSlices(int numSlices) { return true; }
+    virtual bool cancelSlicesFrom(int numSlice) { return true; }
 };
 
 bool RawSlicerManager::start(const char * fname) {
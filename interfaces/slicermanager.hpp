@@ -22,6 +22,10 @@ public:
     virtual double getZForPreviousSlice() = 0;
     virtual bool reachedEnd() = 0;
     virtual bool skipNextSlices(int numSkip) = 0;
+    //the first numSlices slices (counting from the first Z value sent) will be needed soon: if the slicer receives the Z values on demand, they are requested right now
+    virtual bool requestSlices(int numSlices) = 0;
+    //the slices from numSlice on will not be read: if the slicer receives the Z values on demand, they are never requested
+    virtual bool cancelSlicesFrom(int numSlice) = 0;
 };
 
 std::vector<double> prepareSTLSimple(double zmin, double zmax, double zbase, double zstep);
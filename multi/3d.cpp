@@ -4,6 +4,54 @@
 #include "slicermanager.hpp"
 #include "showcontours.hpp"
 #include <numeric>
+#include <chrono>
+
+void CompactPaths::reset(size_t numpoints, size_t numpaths, size_t numgroups) {
+    points.clear();
+    pathStarts.clear();
+    groupStarts.clear();
+    points.reserve(numpoints);
+    pathStarts.reserve(numpaths + 1);
+    groupStarts.reserve(numgroups + 1);
+    pathStarts.push_back(0);
+    groupStarts.push_back(0);
+}
+
+void CompactPaths::appendGroup(clp::Paths &paths) {
+    for (auto &path : paths) {
+        points.insert(points.end(), path.begin(), path.end());
+        pathStarts.push_back(points.size());
+    }
+    groupStarts.push_back(pathStarts.size() - 1);
+}
+
+void CompactPaths::assign(clp::Paths &paths) {
+    size_t numpoints = 0;
+    for (auto &path : paths) numpoints += path.size();
+    reset(numpoints, paths.size(), 1);
+    appendGroup(paths);
+}
+
+void CompactPaths::assign(std::vector<clp::Paths> &pathss) {
+    size_t numpoints = 0, numpaths = 0;
+    for (auto &paths : pathss) {
+        numpaths += paths.size();
+        for (auto &path : paths) numpoints += path.size();
+    }
+    reset(numpoints, numpaths, pathss.size());
+    for (auto &paths : pathss) appendGroup(paths);
+}
+
+void CompactPaths::getPaths(size_t first, size_t last, clp::Paths &output) {
+    output.resize(last - first);
+    for (size_t k = first; k < last; ++k) {
+        output[k - first].assign(points.begin() + pathStarts[k], points.begin() + pathStarts[k + 1]);
+    }
+}
+
+double CompactPaths::bytes() {
+    return (double)points.capacity() * sizeof(clp::IntPoint) + (double)(pathStarts.capacity() + groupStarts.capacity()) * sizeof(size_t);
+}
 
 //if this is too heavy (I doubt it), it can be merged into loops where it makes sense
 void ToolpathManager::removeUsedSlicesPastZ(double z, std::vector<OutputSliceData> &output) {
@@ -22,6 +70,35 @@ void ToolpathManager::removeUsedSlicesPastZ(double z, std::vector<OutputSliceDat
     }
 }
 
+static std::shared_ptr<ResultSingleTool> makeCompactCopy(ResultSingleTool &result) {
+    auto compact = std::make_shared<ResultSingleTool>(result.z, result.ntool, result.idx);
+    compact->used                                  = result.used;
+    compact->phase1complete                        = result.phase1complete;
+    compact->phase2complete                        = result.phase2complete;
+    compact->contours_withexternal_medialaxis_used = result.contours_withexternal_medialaxis_used;
+    compact->compacted                             = true;
+    compact->compactContours.assign(result.contours_withexternal_medialaxis_used ? result.contours_withexternal_medialaxis : result.contours);
+    //same choice as in updateInputWithProfilesFromPreviousSlices()
+    if (!result.contours.empty()) {
+        if (result.infillingsIndependentContours.empty()) {
+            compact->compactProfiles.assign(result.contours);
+        } else {
+            compact->compactProfiles.assign(result.infillingsIndependentContours);
+        }
+        compact->compactMedialAxis.assign(result.medialAxisIndependentContours);
+    }
+    return compact;
+}
+
+void ToolpathManager::compactSlice(ResultSingleTool &result, std::vector<OutputSliceData> &output) {
+    auto &slices = slicess[result.ntool];
+    //slices are usually given away shortly after being computed, so search from the end
+    auto slice = std::find_if(slices.rbegin(), slices.rend(), [&result](std::shared_ptr<ResultSingleTool> &s) { return s.get() == &result; });
+    if (slice == slices.rend()) return;
+    *slice = makeCompactCopy(result);
+    output[result.idx].result = slice->get();
+}
+
 void ToolpathManager::removeAdditionalContoursPastZ(double z) {
     bool sliceUpwards = spec->global.sliceUpwards;
     for (auto additional = additionalAdditiveContours.begin(); additional != additionalAdditiveContours.end();) {
@@ -40,6 +117,13 @@ void ToolpathManager::applyContours(std::vector<clp::Paths> &contourss, int k, b
     }
 }
 
+void ToolpathManager::applyContours(CompactPaths &contours, int k, bool processIsAdditive, bool computeContoursAlreadyFilled, double diffwidth) {
+    for (size_t g = 0; g < contours.numGroups(); ++g) {
+        contours.getGroup(g, auxCompact);
+        if (!auxCompact.empty()) applyContours(auxCompact, k, processIsAdditive, computeContoursAlreadyFilled, diffwidth);
+    }
+}
+
 //this function is the body of the inner loop in updateInputWithProfilesFromPreviousSlices(), parametrized in the contour
 void ToolpathManager::applyContours(clp::Paths &contours, int ntool_contour, bool processToComputeIsAdditive, bool computeContoursAlreadyFilled, double diffwidth) {
 
@@ -115,10 +199,17 @@ void ToolpathManager::updateInputWithProfilesFromPreviousSlices(clp::Paths &init
 
         res->offset.ArcTolerance = (double)spec->pp[ntool_contour].arctolG;
         for (auto slice = slicess[ntool_contour].begin(); slice != slicess[ntool_contour].end(); ++slice) {
-            if (!(*slice)->contours.empty()) { 
+            bool compacted = (*slice)->compacted;
+            if (compacted ? !((*slice)->compactProfiles.empty() && (*slice)->compactMedialAxis.empty()) : !(*slice)->contours.empty()) {
                 double currentWidth = spec->pp[ntool_contour].profile->getWidth(z - (*slice)->z);
                 if (currentWidth > 0) {
                     double diffwidth = spec->pp[ntool_contour].radius - currentWidth;
+                    if (compacted) {
+                        //the choice between contours and infillings was already done while compacting the slice
+                        applyContours((*slice)->compactProfiles,   ntool_contour, processToComputeIsAdditive, computeContoursAlreadyFilled, diffwidth);
+                        applyContours((*slice)->compactMedialAxis, ntool_contour, processToComputeIsAdditive, computeContoursAlreadyFilled, diffwidth);
+                        continue;
+                    }
                     if ((*slice)->infillingsIndependentContours.empty()) {
                         //if infilling contours were not generated, we make do with the contours, which are actually cheaper to handle!
                         auto &contours = (*slice)->contours;
@@ -173,17 +264,16 @@ void ToolpathManager::updateInputWithProfilesFromPreviousSlices(clp::Paths &init
                     double moffset = spec->pp[ntool].ensureAttachmentMinimalOffset;
                     //this is to remove long and narrow artifacts
                     res->offsetDo(auxEnsure,     -moffset/100, initialContour, clp::jtRound, clp::etClosedPolygon);
-                    res->offsetDo(initialContour, moffset/100, auxEnsure,      clp::jtRound, clp::etClosedPolygon);
-                    //remove small artifacts from the contour (but uses only dissapearance under negative offset)
                     HoledPolygons hps, result;
-                    AddPathsToHPs(res->clipper, initialContour, hps);
+                    res->offsetDoToHPs(hps,       moffset/100, auxEnsure,      clp::jtRound, clp::etClosedPolygon);
+                    //remove small artifacts from the contour (but uses only dissapearance under negative offset)
                     auto &offseter = res->offset;
                     erase_remove_idiom(hps, [&result, &offseter, moffset](HoledPolygon &hp){
                         hp.offset(offseter, -moffset, result);
                         return result.empty();
                     });
                     initialContour.clear();
-                    AddHPsToPaths(hps, initialContour);
+                    MoveHPsToPaths(hps, initialContour);
                 }
                 
                 if (!initialContour.empty()) {
@@ -233,7 +323,7 @@ void ToolpathManager::removeFromContourSegmentsWithoutSupport(clp::Paths &contou
             });
         if (hps.size()!=initialSize)  {
             contour.clear();
-            AddHPsToPaths(hps, contour);
+            MoveHPsToPaths(hps, contour);
         }
     }
 }
@@ -301,7 +391,12 @@ bool ToolpathManager::computeContoursAboveAndBelow(ResultSingleTool &output, std
             if (output.contoursAboveAlreadyComputed) continue;
             clipper = &res->clipper2;
         }
-        clipper->AddPaths(required->contours_withexternal_medialaxis_used ? required->contours_withexternal_medialaxis : required->contours, clp::ptSubject, true);
+        if (required->compacted) {
+            required->compactContours.getAll(auxCompact);
+            clipper->AddPaths(auxCompact, clp::ptSubject, true);
+        } else {
+            clipper->AddPaths(required->contours_withexternal_medialaxis_used ? required->contours_withexternal_medialaxis : required->contours, clp::ptSubject, true);
+        }
     }
     if (hasBelow && !output.contoursBelowAlreadyComputed) {
         output.contoursBelowAlreadyComputed = true;
@@ -407,6 +502,7 @@ void RawSlicesManager::removeUsedRawSlices() {
             }
             if (raw[k].numRemainingUses == 0) {
                 raw[k].slice = clp::Paths(); //completely free memory (clear won't cut it!)
+                raw[k].offsets = std::vector<std::pair<double, clp::Paths>>();
                 raw[k].inUse = false;
             }
         }
@@ -419,6 +515,14 @@ void SimpleSlicingScheduler::createSlicingSchedule(double minz, double maxz, dou
     zmin = minz;
     zmax = maxz;
     switch (mode) {
+    case ScheduleAdaptive:
+        if (probeSlices.empty() || (probeSlices.size() != probeZs.size())) {
+            err = "the adaptive scheduler requires the probe slices to be set before creating the schedule";
+            has_err = true;
+            return;
+        }
+        //the schedule is created as in ScheduleSimple, and then thinned out
+        // fall through
     case ScheduleSimple:
         if (tm.spec->global.schedMode==ManualScheduling) {
             input.reserve(tm.spec->global.schedSpec.size());
@@ -444,17 +548,279 @@ void SimpleSlicingScheduler::createSlicingSchedule(double minz, double maxz, dou
                 for (int i = 0; i < tm.spec->numspecs; ++i) zbase[i] = base - tm.spec->pp[i].profile->remainder;
             }
             recursiveSimpleInputScheduler(0, zbase, sliceUpwards ? maxz : minz);
+            if (mode == ScheduleAdaptive) {
+                coarsenInputSlicesInStableRegions();
+                probeZs     = std::vector<double>();
+                probeSlices = std::vector<clp::Paths>();
+            }
         }
         if (!input.empty()) {
             computeSimpleOutputOrderForInputSlices();
             pruneInputZsAndCreateRawZs(epsilon);
         }
+        resetPhase2Tracking();
         break;
     default:
         throw std::runtime_error("option not implemented!!!!");
     }
 }
 
+//pairs (tool, previous tool) for the tools whose slices may be thinned out by ScheduleAdaptive
+static std::vector<std::pair<int, int>> adaptiveThinnedTools(MultiSpec &spec) {
+    std::vector<std::pair<int, int>> pairs;
+    if (spec.global.schedTools.empty()) {
+        for (int k = 1; k < spec.numspecs; ++k) pairs.push_back(std::make_pair(k, k - 1));
+    } else {
+        auto &tools = spec.global.schedTools;
+        for (int k = 1; k < tools.size(); ++k) pairs.push_back(std::make_pair(tools[k], tools[k - 1]));
+    }
+    return pairs;
+}
+
+std::vector<double> SimpleSlicingScheduler::computeAdaptiveProbeZs(double minz, double maxz) {
+    //the probes are not allowed to be sparser than the slices of the thinned tools, so a change in the material added by
+    //any of them cannot happen between two probes without being noticed
+    int first     = tm.spec->global.schedTools.empty() ? 0 : tm.spec->global.schedTools[0];
+    double finest = tm.spec->pp[first].profile->sliceHeight;
+    for (auto &pair : adaptiveThinnedTools(*tm.spec)) finest = std::min(finest, tm.spec->pp[pair.first].profile->sliceHeight);
+    double step = tm.spec->global.adaptiveStep;
+    if ((step <= 0) || (step > finest)) step = finest;
+    std::vector<double> zs;
+    zs.reserve((int)((maxz - minz) / step) + 2);
+    //probes are taken in the middle of each step, so they do not hit the horizontal faces at the extremes of the mesh
+    for (double z = minz + step / 2; z < maxz; z += step) zs.push_back(z);
+    if (zs.empty()) zs.push_back((minz + maxz) / 2);
+    return zs;
+}
+
+static double totalArea(clp::Paths &paths) {
+    double area = 0;
+    for (auto &path : paths) area += clp::Area(path);
+    return std::abs(area);
+}
+
+//morphological opening with the radius of the tool
+static void openPaths(ClippingResources &res, PerProcessSpec &ppspec, clp::Paths &input, clp::Paths &output) {
+    res.offset.ArcTolerance = (double)ppspec.arctolR;
+    res.offsetDo(output, -(double)ppspec.radius, input,  clp::jtRound, clp::etClosedPolygon);
+    res.offsetDo(output,  (double)ppspec.radius, output, clp::jtRound, clp::etClosedPolygon);
+}
+
+/*residue that a tool leaves in a slice for the next tool (the one with the next higher resolution) to fill: the part
+of the slice that does not survive a morphological opening with its radius*/
+static void residueOfPreviousTool(ClippingResources &res, PerProcessSpec &previous, clp::Paths &slice, clp::Paths &residue) {
+    clp::Paths opened;
+    openPaths(res, previous, slice, opened);
+    res.clipperDo(residue, clp::ctDifference, slice, opened, clp::pftNonZero, clp::pftNonZero);
+}
+
+/*the intervals between consecutive probes are classified as stable separately for each tool (except the first one), if the
+material that the tool may add does not change from one probe to the next. That material is the residue left by the
+previous tool, plus the region swept by the contour between the probes (where the taller voxels of the previous tool
+leave a staircase that the tool has to fill). The change (the symmetric difference of the residues, plus the swept
+region) is measured after an opening with the radius of the tool (as slivers thinner than the tool cannot be filled by
+it), and compared with the area of the material the tool adds in the interval, not with the area of the whole slice, so
+a small feature changing on top of a large, unchanging body is not missed. As the probes are at least as dense as the
+slices of the thinned tools, and a slice is only removed if all the intervals between it and the last kept slice are
+stable, no Z where the material added by the tool changes is left without a slice. In stable intervals, the slices of
+each tool are thinned out to the slice height of the previous tool, so vertical walls are not sliced at full resolution.
+Removing slices does not alter the relative order of the remaining ones, so the ordering of the schedule is still valid*/
+void SimpleSlicingScheduler::coarsenInputSlicesInStableRegions() {
+    int numprobes = (int)probeZs.size();
+    //Z step to use in stable intervals for each tool (0 if the tool is not to be thinned out)
+    std::vector<double> coarseStep(tm.spec->numspecs, 0.0);
+    std::vector<std::vector<char>> stable(tm.spec->numspecs);
+    std::vector<clp::Paths> residues(numprobes);
+    clp::Paths swept, changed, material, aux;
+    for (auto &pair : adaptiveThinnedTools(*tm.spec)) {
+        int ntool = pair.first;
+        auto &current  = tm.spec->pp[ntool];
+        auto &previous = tm.spec->pp[pair.second];
+        coarseStep[ntool] = previous.profile->sliceHeight;
+        stable[ntool].assign(std::max(0, numprobes - 1), false);
+        for (int k = 0; k < numprobes; ++k) residueOfPreviousTool(*tm.res, previous, probeSlices[k], residues[k]);
+        for (int k = 0; k < numprobes - 1; ++k) {
+            tm.res->clipperDo(swept,    clp::ctXor,   probeSlices[k], probeSlices[k + 1], clp::pftNonZero, clp::pftNonZero);
+            tm.res->clipperDo(changed,  clp::ctXor,   residues[k],    residues[k + 1],    clp::pftNonZero, clp::pftNonZero);
+            tm.res->clipperDo(aux,      clp::ctUnion, changed,        swept,              clp::pftNonZero, clp::pftNonZero);
+            openPaths(*tm.res, current, aux, changed);
+            tm.res->clipperDo(aux,      clp::ctUnion, residues[k],    residues[k + 1],    clp::pftNonZero, clp::pftNonZero);
+            tm.res->clipperDo(material, clp::ctUnion, aux,            swept,              clp::pftNonZero, clp::pftNonZero);
+            stable[ntool][k] = totalArea(changed) <= tm.spec->global.adaptiveThreshold * totalArea(material);
+        }
+    }
+    for (auto &residue : residues) residue = clp::Paths();
+    //Zs outside the probed range are never considered to be stable
+    auto isStable = [this, numprobes, &stable](int ntool, double z1, double z2) {
+        int k1 = (int)(std::upper_bound(probeZs.begin(), probeZs.end(), std::min(z1, z2)) - probeZs.begin()) - 1;
+        int k2 = (int)(std::upper_bound(probeZs.begin(), probeZs.end(), std::max(z1, z2)) - probeZs.begin()) - 1;
+        if ((k1 < 0) || (k2 >= numprobes - 1)) return false;
+        for (int k = k1; k <= k2; ++k) if (!stable[ntool][k]) return false;
+        return true;
+    };
+
+    //the slices of each tool are generated in monotonic Z order, so the last kept slice of each tool is the nearest one
+    std::vector<double> lastKept(tm.spec->numspecs);
+    std::vector<char> anyKept(tm.spec->numspecs, false);
+    auto keep = [&](InputSliceData &slice) {
+        int ntool = slice.ntool;
+        if (anyKept[ntool] && (coarseStep[ntool] > 0) && isStable(ntool, slice.z, lastKept[ntool]) &&
+            (std::abs(slice.z - lastKept[ntool]) < coarseStep[ntool] - tm.spec->global.z_epsilon)) {
+            return false;
+        }
+        anyKept[ntool]  = true;
+        lastKept[ntool] = slice.z;
+        return true;
+    };
+    size_t numkept = 0;
+    for (size_t k = 0; k < input.size(); ++k) {
+        if (keep(input[k])) {
+            if (numkept != k) input[numkept] = std::move(input[k]);
+            ++numkept;
+        }
+    }
+    input.erase(input.begin() + numkept, input.end());
+}
+
+void SimpleSlicingScheduler::selectCostSamples(int numPerTool, CostSamples &samples) {
+    std::vector<std::vector<int>> byTool(tm.spec->numspecs);
+    for (int k = 0; k < input.size(); ++k) byTool[input[k].ntool].push_back(k);
+    std::vector<char> selected(input.size(), false), timed(input.size(), false);
+    for (auto &indexes : byTool) {
+        int num = std::min(numPerTool, (int)indexes.size());
+        for (int j = 0; j < num; ++j) {
+            int k = indexes[(int)((j + 0.5) * indexes.size() / num)];
+            selected[k] = timed[k] = true;
+        }
+    }
+    //the slices of lower-resolution tools whose voxels overlap a sample are computed before it, as in the full schedule
+    for (int k = 0; k < input.size(); ++k) {
+        if (!timed[k]) continue;
+        auto &profile = *tm.spec->pp[input[k].ntool].profile;
+        for (int m = 0; m < k; ++m) {
+            if (input[m].ntool >= input[k].ntool) continue;
+            auto &other = *tm.spec->pp[input[m].ntool].profile;
+            if (((input[m].z - other.applicationPoint)   < (input[k].z + profile.remainder)) &&
+                ((input[k].z - profile.applicationPoint) < (input[m].z + other.remainder))) {
+                selected[m] = true;
+            }
+        }
+    }
+    samples.inputs.clear();
+    samples.timed.clear();
+    std::vector<char> rawSelected(rm.raw.size(), false);
+    for (int k = 0; k < input.size(); ++k) {
+        if (!selected[k]) continue;
+        samples.inputs.push_back(k);
+        samples.timed.push_back(timed[k]);
+        rawSelected[input[k].mapInputToRaw] = true;
+    }
+    samples.raws.clear();
+    for (int r = 0; r < rawSelected.size(); ++r) if (rawSelected[r]) samples.raws.push_back(r);
+}
+
+static double pathsBytes(clp::Paths &paths) {
+    double bytes = (double)paths.capacity() * sizeof(clp::Path);
+    for (auto &path : paths) bytes += (double)path.capacity() * sizeof(clp::IntPoint);
+    return bytes;
+}
+
+static double resultBytes(ResultSingleTool &r) {
+    double bytes = sizeof(ResultSingleTool);
+    for (auto paths : { &r.contours, &r.contoursToShow, &r.ptoolpaths, &r.stoolpaths, &r.itoolpaths, &r.infillingAreas, &r.medialAxis_toolpaths,
+                        &r.contours_withexternal_medialaxis, &r.unprocessedToolPaths, &r.contoursAbove, &r.contoursBelow, &r.contours_alreadyfilled }) {
+        bytes += pathsBytes(*paths);
+    }
+    for (auto &paths : r.medialAxisIndependentContours) bytes += pathsBytes(paths);
+    for (auto &paths : r.infillingsIndependentContours) bytes += pathsBytes(paths);
+    bytes += r.compactContours.bytes() + r.compactProfiles.bytes() + r.compactMedialAxis.bytes();
+    return bytes;
+}
+
+/*the samples are computed with the real pipeline (phase 1 and phase 2), but without the contours of nearby slices of the
+same tool, so the cost of support/surface computations is not fully accounted for. The peak memory is extrapolated by
+replaying the schedule with the same retention window as removeUnrequiredData()*/
+bool SimpleSlicingScheduler::estimateCost(CostSamples &samples, std::vector<clp::Paths> &rawSlices, CostEstimate &estimate) {
+    int numtools = tm.spec->numspecs;
+    estimate.numSlices      .assign(numtools, 0);
+    estimate.numSamples     .assign(numtools, 0);
+    estimate.secondsPerSlice.assign(numtools, 0.0);
+    estimate.bytesPerSlice  .assign(numtools, 0.0);
+    estimate.peakRetained   .assign(numtools, 0);
+    estimate.totalSeconds = estimate.peakBytes = 0.0;
+    if (rawSlices.size() != samples.raws.size()) {
+        err = str("estimateCost() requires ", samples.raws.size(), " raw slices, but it got ", rawSlices.size());
+        has_err = true;
+        return false;
+    }
+    std::vector<int> rawPosition(rm.raw.size(), -1);
+    for (int r = 0; r < samples.raws.size(); ++r) {
+        rawPosition[samples.raws[r]] = r;
+        if (tm.spec->global.substractiveOuter) {
+            addOuter(rawSlices[r], tm.spec->global.limitX, tm.spec->global.limitY);
+        }
+        if (tm.spec->global.correct || tm.spec->global.substractiveOuter) {
+            orientPaths(rawSlices[r]);
+        }
+    }
+
+    std::vector<ResultSingleTool*> none;
+    clp::Paths raw;
+    for (int s = 0; s < samples.inputs.size(); ++s) {
+        auto &in = input[samples.inputs[s]];
+        raw = rawSlices[rawPosition[in.mapInputToRaw]];
+        auto start = std::chrono::steady_clock::now();
+        ResultSingleTool *result;
+        has_err = !tm.processSlicePhase1(none, raw, in.z, in.ntool, in.mapInputToOutput, result);
+        if (!has_err) has_err = !tm.processSlicePhase2(*result);
+        if (has_err) {
+            err = tm.err;
+            return false;
+        }
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        if (samples.timed[s]) {
+            ++estimate.numSamples[in.ntool];
+            estimate.secondsPerSlice[in.ntool] += elapsed.count();
+            //once given away, slices are retained in compacted form
+            estimate.bytesPerSlice[in.ntool]   += resultBytes(*makeCompactCopy(*result));
+        }
+    }
+    for (auto &slices : tm.slicess) slices.clear();
+
+    for (auto &in : input) ++estimate.numSlices[in.ntool];
+    for (int t = 0; t < numtools; ++t) {
+        if (estimate.numSamples[t] > 0) {
+            estimate.secondsPerSlice[t] /= estimate.numSamples[t];
+            estimate.bytesPerSlice[t]   /= estimate.numSamples[t];
+        }
+        estimate.totalSeconds += estimate.secondsPerSlice[t] * estimate.numSlices[t];
+    }
+
+    //replay the schedule: results are discarded when they are more than 4.1 slices of tool 0 behind the current input slice
+    bool removes      = removeUnused && (tm.spec->global.schedMode != ManualScheduling);
+    bool sliceUpwards = tm.spec->global.sliceUpwards;
+    double window     = tm.spec->pp[0].profile->sliceHeight * 4.1;
+    std::vector<std::deque<double>> retained(numtools);
+    std::vector<int> counts(numtools);
+    for (auto &in : input) {
+        retained[in.ntool].push_back(in.z);
+        double zlimit = in.z - (sliceUpwards ? window : -window);
+        double bytes  = 0;
+        for (int t = 0; t < numtools; ++t) {
+            auto &zs = retained[t];
+            //the slices of each tool are scheduled in monotonic Z order, so the oldest ones are at the front
+            while (removes && !zs.empty() && (sliceUpwards ? (zs.front() < zlimit) : (zs.front() > zlimit))) zs.pop_front();
+            counts[t] = (int)zs.size();
+            bytes    += counts[t] * estimate.bytesPerSlice[t];
+        }
+        if (bytes > estimate.peakBytes) {
+            estimate.peakBytes    = bytes;
+            estimate.peakRetained = counts;
+        }
+    }
+    return true;
+}
+
 bool testSliceNotNearEnd(double z, double zend, int process, ToolpathManager &tm) {
     double zspan = (tm.spec->global.sliceUpwards) ?
         (zend - z - tm.spec->pp[process].profile->remainder) :
@@ -830,6 +1196,25 @@ bool RawSlicesManager::rawReady(int input_idx) {
     }
 }
 
+//helper method for getRawContour(): the offsets are memoized while the raw slice has remaining uses
+clp::Paths *RawSlicesManager::getOffsetRawContour(int raw_idx, double diffwidth) {
+    auto &offsets = raw[raw_idx].offsets;
+    for (auto &offset : offsets) {
+        if (offset.first == diffwidth) return &offset.second;
+    }
+    clp::Paths *output;
+    if (raw[raw_idx].numRemainingUses > 0) {
+        offsets.emplace_back(diffwidth, clp::Paths());
+        output = &offsets.back().second;
+    } else {
+        auxTree.emplace_back();
+        output = &auxTree.back();
+    }
+    //we use jtSquare here because it is way faster than jtRound and we do not strictly need the extra shape precision provided by jtRound
+    sched->tm.res->offsetDo(*output, diffwidth, raw[raw_idx].slice, clp::jtSquare, clp::etClosedPolygon);
+    return output;
+}
+
 clp::Paths *RawSlicesManager::getRawContour(int idx_raw, int input_idx) {
     //here, we trust that rawReady() has returned TRUE PREVIOUSLY, Otherwise... CLUSTERFUCK!!!!
     if (sched->tm.spec->global.avoidVerticalOverwriting) {
@@ -855,14 +1240,14 @@ clp::Paths *RawSlicesManager::getRawContour(int idx_raw, int input_idx) {
             //ADVANCED METHOD: OFFSET CONTOURS TO TAKE INTO ACCOUNT THE PROFILE OF THE VOXEL
             double inputz = sched->input[input_idx].z;
             int ntool = sched->input[input_idx].ntool;
-            bool firstTime = true;
-            clp::Paths *next = NULL;
+            std::vector<clp::Paths*> operands;
+            operands.reserve(raw_idxs.size());
             for (auto raw_idx = raw_idxs.begin(); raw_idx != raw_idxs.end(); ++raw_idx) {
                 --raw[*raw_idx].numRemainingUses;
                 double rawz = raw[*raw_idx].z;
                 if (inputz == rawz) {
                     //in this codepath, this assignment should be always executed exactly once
-                    next = &raw[*raw_idx].slice;
+                    operands.push_back(&raw[*raw_idx].slice);
                 } else {
                     double width_at_raw = sched->tm.spec->pp[ntool].profile->getWidth(rawz - inputz);
                     //this edge case happens from time to time due to misconfigurations, just let's handle it gracefully instead of erroring out
@@ -878,22 +1263,33 @@ clp::Paths *RawSlicesManager::getRawContour(int idx_raw, int input_idx) {
                         sched->err     = str("error for input slice with input_idx=", input_idx, " at z=", inputz, ", a raw slice with raw_idx=", *raw_idx, " at z=", rawz, " was required, but the diffwidth is below 0: ", diffwidth);
                         return NULL;
                     }
-                    //we use jtSquare here because it is way faster than jtRound and we do not strictly need the extra shape precision provided by jtRound
-                    sched->tm.res->offsetDo(auxaux, diffwidth, raw[*raw_idx].slice, clp::jtSquare, clp::etClosedPolygon);
-                    next = &auxaux;
+                    operands.push_back(getOffsetRawContour(*raw_idx, diffwidth));
                 }
-                if (firstTime) {
-                    if (next == &auxaux) {
-                        auxRawSlice = std::move(*next);
-                    } else {
-                        auxRawSlice = *next;
-                    }
-                    firstTime = false;
-                } else {
-                    sched->tm.res->clipperDo(auxRawSlice, clp::ctIntersection, auxRawSlice, *next, clp::pftNonZero, clp::pftNonZero);
+            }
+
+            //intersect the contours pairwise, in a balanced tree, so the intermediate results are as small as possible
+            while (operands.size() > 1) {
+                size_t numpairs = operands.size() / 2;
+                for (size_t k = 0; k < numpairs; ++k) {
+                    auxTree.emplace_back();
+                    sched->tm.res->clipperDo(auxTree.back(), clp::ctIntersection, *operands[2 * k], *operands[2 * k + 1], clp::pftNonZero, clp::pftNonZero);
+                    operands[k] = &auxTree.back();
                 }
+                if ((operands.size() % 2) != 0) operands[numpairs++] = operands.back();
+                operands.resize(numpairs);
+            }
+            if (operands.empty()) {
+                auxRawSlice.clear();
+            } else if (!auxTree.empty() && (operands[0] == &auxTree.back())) {
+                auxRawSlice = std::move(*operands[0]);
+            } else {
+                auxRawSlice = *operands[0];
+            }
+            auxTree.clear();
+            //the memoized offsets of the raw slices which will not be used again are useless
+            for (auto raw_idx = raw_idxs.begin(); raw_idx != raw_idxs.end(); ++raw_idx) {
+                if (raw[*raw_idx].numRemainingUses <= 0) raw[*raw_idx].offsets = std::vector<std::pair<double, clp::Paths>>();
             }
-            auxaux.clear();
 
             return &auxRawSlice;
         }
@@ -903,14 +1299,20 @@ clp::Paths *RawSlicesManager::getRawContour(int idx_raw, int input_idx) {
     }
 }
 
-//reconstruct cross-references from OutputSliceData to ResultSingleTool
+//reconstruct cross-references from OutputSliceData to ResultSingleTool, and the bookkeeping for phase 2
 void SimpleSlicingScheduler::post_deserialize_reconstruct() {
+    resetPhase2Tracking();
     if (output.empty()) return;
     for (auto &slices : tm.slicess) {
         for (auto &slice : slices) {
             output[slice->idx].result = slice.get();
         }
     }
+    for (auto &slices : tm.slicess) {
+        for (auto &slice : slices) {
+            if (slice->phase1complete && !slice->phase2complete) registerForPhase2(slice->idx);
+        }
+    }
 }
 
 //helper method for processReadyRawSlices()
@@ -979,6 +1381,7 @@ bool SimpleSlicingScheduler::processReadyRawSlices() {
                 break;
             }
             if (this_output.recomputeRequiredAfterSupport) clearContoursAboveBelow(*this_output.result);
+            notifyPhase1Complete(this_output_idx);
             if (this_output.requiredContoursForOverhang.empty() && this_output.requiredContoursForSurface.empty()) {
                 has_err = !tm.processSlicePhase2(*this_output.result);
                 if (has_err) {
@@ -987,6 +1390,8 @@ bool SimpleSlicingScheduler::processReadyRawSlices() {
                     break;
                 }
                 this_output.computed = true;
+            } else {
+                registerForPhase2(this_output_idx);
             }
             removeUnrequiredData(input[input_idx].z);
             ++input_idx;
@@ -1045,15 +1450,42 @@ bool SimpleSlicingScheduler::tryToComputeSlicePhase2(ResultSingleTool &result) {
     return ok;
 }
 
-//method to do all pending phase 2 slicing computations
-bool SimpleSlicingScheduler::processReadySlicesPhase2() {
-    for (auto &slices : tm.slicess) {
-        for (auto &slice : slices) {
-            if (slice->phase1complete && !slice->phase2complete) {
-                if (!tryToComputeSlicePhase2(*slice)) return false;
+void SimpleSlicingScheduler::resetPhase2Tracking() {
+    numMissingForPhase2.assign(output.size(), 0);
+    waitingForPhase1.clear();
+    waitingForPhase1.resize(output.size());
+    readyForPhase2.clear();
+}
+
+//a slice which has completed phase 1 waits for its required contours to complete phase 1, before doing phase 2
+void SimpleSlicingScheduler::registerForPhase2(int idx) {
+    int missing = 0;
+    for (auto requireds : { &output[idx].requiredContoursForOverhang, &output[idx].requiredContoursForSurface }) {
+        for (auto required : *requireds) {
+            if ((output[required].result == NULL) || !output[required].result->phase1complete) {
+                waitingForPhase1[required].push_back(idx);
+                ++missing;
             }
         }
     }
+    numMissingForPhase2[idx] = missing;
+    if (missing == 0) readyForPhase2.emplace(output[idx].ntool, output[idx].mapOutputToInput);
+}
+
+void SimpleSlicingScheduler::notifyPhase1Complete(int idx) {
+    for (auto waiting : waitingForPhase1[idx]) {
+        if (--numMissingForPhase2[waiting] == 0) readyForPhase2.emplace(output[waiting].ntool, output[waiting].mapOutputToInput);
+    }
+    waitingForPhase1[idx] = std::vector<int>();
+}
+
+//method to do all pending phase 2 slicing computations: only the slices whose requirements are complete are considered
+bool SimpleSlicingScheduler::processReadySlicesPhase2() {
+    while (!readyForPhase2.empty()) {
+        int idx = input[readyForPhase2.begin()->second].mapInputToOutput;
+        readyForPhase2.erase(readyForPhase2.begin());
+        if (!tryToComputeSlicePhase2(*output[idx].result)) return false;
+    }
     return true;
 }
 
@@ -1065,16 +1497,30 @@ void SimpleSlicingScheduler::computeNextInputSlices() {
     return;
 }
 
+int SimpleSlicingScheduler::numRawSlicesRequiredForNextInput() {
+    if (input_idx >= input.size()) return (int)rm.raw.size();
+    InputSliceData &next = input[input_idx];
+    int maxraw = next.mapInputToRaw;
+    if (tm.spec->global.avoidVerticalOverwriting) {
+        for (auto raw_idx = next.requiredRawSlices.begin(); raw_idx != next.requiredRawSlices.end(); ++raw_idx) {
+            maxraw = std::max(maxraw, *raw_idx);
+        }
+    }
+    return maxraw + 1;
+}
+
 //this method will return slices in the intended ordering, if available
 std::shared_ptr<ResultSingleTool> SimpleSlicingScheduler::giveNextOutputSlice() {
     if (!output[output_idx].computed) return std::shared_ptr<ResultSingleTool>();
-    int ntool = output[output_idx].ntool;
-    for (int k = 0; k < tm.slicess[ntool].size(); ++k) {
-        if ((tm.slicess[ntool][k]->idx == output_idx) && (!tm.slicess[ntool][k]->used)) {
-            tm.slicess[ntool][k]->used = true;
-            output_idx++;
-            return tm.slicess[ntool][k];
-        }
+    //the slice is owned by tm.slicess[ntool], and output[output_idx].result points to it
+    ResultSingleTool *result = output[output_idx].result;
+    if ((result != NULL) && (result->idx == output_idx) && (!result->used)) {
+        result->used = true;
+        output_idx++;
+        std::shared_ptr<ResultSingleTool> given = result->shared_from_this();
+        //from now on, the scheduler only keeps what is needed to compute other slices
+        tm.compactSlice(*result, output);
+        return given;
     }
     has_err = true;
     err = "Could not find the expected output slice!!!";
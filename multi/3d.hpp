@@ -4,10 +4,34 @@
 #include "multislicer.hpp"
 #include "spec.hpp"
 #include "serialization.hpp"
+#include <set>
+#include <deque>
 
 struct OutputSliceData;
 
-typedef struct ResultSingleTool: public SingleProcessOutput {
+/*compact storage for paths which are kept for many slices: all the points share a single buffer, and paths (and groups
+of paths, to store a std::vector<clp::Paths>) are delimited by offsets into it, so they take three allocations instead of
+one per path, and the points are serialized with a single fwrite. They have to be expanded to clp::Paths to use them with Clipper*/
+typedef struct CompactPaths {
+            std::vector<clp::IntPoint> points;
+            std::vector<size_t> pathStarts;  //path k is [pathStarts[k], pathStarts[k+1]) in points
+            std::vector<size_t> groupStarts; //group g is made of paths [groupStarts[g], groupStarts[g+1])
+            SERIALIZATION_DEFINITION(points, pathStarts, groupStarts)
+    void assign(clp::Paths &paths);
+    void assign(std::vector<clp::Paths> &pathss);
+    void reset(size_t numpoints, size_t numpaths, size_t numgroups);
+    void appendGroup(clp::Paths &paths);
+    bool empty() { return points.empty(); }
+    size_t numGroups() { return groupStarts.empty() ? 0 : groupStarts.size() - 1; }
+    //these replace the contents of output with the paths of one group or all groups, reusing its memory
+    void getGroup(size_t g, clp::Paths &output) { getPaths(groupStarts[g], groupStarts[g + 1], output); }
+    void getAll(clp::Paths &output)             { getPaths(0, pathStarts.empty() ? 0 : pathStarts.size() - 1, output); }
+    void getPaths(size_t first, size_t last, clp::Paths &output);
+    double bytes();
+} CompactPaths;
+
+//enable_shared_from_this: the scheduler keeps raw pointers to the slices (OutputSliceData::result), but has to give them away as shared_ptr
+typedef struct ResultSingleTool: public SingleProcessOutput, public std::enable_shared_from_this<ResultSingleTool> {
             clp::Paths contoursAbove, contoursBelow, contours_alreadyfilled;
             double z;
             int ntool;
@@ -15,11 +39,18 @@ typedef struct ResultSingleTool: public SingleProcessOutput {
             bool contoursAboveAlreadyComputed, contoursBelowAlreadyComputed;
             bool has_err;
             bool used;
+            /*once a slice has been given away, the scheduler keeps a compacted copy with only the contours required
+            to compute other slices (see ToolpathManager::compactSlice()), and the other fields are empty*/
+            bool compacted;
+            CompactPaths compactContours;   //contours used for contoursAbove/contoursBelow of other slices
+            CompactPaths compactProfiles;   //infillingsIndependentContours, or contours if there are no infillings (empty if there were no contours)
+            CompactPaths compactMedialAxis; //medialAxisIndependentContours (empty if there were no contours)
             SERIALIZATION_DEFINITION(contours, contoursToShow, ptoolpaths, stoolpaths, itoolpaths, infillingAreas, medialAxis_toolpaths, contours_withexternal_medialaxis, unprocessedToolPaths, medialAxisIndependentContours, infillingsIndependentContours, contoursAbove, contoursBelow, contours_alreadyfilled,
-                                     z, ntool, idx, alsoInfillingAreas, phase1complete, phase2complete, contours_withexternal_medialaxis_used, contoursAboveAlreadyComputed, contoursBelowAlreadyComputed, used)
-    ResultSingleTool(std::string _err, double _z = NAN) : SingleProcessOutput(_err), z(_z), has_err(true) {};
-    ResultSingleTool(double _z, int _ntool, int _idx) : SingleProcessOutput(), z(_z), ntool(_ntool), idx(_idx), has_err(false), contoursAboveAlreadyComputed(false), contoursBelowAlreadyComputed(false), used(false) {}
-    ResultSingleTool() : SingleProcessOutput(), has_err(false), idx(-1), ntool(-1), z(NAN), contoursAboveAlreadyComputed(false), contoursBelowAlreadyComputed(false), used(true) {}
+                                     z, ntool, idx, alsoInfillingAreas, phase1complete, phase2complete, contours_withexternal_medialaxis_used, contoursAboveAlreadyComputed, contoursBelowAlreadyComputed, used,
+                                     compacted, compactContours, compactProfiles, compactMedialAxis)
+    ResultSingleTool(std::string _err, double _z = NAN) : SingleProcessOutput(_err), z(_z), has_err(true), compacted(false) {};
+    ResultSingleTool(double _z, int _ntool, int _idx) : SingleProcessOutput(), z(_z), ntool(_ntool), idx(_idx), has_err(false), contoursAboveAlreadyComputed(false), contoursBelowAlreadyComputed(false), used(false), compacted(false) {}
+    ResultSingleTool() : SingleProcessOutput(), has_err(false), idx(-1), ntool(-1), z(NAN), contoursAboveAlreadyComputed(false), contoursBelowAlreadyComputed(false), used(true), compacted(false) {}
 } ResultSingleTool;
 
 class SimpleSlicingScheduler;
@@ -29,10 +60,11 @@ and adjusting accordingly the contours to be built. The functionality here is se
 of the scheduler. However, as the scheduler is already quite complex on its own, all (or
 hopefully most) of the logic to manage previous toolpaths is contained here*/
 class ToolpathManager {
-    clp::Paths auxUpdate, auxInitial, auxEnsure;
+    clp::Paths auxUpdate, auxInitial, auxEnsure, auxCompact;
     //this function is the body of the inner loop in updateInputWithProfilesFromPreviousSlices(), parametrized in the contour
     void applyContours(clp::Paths &contours, int k, bool processIsAdditive, bool computeContoursAlreadyFilled, double diffwidth);
     void applyContours(std::vector<clp::Paths> &contourss, int k, bool processIsAdditive, bool computeContoursAlreadyFilled, double diffwidth);
+    void applyContours(CompactPaths &contours, int k, bool processIsAdditive, bool computeContoursAlreadyFilled, double diffwidth);
     void removeFromContourSegmentsWithoutSupport(clp::Paths &contour, ResultSingleTool &output, std::vector<ResultSingleTool*> &requiredContours);
     bool computeContoursAboveAndBelow(ResultSingleTool &output, std::vector<ResultSingleTool*> &requiredContours, bool onlyIfBothAboveAndBelow);
     void serialize_custom(FILE *f);
@@ -59,6 +91,8 @@ public:
                             std::vector<ResultSingleTool*> requiredContoursSurface  = std::vector<ResultSingleTool*>(),
                             bool recomputeRequiredAfterOverhang = false);
     void removeUsedSlicesPastZ(double z, std::vector<OutputSliceData> &output);
+    //replaces a slice which is being given away by a compacted copy with just the data required by later slices
+    void compactSlice(ResultSingleTool &result, std::vector<OutputSliceData> &output);
     void removeAdditionalContoursPastZ(double z);
     void purgeAdditionalAdditiveContours() { additionalAdditiveContours.clear(); }
 };
@@ -99,6 +133,8 @@ typedef struct RawSliceData {
             bool wasUsed;         //flag to catch error conditions
             clp::Paths slice;
             std::vector<int> mapRawToInput; //one to many mapping
+            //offsets of the slice already computed for avoidVerticalOverwriting, as (diffwidth, offset) pairs. This is a cache, so it is not serialized
+            std::vector<std::pair<double, clp::Paths>> offsets;
             SERIALIZATION_DEFINITION(slice, mapRawToInput, z, numRemainingUses, inUse, wasUsed)
 } RawSliceData;
 
@@ -108,22 +144,44 @@ the scheduler (it even requires a reference to the scheduler!), but most of it i
 contained here, because the scheduler is already quite complex on its own*/
 class RawSlicesManager {
     SimpleSlicingScheduler *sched;
+    std::deque<clp::Paths> auxTree; //intermediate results (a deque, so pointers to them remain valid)
+    clp::Paths *getOffsetRawContour(int raw_idx, double diffwidth);
 public:
-    clp::Paths auxRawSlice, auxaux;
+    clp::Paths auxRawSlice;
             int raw_idx;
             std::vector<RawSliceData> raw;
             std::vector<double> rawZs; //this is required in computeSlicesZs()
             SERIALIZATION_DEFINITION(raw, rawZs, raw_idx)
     RawSlicesManager(SimpleSlicingScheduler &s) : sched(&s) {}
     void removeUsedRawSlices();
-    void clear() { raw.clear();  rawZs.clear();  auxRawSlice.clear();  auxaux.clear();  raw_idx = 0; }
+    void clear() { raw.clear();  rawZs.clear();  auxRawSlice.clear();  auxTree.clear();  raw_idx = 0; }
     bool singleRawSliceReady(int raw_idx, int input_idx);
     bool rawReady(int input_idx);
     clp::Paths *getRawContour(int raw_idx, int input_idx);
     void receiveNextRawSlice(clp::Paths &input); //this method has to trust that the input slice will be according to the list of Z input values
 };
 
-enum SchedulingMode { ScheduleSimple };
+//input slices to be computed to estimate the cost of a schedule
+typedef struct CostSamples {
+    std::vector<int> inputs; //indexes of the input slices, in computing order
+    std::vector<char> timed; //for each input slice: true if it is a sample, false if it is computed only because some sample of a higher-resolution tool depends on it
+    std::vector<int> raws;   //indexes of the required raw slices, in the same order as rm.rawZs
+} CostSamples;
+
+//cost of a schedule, extrapolated from the samples (the vectors have one element for each tool)
+typedef struct CostEstimate {
+    std::vector<int> numSlices;          //number of input slices in the schedule
+    std::vector<int> numSamples;         //number of timed samples
+    std::vector<double> secondsPerSlice; //mean wall time of the samples, phase 1 and phase 2
+    std::vector<double> bytesPerSlice;   //mean memory of the results of the samples
+    std::vector<int> peakRetained;       //number of results held in the ToolpathManager when the memory peak happens
+    double totalSeconds;
+    double peakBytes;
+} CostEstimate;
+
+/*ScheduleAdaptive is like ScheduleSimple, but the slices of the higher-resolution tools are placed with the
+slice height of the previous tool where the probe slices show that the material added by the tool does not change in Z*/
+enum SchedulingMode { ScheduleSimple, ScheduleAdaptive };
 
 /*This scheduler controls the main workflow. It is quite complex,
 because of the need to keep track of a heck of a lot of things:
@@ -158,14 +216,25 @@ class SimpleSlicingScheduler {
     void recursiveSimpleInputScheduler(int process, std::vector<double> &z, double ztop);
     void computeSimpleOutputOrderForInputSlices();
     void pruneInputZsAndCreateRawZs(double epsilon);
+    void coarsenInputSlicesInStableRegions();
     bool getContourToAvoidVerticalOverwriting(clp::Paths &output);
     void removeUnrequiredData(double z);
     bool processReadyRawSlices();
     bool tryToComputeSlicePhase2(ResultSingleTool &result);
     bool processReadySlicesPhase2();
+    void resetPhase2Tracking();
+    void registerForPhase2(int idx);
+    void notifyPhase1Complete(int idx);
     void post_deserialize_reconstruct();
     std::vector<ResultSingleTool*> getRequiredContours(std::vector<int> &requireds);
     void anotateRequiredContoursAsUsed(std::vector<ResultSingleTool*> &recalleds);
+    /*bookkeeping for slices waiting for phase 2 (they are not serialized, but reconstructed from the slices):
+    for each output slice, the number of its required contours which have not completed phase 1 yet, and the
+    slices waiting for it to complete phase 1. The slices ready for phase 2 are kept in the order in which they
+    completed phase 1 within each tool, as (ntool, input idx) pairs*/
+    std::vector<int> numMissingForPhase2;
+    std::vector<std::vector<int>> waitingForPhase1;
+    std::set<std::pair<int, int>> readyForPhase2;
 public:
     std::string err;
     bool has_err;
@@ -179,18 +248,30 @@ public:
             size_t output_idx;
             std::vector<OutputSliceData> output;
             std::vector<int> num_output_by_tool;
+            //probe slices for ScheduleAdaptive: the mesh has to be sliced at the Zs returned by computeAdaptiveProbeZs() before calling createSlicingSchedule()
+            std::vector<double> probeZs;
+            std::vector<clp::Paths> probeSlices;
             SERIALIZATION_CUSTOM_DEFINITION(
                 { serialize(f, input); },
                 { deserialize(f, input, InputSliceData(0, 0)); },
                 { post_deserialize_reconstruct(); }, 
                 output, num_output_by_tool, zmin, zmax, input_idx, output_idx, tm, rm);
-    void clear() { input.clear(); output.clear(); err = std::string(); has_err = false; input_idx = output_idx = 0; zmin = zmax = 0.0; rm.clear(); }
+    void clear() { input.clear(); output.clear(); err = std::string(); has_err = false; input_idx = output_idx = 0; zmin = zmax = 0.0; rm.clear(); resetPhase2Tracking(); }
 
     SimpleSlicingScheduler(bool _removeUnused, std::shared_ptr<ClippingResources> _res) : removeUnused(_removeUnused), has_err(false), tm(std::move(_res)), rm(*this) {}
     void createSlicingSchedule(double minz, double maxz, double epsilon, SchedulingMode mode);
+    std::vector<double> computeAdaptiveProbeZs(double minz, double maxz);
+    /*cost estimation: selectCostSamples() chooses up to numPerTool input slices of each tool, evenly spread along
+    the schedule. The caller has to get the raw slices listed in samples.raws, and pass them (in the same order) to
+    estimateCost(), which computes the samples and extrapolates the time and memory required by the full schedule.
+    The state of the scheduler must be reset (createSlicingSchedule) before using it to compute the schedule*/
+    void selectCostSamples(int numPerTool, CostSamples &samples);
+    bool estimateCost(CostSamples &samples, std::vector<clp::Paths> &rawSlices, CostEstimate &estimate);
 
     void computeNextInputSlices();
     std::shared_ptr<ResultSingleTool> giveNextOutputSlice(); //this method will return slices in the correct order
+    //number of raw slices (counting from the first one) which have to be received before the next input slice can be computed
+    int numRawSlicesRequiredForNextInput();
 };
 
 std::string applyFeedbackFromFile(Configuration &config, MetricFactors &factors, SimpleSlicingScheduler &sched, std::vector<double> &zs, std::vector<double> &scaled_zs);
@@ -111,34 +111,84 @@ void addPathsToSegments(clp::Paths &paths, Segments &segments, PathMode mode) {
     }
 }
 
-void applyTransform(Transformation &t, clp::Path &path) {
+//the fields of t are copied to locals: otherwise, the compiler has to assume that writing to the points may modify them, and does not vectorize the loops
+void applyTransform(Transformation &t, clp::IntPoint *points, size_t numpoints) {
+    const clp::cInt dx = t.dx, dy = t.dy;
+    clp::IntPoint *end = points + numpoints;
     if (t.usescale) { //scale only if necessary
-        for (clp::Path::iterator point = path.begin(); point != path.end(); ++point) {
-            point->X = (clp::cInt)((point->X + t.dx) * t.scale);
-            point->Y = (clp::cInt)((point->Y + t.dy) * t.scale);
+        const double scale = t.scale;
+        for (clp::IntPoint *point = points; point != end; ++point) {
+            point->X = (clp::cInt)((point->X + dx) * scale);
+            point->Y = (clp::cInt)((point->Y + dy) * scale);
         }
     } else {
-        for (clp::Path::iterator point = path.begin(); point != path.end(); ++point) {
-            point->X += t.dx;
-            point->Y += t.dy;
+        for (clp::IntPoint *point = points; point != end; ++point) {
+            point->X += dx;
+            point->Y += dy;
         }
     }
 }
 
-void reverseTransform(Transformation &t, clp::Path &path) {
+void reverseTransform(Transformation &t, clp::IntPoint *points, size_t numpoints) {
+    const clp::cInt dx = t.dx, dy = t.dy;
+    clp::IntPoint *end = points + numpoints;
     if (t.usescale) { //scale only if necessary
-        for (clp::Path::iterator point = path.begin(); point != path.end(); ++point) {
-            point->X = (clp::cInt)((double)point->X * t.invscale) - t.dx;
-            point->Y = (clp::cInt)((double)point->Y * t.invscale) - t.dy;
+        const double invscale = t.invscale;
+        for (clp::IntPoint *point = points; point != end; ++point) {
+            point->X = (clp::cInt)((double)point->X * invscale) - dx;
+            point->Y = (clp::cInt)((double)point->Y * invscale) - dy;
         }
     } else {
-        for (clp::Path::iterator point = path.begin(); point != path.end(); ++point) {
-            point->X -= t.dx;
-            point->Y -= t.dy;
+        for (clp::IntPoint *point = points; point != end; ++point) {
+            point->X -= dx;
+            point->Y -= dy;
         }
     }
 }
 
+void scalePointsToDouble(const clp::IntPoint *input, double scaling, clp::DoublePoint *output, size_t numpoints) {
+    for (size_t k = 0; k < numpoints; ++k) {
+        output[k].X = input[k].X * scaling;
+        output[k].Y = input[k].Y * scaling;
+    }
+}
+
+void applyTransform2DCompatibleXY(clp::DoublePoint *points, size_t numpoints, TransformationMatrix matrix) {
+    const double m0 = matrix[0], m1 = matrix[1], m3 = matrix[3];
+    const double m4 = matrix[4], m5 = matrix[5], m7 = matrix[7];
+    for (size_t k = 0; k < numpoints; ++k) {
+        double x = points[k].X, y = points[k].Y;
+        points[k].X = (m0 * x) + (m1 * y) + m3;
+        points[k].Y = (m4 * x) + (m5 * y) + m7;
+    }
+}
+
+void applyTransformFull3D(const clp::DoublePoint *input, double iz, Point3D *output, size_t numpoints, TransformationMatrix matrix) {
+    /*the Z coordinate is the same for all points, so its products are computed just once. The additions are done
+    in the same order as in the single-point applyTransformFull3D(), so the results are bit-identical*/
+    const double m0 = matrix[0], m1 = matrix[1], z0 = matrix[2]  * iz, m3  = matrix[3];
+    const double m4 = matrix[4], m5 = matrix[5], z1 = matrix[6]  * iz, m7  = matrix[7];
+    const double m8 = matrix[8], m9 = matrix[9], z2 = matrix[10] * iz, m11 = matrix[11];
+    for (size_t k = 0; k < numpoints; ++k) {
+        double x = input[k].X, y = input[k].Y;
+        output[k].x = (m0 * x) + (m1 * y) + z0 + m3;
+        output[k].y = (m4 * x) + (m5 * y) + z1 + m7;
+        output[k].z = (m8 * x) + (m9 * y) + z2 + m11;
+    }
+}
+
+void applyTransformFull3D(Point3D *points, size_t numpoints, TransformationMatrix matrix) {
+    const double m0 = matrix[0], m1 = matrix[1], m2  = matrix[2],  m3  = matrix[3];
+    const double m4 = matrix[4], m5 = matrix[5], m6  = matrix[6],  m7  = matrix[7];
+    const double m8 = matrix[8], m9 = matrix[9], m10 = matrix[10], m11 = matrix[11];
+    for (size_t k = 0; k < numpoints; ++k) {
+        double x = points[k].x, y = points[k].y, z = points[k].z;
+        points[k].x = (m0 * x) + (m1 * y) + (m2  * z) + m3;
+        points[k].y = (m4 * x) + (m5 * y) + (m6  * z) + m7;
+        points[k].z = (m8 * x) + (m9 * y) + (m10 * z) + m11;
+    }
+}
+
 
 ////////////////////////////////////////////////////////////
 //BBox
@@ -240,33 +290,34 @@ void HoledPolygon::offset2(clp::ClipperOffset &offset, double radius1, double ra
     offset.Clear();
 }
 
-void recursiveAddPolyTreeToHPs(clp::PolyNode& polynode, HoledPolygons &hps) {
-    auto child = polynode.Childs.begin();
-    auto childend = polynode.Childs.end();
-    { //recursive function, try to keep the function state size down to the bare minimum
-        HoledPolygon newhp;
-        newhp.contour = std::move(polynode.Contour); //move semantics
-        newhp.holes.resize(polynode.ChildCount());
-        auto holesend = newhp.holes.end();
-        //use move semantics both for adding the holes and the whole HoledPolygon
-        for (clp::Paths::iterator hole = newhp.holes.begin(); hole != holesend; ++hole) {
-            *hole = std::move((*child++)->Contour); //move semantics
+void AddPolyTreeToHPs(clp::PolyTree &pt, HoledPolygons &hps) {
+    /*first, collect the outer contours in the same order as a recursive traversal
+    (each outer contour, then the outer contours inside its holes), so hps is allocated just once*/
+    std::vector<clp::PolyNode*> outers, pending;
+    for (auto child = pt.Childs.rbegin(); child != pt.Childs.rend(); ++child) pending.push_back(*child);
+    while (!pending.empty()) {
+        clp::PolyNode *outer = pending.back();
+        pending.pop_back();
+        outers.push_back(outer);
+        for (auto hole = outer->Childs.rbegin(); hole != outer->Childs.rend(); ++hole) {
+            for (auto subchild = (*hole)->Childs.rbegin(); subchild != (*hole)->Childs.rend(); ++subchild) {
+                pending.push_back(*subchild);
+            }
         }
-        hps.push_back(std::move(newhp)); //move semantics
     }
-    for (child = polynode.Childs.begin(); child != childend; ++child) {
-        auto subchildend = (*child)->Childs.end();
-        for (auto subchild = (*child)->Childs.begin(); subchild != subchildend; ++subchild) {
-            recursiveAddPolyTreeToHPs(**subchild, hps);
+    //use move semantics for the contours and the holes
+    hps.reserve(hps.size() + outers.size());
+    for (auto outer : outers) {
+        hps.push_back(HoledPolygon());
+        HoledPolygon &newhp = hps.back();
+        newhp.contour = std::move(outer->Contour);
+        newhp.holes.reserve(outer->Childs.size());
+        for (auto hole : outer->Childs) {
+            newhp.holes.push_back(std::move(hole->Contour));
         }
     }
 }
 
-void AddPolyTreeToHPs(clp::PolyTree &pt, HoledPolygons &hps) {
-    for (int i = 0; i < pt.ChildCount(); ++i)
-        recursiveAddPolyTreeToHPs(*pt.Childs[i], hps);
-}
-
 void AddPathsToHPs(clp::Clipper &clipper, clp::Paths &paths, HoledPolygons &hps) {
     clipper.AddPaths(paths, clp::ptSubject, true);
     clp::PolyTree *pt;
@@ -287,6 +338,17 @@ void AddHPsToPaths(HoledPolygons &hps, clp::Paths &paths) {
     }
 }
 
+void MoveHPsToPaths(HoledPolygons &hps, clp::Paths &paths) {
+    size_t numpaths = 0;
+    for (HoledPolygons::iterator hp = hps.begin(); hp != hps.end(); ++hp) {
+        numpaths += 1 + hp->holes.size();
+    }
+    paths.reserve(paths.size() + numpaths);
+    for (HoledPolygons::iterator hp = hps.begin(); hp != hps.end(); ++hp) {
+        hp->moveToPaths(paths);
+    }
+}
+
 //same as the other function, but make the paths closed
 void AddHPsToClosedPaths(HoledPolygons &hps, clp::Paths &paths) {
     size_t numpaths = 0;
@@ -135,10 +135,14 @@ template<typename T> void HoledPolygon::offset(clp::ClipperOffset &offset, doubl
 
 
 void AddPathsToHPs(clp::Clipper &clipper, clp::Paths &pt, HoledPolygons &hps);
+//the contours are moved out of the PolyTree, so it cannot be used after calling this function.
+//If the output of a clipping or offsetting operation is going to be converted to HoledPolygons, it is cheaper to get it as a PolyTree and use this function directly, instead of AddPathsToHPs()
 void AddPolyTreeToHPs(clp::PolyTree &pt, HoledPolygons &hps);
 
 void AddHPsToPaths(HoledPolygons &hps, clp::Paths &paths);
 void AddHPsToClosedPaths(HoledPolygons &hps, clp::Paths &paths);
+//same as AddHPsToPaths(), but the HoledPolygons are moved (they are left empty)
+void MoveHPsToPaths(HoledPolygons &hps, clp::Paths &paths);
 
 
 typedef struct Transformation {
@@ -151,8 +155,11 @@ typedef struct Transformation {
     inline bool notTrivial() { return (dx != 0) || (dy != 0) || (scale != 1.0); }
 } Transformation;
 
-void applyTransform(Transformation &t, clp::Path &path);
-void reverseTransform(Transformation &t, clp::Path &path);
+//bulk versions for contiguous buffers of points
+void applyTransform(Transformation &t, clp::IntPoint *points, size_t numpoints);
+void reverseTransform(Transformation &t, clp::IntPoint *points, size_t numpoints);
+inline void applyTransform(Transformation &t, clp::Path &path) { applyTransform(t, path.data(), path.size()); }
+inline void reverseTransform(Transformation &t, clp::Path &path) { reverseTransform(t, path.data(), path.size()); }
 typedef void(*DoTransform)(Transformation &, clp::Path &);
 template<DoTransform fun> void transformAllPaths(Transformation &t, HoledPolygon &hp) {
     fun(t, hp.contour);
@@ -218,6 +225,13 @@ inline void applyTransformFull3D(Point3D &p, TransformationMatrix matrix) {
     p.z = z;
 }
 
+/*bulk versions of the above for contiguous buffers of points. The coefficients are copied
+to locals and the loops have no aliasing between input and output, so they are vectorized by the compiler*/
+void scalePointsToDouble(const clp::IntPoint *input, double scaling, clp::DoublePoint *output, size_t numpoints);
+void applyTransform2DCompatibleXY(clp::DoublePoint *points, size_t numpoints, TransformationMatrix matrix);
+void applyTransformFull3D(const clp::DoublePoint *input, double iz, Point3D *output, size_t numpoints, TransformationMatrix matrix);
+void applyTransformFull3D(Point3D *points, size_t numpoints, TransformationMatrix matrix);
+
 
 typedef struct BBox {
     clp::cInt minx;
@@ -93,6 +93,21 @@ template<typename Output, typename Input> void ClippingResources::offsetDo2(Outp
 auxiliar variables are passed around in order to avoid recurring std::vector growing costs*/
 /////////////////////////////////////////////////
 
+void ClippingResources::warmUp() {
+    clp::Path square(4);
+    square[0].X = 0;    square[0].Y = 0;
+    square[1].X = 1000; square[1].Y = 0;
+    square[2].X = 1000; square[2].Y = 1000;
+    square[3].X = 0;    square[3].Y = 1000;
+    clp::Paths input(1, square), offseted, result;
+    offsetDo(offseted, 100, input, clp::jtRound, clp::etClosedPolygon);
+    clipperDo(result, clp::ctDifference, offseted, input, clp::pftNonZero, clp::pftNonZero);
+    clipper2.AddPaths(offseted, clp::ptSubject, true);
+    clipper2.AddPaths(input,    clp::ptClip,    true);
+    clipper2.Execute(clp::ctIntersection, result, clp::pftNonZero, clp::pftNonZero);
+    clipper2.Clear();
+}
+
 void ClippingResources::removeHighResDetails(size_t k, clp::Paths &contours, clp::Paths &lowres, clp::Paths &opened, clp::Paths &aux1) {
     auto &ppspec     = spec->pp[k];
 
@@ -252,7 +267,6 @@ void ClippingResources::doDiscardCommonToolPaths(size_t k, clp::Paths &toolpaths
     //we will not overwrite aux2 because its contents will be needed later in the loop!
 
     //now, offset all previous contours, and accumulate them
-    clp::Paths previousContours;
     clipper.AddPaths(toolpaths, clp::ptSubject, false);
     double globalRadius = (double)ppspec.radius + (double)ppspec.radiusRemoveCommon;
     offset.ArcTolerance = (double)ppspec.arctolG;
@@ -289,8 +303,12 @@ bool ClippingResources::generateToolPath(size_t k, bool nextProcessSameKind, clp
             ppspec.snapspec.mode = SnapDilate;
         }
         //aux1 <- snapToGrid(toolpath, gridstep, doErosion)
-        bool ok = snapClipperPathsToGrid(*spec->global.config, aux1, temp_toolpath, ppspec.snapspec, *err);
+        SnapToGridRecovery recovery(&offset, (double)ppspec.gridstep);
+        bool ok = snapClipperPathsToGrid(*spec->global.config, aux1, temp_toolpath, ppspec.snapspec, *err, spec->global.snapStrict ? NULL : &recovery, spec->global.snapThreads);
         if (!ok) return false;
+        if ((recovery.numFailed() > 0) && (warn != NULL)) {
+            *warn += str("while snapping toolpaths to the grid for process ", k, ", ", recovery.countersToString(), "\n");
+        }
         std::swap(aux1, temp_toolpath);
     } else {
         if (ppspec.addInternalClearance) {
@@ -563,9 +581,8 @@ bool Infiller::processInfillingsConcentricRecursive(HoledPolygon &hp) {
         res->offsetDo(smoothed, erodedInfillingRadius, next, clp::jtRound, clp::etOpenRound);
         MOVETO(smoothed, *infillingsIndependentContours);
     }
-    res->offsetDo(current, -erodedInfillingRadius, next, clp::jtRound, clp::etClosedPolygon);
     HoledPolygons subhps;
-    AddPathsToHPs(res->clipper, current, subhps);
+    res->offsetDoToHPs(subhps, -erodedInfillingRadius, next, clp::jtRound, clp::etClosedPolygon);
     smoothed = current = next = clp::Paths();
     for (auto subhp = subhps.begin(); subhp != subhps.end(); ++subhp) {
         --numconcentric;
@@ -602,6 +619,8 @@ bool Multislicer::applyProcessPhase1(SingleProcessOutput &output, clp::Paths &co
     auto &global = spec->global;
     auto &ppspec = spec->pp[k];
     res->err = &output.err;
+    res->warn = &output.warn;
+    output.warn.clear();
     this->clear();
 
     //INTERIM HACK FOR add/sub
@@ -697,6 +716,7 @@ bool Multislicer::applyProcessPhase2(SingleProcessOutput &output, clp::Paths *in
     auto &global = spec->global;
     auto &ppspec = spec->pp[k];
     res->err = &output.err;
+    res->warn = &output.warn;
     this->clear();
 
     //INTERIM HACK FOR add/sub
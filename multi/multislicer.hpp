@@ -10,6 +10,7 @@ void removeOuter(clp::Paths &paths, clp::cInt limitX, clp::cInt limitY);
 
 typedef struct SingleProcessOutput {
     std::string err;
+    std::string warn; //non-fatal problems found while computing this output, to be reported by the caller
     clp::Paths contours;
     clp::Paths contoursToShow;
     clp::Paths ptoolpaths, stoolpaths, itoolpaths;
@@ -50,14 +51,15 @@ public:
     clp::Clipper clipper;
     clp::Clipper clipper2; //we need this in order to conduct more than one clipping in parallel, if necessary
     std::string *err; //this is a temp. pointer which is set up by applyXXX() methods in MultiSlicer
+    std::string *warn; //same as err, but for non-fatal problems
     std::shared_ptr<MultiSpec> spec;
     template<typename MS = MultiSpec> ClippingResources(typename std::enable_if< CLIPPER_MMANAGER::isArena, std::shared_ptr<MS> >::type _spec) : 
         manager_offset  ("OFFSET",   MemoryManagerPrintDebugMessages, BIGCHUNK_ARENA_SIZE, INITIAL_ARENA_SIZE),
         manager_clipper ("CLIPPER",  MemoryManagerPrintDebugMessages, BIGCHUNK_ARENA_SIZE, INITIAL_ARENA_SIZE),
         manager_clipper2("CLIPPER2", MemoryManagerPrintDebugMessages, BIGCHUNK_ARENA_SIZE, INITIAL_ARENA_SIZE),
-        offset(manager_offset), clipper(manager_clipper), clipper2(manager_clipper2), spec(std::move(_spec)), err(NULL) {}
+        offset(manager_offset), clipper(manager_clipper), clipper2(manager_clipper2), spec(std::move(_spec)), err(NULL), warn(NULL) {}
     template<typename MS = MultiSpec> ClippingResources(typename std::enable_if<!CLIPPER_MMANAGER::isArena, std::shared_ptr<MS> >::type _spec) :
-        offset(manager_offset), clipper(manager_clipper), clipper2(manager_clipper2), spec(std::move(_spec)), err(NULL) {}
+        offset(manager_offset), clipper(manager_clipper), clipper2(manager_clipper2), spec(std::move(_spec)), err(NULL), warn(NULL) {}
 
     //// STATELESS, LOW LEVEL HELPER TEMPLATES ////
     template<typename T, typename INFLATEDACCUM> void operateInflatedLinesAndContoursInClipper(clp::ClipType mode, T &res, clp::Paths &lines,                       double radius, clp::Paths *aux, INFLATEDACCUM* inflated_acumulator);
@@ -66,6 +68,8 @@ public:
     template<typename Output, typename Input1, typename Input2> void clipperDo( Output &output, clp::ClipType operation, Input1 &subject, Input2 &clip, clp::PolyFillType subjectFillType, clp::PolyFillType clipFillType);
     template<typename Output, typename Input>                   void offsetDo(  Output &output, double delta,                 Input &input,                  clp::JoinType jointype, clp::EndType endtype);
     template<typename Output, typename Input>                   void offsetDo2( Output &output, double delta1, double delta2, Input &input, clp::Paths &aux, clp::JoinType jointype, clp::EndType endtype);
+    //the output of the offset is converted to HoledPolygons directly from the PolyTree, without the union done by AddPathsToHPs()
+    template<typename Input>                                    void offsetDoToHPs(HoledPolygons &output, double delta,       Input &input,                  clp::JoinType jointype, clp::EndType endtype);
     //// STATELESS, LOW LEVEL HELPER FUNCTIONS ////
     bool AddPaths(clp::Path  &path, clp::PolyType pt, bool closed);
     bool AddPaths(clp::Paths &paths,               clp::PolyType pt, bool closed);
@@ -79,6 +83,8 @@ public:
     void doDiscardCommonToolPaths(size_t k, clp::Paths &toolpaths, clp::Paths &contours_alreadyfilled, clp::Paths &aux1);
     bool generateToolPath(size_t k, bool nextProcessSameKind, clp::Paths &contour, clp::Paths &toolpaths, clp::Paths &temp_toolpath, clp::Paths &aux1);
     bool applyMedialAxisNotAggregated(size_t k, std::vector<double> &medialAxisFactors, std::vector<clp::Paths> &accumContours, clp::Paths &shapes, clp::Paths &medialaxis_accumulator);
+    //run a small offset and clipping through offset, clipper and clipper2, so their memory managers set up their initial chunks right now
+    void warmUp();
 };
 
 //here, we include only the templates and functions that are used elsewhere
@@ -93,6 +99,12 @@ template<typename Output, typename Input> void ClippingResources::offsetDo(Outpu
     offset.Execute(output, delta);
     if (!std::is_same<Output, clp::PolyTree*>::value) offset.Clear();
 }
+template<typename Input> void ClippingResources::offsetDoToHPs(HoledPolygons &output, double delta, Input &input, clp::JoinType jointype, clp::EndType endtype) {
+    clp::PolyTree *pt;
+    offsetDo(pt, delta, input, jointype, endtype);
+    AddPolyTreeToHPs(*pt, output);
+    offset.Clear();
+}
 inline bool ClippingResources::AddPaths(clp::Path  &path,  clp::PolyType pt, bool closed) { return clipper.AddPath (path,  pt, closed); }
 inline bool ClippingResources::AddPaths(clp::Paths &paths, clp::PolyType pt, bool closed) { return clipper.AddPaths(paths, pt, closed); }
 inline int  ClippingResources::AddPaths(std::vector<clp::Paths> &pathss, clp::PolyType pt, bool closed) {
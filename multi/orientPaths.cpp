@@ -8,6 +8,7 @@
 #endif
 
 #include "orientPaths.hpp"
+#include "auxgeom.hpp"
 #include <algorithm>
 #include <cmath>
 
@@ -24,16 +25,72 @@ typedef std::vector<mypair> mypairs;
 typedef mypairs::iterator mypairs_i;
 typedef mypairs::reverse_iterator mypairs_ri;
 
-struct treenode;
-
-typedef std::vector<treenode> trees;
-typedef trees::iterator trees_i;
+static inline bool bbContains(const BBox &bb, const clp::IntPoint &p) {
+    return (p.X >= bb.minx) && (p.X <= bb.maxx) && (p.Y >= bb.miny) && (p.Y <= bb.maxy);
+}
 
-typedef struct treenode {
+//node of the nesting tree. Nodes are numbered in order of insertion, so children always have higher numbers than their parents
+typedef struct NestingNode {
+    int parent; //-1 for roots
     size_t index;
-    trees children;
-    treenode(size_t i) : index(i), children(trees()) {};
-} treenode;
+    NestingNode(int p, size_t i) : parent(p), index(i) {}
+} NestingNode;
+
+/*uniform grid over the bounding boxes of the nodes in the nesting tree, to find the nodes
+whose bounding box contains a point without testing all of them. Nodes with big bounding
+boxes are not registered in the grid cells, but in a separate list*/
+class NestingGrid {
+public:
+    NestingGrid(BBox &global, size_t numpaths);
+    void add(int node, const BBox &bb);
+    //returns (in increasing order) the nodes whose bounding box contains the point
+    void candidates(const clp::IntPoint &p, std::vector<BBox> &nodeBBoxes, std::vector<int> &result);
+protected:
+    int cellX(clp::cInt x) { return clampCell((int)(((double)x - (double)gmin.X) * scaleX)); }
+    int cellY(clp::cInt y) { return clampCell((int)(((double)y - (double)gmin.Y) * scaleY)); }
+    int clampCell(int c) { return c < 0 ? 0 : (c >= numcells ? numcells - 1 : c); }
+    static const int MAX_CELLS_PER_NODE = 16;
+    clp::IntPoint gmin;
+    double scaleX, scaleY;
+    int numcells; //per axis
+    std::vector<std::vector<int>> cells;
+    std::vector<int> big;
+    std::vector<int> aux;
+};
+
+NestingGrid::NestingGrid(BBox &global, size_t numpaths) {
+    numcells = std::max(1, std::min(1024, (int)std::sqrt((double)numpaths)));
+    gmin.X   = global.minx;
+    gmin.Y   = global.miny;
+    scaleX   = numcells / ((double)global.maxx - (double)global.minx + 1.0);
+    scaleY   = numcells / ((double)global.maxy - (double)global.miny + 1.0);
+    cells.resize((size_t)numcells * numcells);
+}
+
+void NestingGrid::add(int node, const BBox &bb) {
+    int x0 = cellX(bb.minx), x1 = cellX(bb.maxx);
+    int y0 = cellY(bb.miny), y1 = cellY(bb.maxy);
+    if ((x1 - x0 + 1)*(y1 - y0 + 1) > MAX_CELLS_PER_NODE) {
+        big.push_back(node);
+        return;
+    }
+    for (int y = y0; y <= y1; ++y) {
+        for (int x = x0; x <= x1; ++x) {
+            cells[(size_t)y*numcells + x].push_back(node);
+        }
+    }
+}
+
+void NestingGrid::candidates(const clp::IntPoint &p, std::vector<BBox> &nodeBBoxes, std::vector<int> &result) {
+    //both lists are already sorted, because nodes are added in increasing order
+    std::vector<int> &cell = cells[(size_t)cellY(p.Y)*numcells + cellX(p.X)];
+    aux.clear();
+    std::merge(cell.begin(), cell.end(), big.begin(), big.end(), std::back_inserter(aux));
+    result.clear();
+    for (int node : aux) {
+        if (bbContains(nodeBBoxes[node], p)) result.push_back(node);
+    }
+}
 
 inline bool mycomp( const mypair& l, const mypair& r) {
     return l.first < r.first;
@@ -56,21 +113,30 @@ void initAreas(clp::Paths &paths, areas_t &areas, mypairs &absareas, orients_t &
 
   /*This function computes the nesting tree of the ClipperPaths, in order to put
   them in the right orientation. Roots (paths not contained in any other path)
-  are contours, their children are holes, the grandchildren are contours, etc. */
-void recursiveAddOrientation(clp::Paths &paths, orients_t &orients, size_t k, trees &nesting, bool notHole) {
-    DO_DEBUG_ORIENT(printf("  INIT recursiveAddOrientation(k=%zu, size=%zu, notHole=%d)\n", k, nesting.size(), notHole); int ii=0);
-    DO_DEBUG_ORIENT(puts("  BEFORE FOR"));
-    for (trees_i it = nesting.begin(); it!=nesting.end(); ++it) {
-        DO_DEBUG_ORIENT(printf("    LOOP %d\n", ii));
-        if (clp::PointInPolygon(paths[k][0], paths[it->index])!=0) {
-            recursiveAddOrientation(paths, orients, k, it->children, !notHole);
-            return;
+  are contours, their children are holes, the grandchildren are contours, etc.
+  The path is placed by descending the tree: at each level, it goes into the first
+  node (in order of insertion) containing its first point. Only nodes whose bounding
+  box contains the point can contain it, so only these are tested, in order of insertion
+  (children are always inserted after their parents, so this can be done in a single pass)*/
+static void addOrientation(clp::Paths &paths, orients_t &orients, size_t k, std::vector<NestingNode> &nesting, NestingGrid &grid, std::vector<BBox> &nodeBBoxes, BBox &bb, std::vector<int> &candidates) {
+    DO_DEBUG_ORIENT(printf("  INIT addOrientation(k=%zu, size=%zu)\n", k, nesting.size()));
+    int parent = -1;
+    bool notHole = true;
+    if (!paths[k].empty()) {
+        grid.candidates(paths[k][0], nodeBBoxes, candidates);
+        for (int node : candidates) {
+            if ((nesting[node].parent == parent) && (clp::PointInPolygon(paths[k][0], paths[nesting[node].index]) != 0)) {
+                parent  = node;
+                notHole = !notHole;
+            }
         }
     }
-    DO_DEBUG_ORIENT(printf("  AFTER FOR, nesting.size()==%zu\n", nesting.size()));
     //add it to the root contours if the list is empty or no other root contained it
-    nesting.push_back(treenode(k));
-    DO_DEBUG_ORIENT(printf("  AFTER PUSH_BACK: size=%zu, last index==k=%d\n", nesting.size(), nesting[nesting.size()-1].index));
+    nesting.push_back(NestingNode(parent, k));
+    nodeBBoxes.push_back(bb);
+    //empty paths cannot contain anything, so they are not added to the grid
+    if (!paths[k].empty()) grid.add((int)nesting.size() - 1, bb);
+    DO_DEBUG_ORIENT(printf("  AFTER PUSH_BACK: size=%zu, parent=%d, notHole=%d\n", nesting.size(), parent, notHole));
     /*the path is reversed if it is a contour (non-hole) and the orientation 
     is false (clockwise) or it is not a contour and the orientation is true
     (counter-clockwise)*/
@@ -78,7 +144,6 @@ void recursiveAddOrientation(clp::Paths &paths, orients_t &orients, size_t k, tr
         //printf("  REVERSING!!!! k==%zu, notHole==%d, orients[k]==%s, paths.size()==%zu\n", k, notHole, orients[k] ? "true" : "false", paths.size());
         clp::ReversePath(paths[k]);
     }
-    DO_DEBUG_ORIENT(printf("  END recursiveAddOrientation(k=%zu, size=%zu, notHole=%d)\n", k, nesting.size(), notHole));
 }
 
 //implementation of public interface
@@ -99,16 +164,34 @@ void orientPaths(clp::Paths &paths) {
     areas_t areas(numpaths);
     mypairs absareas(numpaths);
     orients_t orients(numpaths);
-    trees nesting;
+    std::vector<NestingNode> nesting;
+    std::vector<BBox> bboxes(numpaths), nodeBBoxes;
+    std::vector<int> candidates;
+    nesting   .reserve(numpaths);
+    nodeBBoxes.reserve(numpaths);
     
     DO_DEBUG_ORIENT(puts("before initAreas()"));
     initAreas(paths, areas, absareas, orients);
     DO_DEBUG_ORIENT(printf("after initAreas(), paths.size()==%zu\n", paths.size()); int ii=0);
+
+    BBox global;
+    bool anyPoint = false;
+    for (size_t k = 0; k < numpaths; ++k) {
+        if (paths[k].empty()) continue;
+        bboxes[k] = getBB(paths[k]);
+        if (anyPoint) {
+            global.merge(bboxes[k]);
+        } else {
+            global   = bboxes[k];
+            anyPoint = true;
+        }
+    }
+    NestingGrid grid(global, numpaths);
     
     //iterate from bigger to smaller areas
     for (mypairs_ri it = absareas.rbegin(); it != absareas.rend(); ++it) {
         DO_DEBUG_ORIENT(printf("Before %d pair (%f, %d)\n", ii, it->first, it->second));
-        recursiveAddOrientation(paths, orients, it->second, nesting, true);
+        addOrientation(paths, orients, it->second, nesting, grid, nodeBBoxes, bboxes[it->second], candidates);
         DO_DEBUG_ORIENT(printf("after %d pair\n", ii++));
     }
     DO_DEBUG_ORIENT(printf("ENDING orientPaths(), paths.size()==%zu\n", paths.size()));
@@ -0,0 +1,57 @@
+#ifndef PARALLEL_HEADER
+#define PARALLEL_HEADER
+
+#include <thread>
+#include <atomic>
+#include <vector>
+#include <exception>
+
+/*minimal helpers to run independent work items in several threads.
+The number of threads is always normalized with getNumThreads(): values <=0
+mean "as many as hardware threads", and it is never more than the number of work items*/
+inline int getNumThreads(int requested, size_t numitems) {
+    int n = requested;
+    if (n <= 0) {
+        n = (int)std::thread::hardware_concurrency();
+        if (n <= 0) n = 1;
+    }
+    if ((size_t)n > numitems) n = (int)numitems;
+    if (n < 1) n = 1;
+    return n;
+}
+
+/*calls fun(idx, numthread) for every idx in [0, numitems), distributing the
+items dynamically across numthreads threads (numthread is in [0, numthreads)).
+If numthreads==1, everything is done in the calling thread. The first
+exception thrown by fun is rethrown in the calling thread after all threads
+have finished (remaining items are not processed)*/
+template<typename Function> void parallelFor(size_t numitems, int numthreads, Function fun) {
+    numthreads = getNumThreads(numthreads, numitems);
+    if (numthreads == 1) {
+        for (size_t idx = 0; idx < numitems; ++idx) fun(idx, 0);
+        return;
+    }
+    std::atomic<size_t> next(0);
+    std::atomic<bool> failed(false);
+    std::vector<std::exception_ptr> exceptions(numthreads);
+    auto worker = [&](int numthread) {
+        try {
+            while (!failed) {
+                size_t idx = next++;
+                if (idx >= numitems) break;
+                fun(idx, numthread);
+            }
+        } catch (...) {
+            exceptions[numthread] = std::current_exception();
+            failed = true;
+        }
+    };
+    std::vector<std::thread> threads;
+    threads.reserve(numthreads - 1);
+    for (int t = 1; t < numthreads; ++t) threads.emplace_back(worker, t);
+    worker(0);
+    for (auto &thread : threads) thread.join();
+    for (auto &e : exceptions) if (e) std::rethrow_exception(e);
+}
+
+#endif
@@ -1,6 +1,7 @@
 #include "pathsplitter.hpp"
 #include "motionPlanner.hpp"
 #include "showcontours.hpp"
+#include "parallel.hpp"
 #include <cmath>
 
 void clipPaths(clp::Clipper &clipper, clp::Path &clip, clp::Paths &subject, bool subjectClosed, clp::Paths &result) {
@@ -16,13 +17,9 @@ void clipPaths(clp::Clipper &clipper, clp::Path &clip, clp::Paths &subject, bool
     clipper.Clear();
 }
 
-void clipPaths(clp::Clipper &clipper, bool pathsClosed, clp::Paths &paths, Matrix<PathSplitter::EnclosedPaths> &buffer) {
-    for (int x = 0; x < buffer.numx; ++x) {
-        for (int y = 0; y < buffer.numy; ++y) {
-            auto &enclosed = buffer.at(x, y);
-            clipPaths(clipper, enclosed.actualSquare, paths, pathsClosed, enclosed.paths);
-        }
-    }
+bool overlaps(BBox &bb, clp::Path &square) {
+    //squares are axis-aligned: square[0] is the min corner, square[2] the max corner
+    return (bb.minx <= square[2].X) && (bb.maxx >= square[0].X) && (bb.miny <= square[2].Y) && (bb.maxy >= square[0].Y);
 }
 
 
@@ -180,6 +177,26 @@ void PathSplitter::applyMotionPlanning() {
     }
 }
 
+//helper method for processPaths(): squares which do not overlap the paths are skipped, the others are clipped in parallel
+void PathSplitter::clipToSquares(clp::Paths &paths, bool pathsClosed) {
+    if (paths.empty()) return;
+    BBox bb = getBB(paths);
+    std::vector<int> toClip;
+    toClip.reserve(buffer.data.size());
+    for (int idx = 0; idx < (int)buffer.data.size(); ++idx) {
+        if (overlaps(bb, buffer.data[idx].actualSquare)) toClip.push_back(idx);
+    }
+    int nthreads = getNumThreads(numthreads, toClip.size());
+    while ((int)threadres.size() < nthreads - 1) {
+        threadres.push_back(std::make_shared<ClippingResources>(res->spec));
+    }
+    parallelFor(toClip.size(), nthreads, [this, &paths, pathsClosed, &toClip](size_t k, int numthread) {
+        clp::Clipper &clipper = (numthread == 0) ? res->clipper : threadres[numthread - 1]->clipper;
+        auto &enclosed = buffer.data[toClip[k]];
+        clipPaths(clipper, enclosed.actualSquare, paths, pathsClosed, enclosed.paths);
+    });
+}
+
 //helper method for processPaths()
 bool PathSplitter::setupSquares(double z, double scaling) {
     clp::IntPoint shiftBecauseAngle;
@@ -234,7 +251,7 @@ bool PathSplitter::processPaths(clp::Paths &paths, bool pathsClosed, double z, d
 
     if (!setupSquares(z, scaling)) return false;
 
-    clipPaths(res->clipper, pathsClosed, paths, buffer);
+    clipToSquares(paths, pathsClosed);
 
     //clipping messes with path ordering, so reapply motionPlanning
     if (config.applyMotionPlanning) applyMotionPlanning();
@@ -47,14 +47,17 @@ public:
     std::shared_ptr<ClippingResources> res;
     int numx, numy; //matrix sizes
     bool angle90;
+    int numthreads; //number of threads to clip the paths to the squares (<=0: as many as hardware threads)
     PathSplitterConfig config;
-    PathSplitter(PathSplitterConfig _config, std::shared_ptr<ClippingResources> _res, Configuration *_cfg = NULL) : res(std::move(_res)), config(std::move(_config)), setup_done(false), cfg(_cfg) {}
+    PathSplitter(PathSplitterConfig _config, std::shared_ptr<ClippingResources> _res, Configuration *_cfg = NULL) : res(std::move(_res)), numthreads(1), config(std::move(_config)), setup_done(false), cfg(_cfg) {}
     bool setup();
     Matrix<TriangleMesh> generateGridCubes(double scaling, double zmin, double zmax);
     bool processPaths(clp::Paths &paths, bool pathsClosed, double z, double scaling);
 protected:
     void applyMotionPlanning();
     bool setupSquares(double z, double scaling);
+    void clipToSquares(clp::Paths &paths, bool pathsClosed);
+    std::vector<std::shared_ptr<ClippingResources>> threadres; //clipping resources for the additional threads
     Configuration *cfg;
     SnapToGridSpec snapspec;
     double sinangle;
@@ -1,6 +1,7 @@
 
 #include "snapToGrid.hpp"
 #include "showcontours.hpp"
+#include "parallel.hpp"
 #include <sstream>
 #include <cmath>
 //#include <stdio.h> 
@@ -475,21 +476,68 @@ void showError(Configuration &config, SnapToGridSpec &snapspec, size_t inputIdx,
     SHOWCONTOURS(config, str("Error while snapping point ", gridinfo.numPoint, " of path ", inputIdx, ", errcode: ", errcode, additional), &grid, &errpoint, &input);
 }
 
-bool snapClipperPathsToGrid(Configuration &config, clp::Paths &output, clp::Paths &inputs, SnapToGridSpec &snapspec, std::string &err) {
-    gridInfo gridinfo;
+void SnapToGridRecovery::clearCounters() {
+    for (int k = 0; k <= SNAP_MAX_ERRORCODE; ++k) numErrorsByCode[k] = 0;
+    numResnapped = numUnsnapped = 0;
+}
+
+std::string SnapToGridRecovery::countersToString() {
+    std::ostringstream fmt;
+    fmt << numFailed() << " paths could not be snapped to the grid (" << numResnapped << " snapped after an opening, " << numUnsnapped << " kept unsnapped). Error codes:";
+    for (int k = 2; k <= SNAP_MAX_ERRORCODE; ++k) {
+        if (numErrorsByCode[k] > 0) fmt << " " << k << " (x" << numErrorsByCode[k] << ")";
+    }
+    return fmt.str();
+}
+
+//snap the result of opening the path. Returns false if any of the resulting paths cannot be snapped
+static bool snapPathAfterOpening(clp::Path &input, SnapToGridSpec &snapspec, SnapToGridRecovery &recovery, clp::Paths &result) {
+    clp::Paths opened, aux(1, input);
+    //ClipperOffset considers a lone hole to be a contour, so holes are reversed before and after the opening
+    bool ishole = !clp::Orientation(input);
+    if (ishole) clp::ReversePath(aux[0]);
+    recovery.offset->AddPaths(aux, clp::jtRound, clp::etClosedPolygon);
+    recovery.offset->Execute(opened, -recovery.openingRadius);
+    recovery.offset->Clear();
+    recovery.offset->AddPaths(opened, clp::jtRound, clp::etClosedPolygon);
+    recovery.offset->Execute(aux, recovery.openingRadius);
+    recovery.offset->Clear();
+    if (ishole) clp::ReversePaths(aux);
+    result.clear();
+    result.reserve(aux.size());
+    for (auto &path : aux) {
+        clp::Path snapped;
+        int code = snapPathToGrid(snapped, path, snapspec, NULL);
+        if (code > 1) return false;
+        if (code == 0) result.push_back(std::move(snapped));
+    }
+    return true;
+}
+
+bool snapClipperPathsToGrid(Configuration &config, clp::Paths &output, clp::Paths &inputs, SnapToGridSpec &snapspec, std::string &err, SnapToGridRecovery *recovery, int numthreads) {
     size_t s = inputs.size();
-    output.resize(s);
-    int numout = 0;
-    /*if debug:
-    otro               = _c.ClipperPaths()
-    otro .thisptr[0].resize(s)*/
-    for (size_t i = 0; i<s; ++i) {
-        int result = snapPathToGrid(output[numout], inputs[i], snapspec, &gridinfo);
-        /*TODO: INSTEAD OF JUST DISCARDING THE PATH WHEN result==1, WE MAY KEEP IT
-        BUT TAGGING IT AS A NON-CONTOUR, AND WE SHOULD TRY TO OFFSET IT TAKING
-        INTO ACCOUNT THAT IT IS AN OPEN PATH*/
-        numout += result == 0;
-        if (result>1) {
+    //paths are snapped independently, and compacted in order afterwards
+    clp::Paths snapped(s);
+    std::vector<int> results(s);
+    parallelFor(s, numthreads, [&inputs, &snapped, &results, &snapspec](size_t i, int) {
+        results[i] = snapPathToGrid(snapped[i], inputs[i], snapspec, NULL);
+    });
+
+    /*TODO: INSTEAD OF JUST DISCARDING THE PATH WHEN result==1, WE MAY KEEP IT
+    BUT TAGGING IT AS A NON-CONTOUR, AND WE SHOULD TRY TO OFFSET IT TAKING
+    INTO ACCOUNT THAT IT IS AN OPEN PATH*/
+    size_t numout = 0;
+    for (size_t i = 0; i < s; ++i) {
+        int result = results[i];
+        if (result <= 1) {
+            numout += result == 0;
+            continue;
+        }
+        if (recovery == NULL) {
+            //snap it again to get the information about the error
+            gridInfo gridinfo;
+            clp::Path dummy;
+            snapPathToGrid(dummy, inputs[i], snapspec, &gridinfo);
 #ifdef CORELIB_USEPYTHON
             showError(config, snapspec, i, inputs[i], gridinfo, result);
 #endif
@@ -502,7 +550,25 @@ bool snapClipperPathsToGrid(Configuration &config, clp::Paths &output, clp::Path
             err = fmt.str();
             return false;
         }
+        if (result <= SNAP_MAX_ERRORCODE) ++recovery->numErrorsByCode[result];
+        numout += 1;
+    }
+
+    output.clear();
+    output.reserve(numout);
+    clp::Paths resnapped;
+    for (size_t i = 0; i < s; ++i) {
+        if (results[i] == 0) {
+            output.push_back(std::move(snapped[i]));
+        } else if (results[i] > 1) {
+            if ((recovery->offset != NULL) && snapPathAfterOpening(inputs[i], snapspec, *recovery, resnapped)) {
+                ++recovery->numResnapped;
+                for (auto &path : resnapped) output.push_back(std::move(path));
+            } else {
+                ++recovery->numUnsnapped;
+                output.push_back(inputs[i]);
+            }
+        }
     }
-    output.resize(numout);
     return true;
 }
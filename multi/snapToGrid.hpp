@@ -30,8 +30,27 @@ typedef struct {
   size_t               numPoint;
 } gridInfo;
 
-//sophisticated function: do snapping while dilating/eroding and simplifying the contours
-bool snapClipperPathsToGrid(Configuration &config, clp::Paths &output, clp::Paths &inputs, SnapToGridSpec &snapspec, std::string &err);
+#define SNAP_MAX_ERRORCODE 7
+
+/*if provided to snapClipperPathsToGrid(), paths which cannot be snapped do not abort the operation. Instead,
+they are snapped again after a small opening (if offset is not NULL), and if that also fails, they are kept unsnapped*/
+typedef struct SnapToGridRecovery {
+    clp::ClipperOffset *offset;
+    double openingRadius;
+    size_t numErrorsByCode[SNAP_MAX_ERRORCODE + 1]; //number of failed paths for each error code of snapPathToGrid() (codes 0 and 1 are not errors)
+    size_t numResnapped; //failed paths successfully snapped after the opening
+    size_t numUnsnapped; //failed paths kept unsnapped
+    SnapToGridRecovery(clp::ClipperOffset *_offset = NULL, double _openingRadius = 0.0) : offset(_offset), openingRadius(_openingRadius) { clearCounters(); }
+    void clearCounters();
+    size_t numFailed() { return numResnapped + numUnsnapped; }
+    std::string countersToString();
+} SnapToGridRecovery;
+
+/*sophisticated function: do snapping while dilating/eroding and simplifying the contours. If recovery is NULL, the
+first path that cannot be snapped aborts the operation. The paths are processed in numthreads threads (<=0 means as
+many as hardware threads), but the result is always the same as in the serial case. The recovery's offset is always
+used in the calling thread*/
+bool snapClipperPathsToGrid(Configuration &config, clp::Paths &output, clp::Paths &inputs, SnapToGridSpec &snapspec, std::string &err, SnapToGridRecovery *recovery = NULL, int numthreads = 1);
 
 //unsophisticated version, suitable for open, very short, slightly processed toolpaths (ignores spec.mode: always works as if it is SnapSimple)
 void simpleSnapPathsToGrid(ClipperLib::Paths &paths, SnapToGridSpec &spec);
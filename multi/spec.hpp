@@ -10,7 +10,7 @@
 GLOBAL PARAMETERS
 *********************************************************/
 
-enum SchedulerMode { SimpleScheduler, UniformScheduling, ManualScheduling };
+enum SchedulerMode { SimpleScheduler, UniformScheduling, ManualScheduling, AdaptiveScheduling };
 
 typedef struct FeedbackSpec {
     bool feedback;
@@ -55,8 +55,12 @@ typedef struct GlobalSpec {
     bool applyMotionPlanner;
     bool avoidVerticalOverwriting;
     bool correct; //this is to correct the contour orientations (not needed if the input is from slic3r's adapted code)
+    bool snapStrict; //if true, a path that cannot be snapped to the grid is an error. Otherwise, snapClipperPathsToGrid() tries to recover
+    int snapThreads; //number of threads for snapClipperPathsToGrid() (<=0 means as many as hardware threads)
     std::vector < ZNTool > schedSpec; //this is for manual specification of slices
     std::vector<int> schedTools; //this is for manual selection of tools for scheduling slices
+    double adaptiveThreshold; //adaptive scheduling: maximum relative change (area of the change of the material added by a tool over the area of that material) between probe slices for the tool to be thinned out
+    double adaptiveStep; //adaptive scheduling: Z step between probe slices (capped to the smallest slice height of the thinned tools, which is also used if it is not positive)
     clp::cInt limitX, limitY;
     bool use_z_base;
     double z_base; //when scheduling mode is uniform: if this parameter is not NaN, it represents the position of the first slice
@@ -7,8 +7,10 @@
 #include "pathsfile.hpp"
 #include "parsing.hpp"
 #include "3d.hpp"
+#include "parallel.hpp"
 #include <string.h>
 static_assert(sizeof(coord_type) == sizeof(clp::cInt), "please correct interface.h so typedef coord_type resolves to the same type as typedef ClipperLib::cInt");
+static_assert(sizeof(clp::IntPoint) == 2 * sizeof(clp::cInt), "the paths are copied from/to flat coordinate arrays with memcpy, so ClipperLib::IntPoint must be just two ClipperLib::cInt values");
 
 /////////////////////////////////////////////////
 //SHARED LIBRARY INTERFACE
@@ -46,6 +48,8 @@ typedef struct SharedLibraryState : public HasError {
     std::vector<clp::cInt> processRadiuses;
     std::shared_ptr<SimpleSlicingScheduler> sched;
     std::shared_ptr<Multislicer> multi;
+    //one Multislicer for each thread in computeResultsBatch() (the first one is multi), kept alive to reuse their arenas across calls
+    std::vector<std::shared_ptr<Multislicer>> batchMultis;
     SharedLibraryState(std::shared_ptr<Configuration> _config) : config(std::move(_config)) { spec = std::make_shared<MultiSpec>(config); }
 } SharedLibraryState;
 
@@ -236,12 +240,9 @@ LIBRARY_API  clp::cInt** getPathsArray(SharedLibrarySlice* slice) {
 }
 
 
-LIBRARY_API  ResultsHandle computeResult(SharedLibrarySlice* slice, StateHandle state) {
+void computeResultWith(Multislicer &multi, size_t numspecs, clp::Paths &paths, SharedLibraryResult *result) {
     clp::Paths dummy;
-    size_t numspecs = state->spec->numspecs;
-    SharedLibraryResult * result = new SharedLibraryResult(numspecs);
-
-    if (slice->paths->size() > 0) {
+    if (paths.size() > 0) {
         //this is a very ugly hack to compromise between part of the code requiring vector<shared_ptr<T>>
         //because of convoluted co-ownership requirements and other part happily using vector<T>
         std::vector<SingleProcessOutput*> ress(result->res.size());
@@ -251,7 +252,7 @@ LIBRARY_API  ResultsHandle computeResult(SharedLibrarySlice* slice, StateHandle
         }
 
         try {
-            int lastk = state->multi->applyProcesses(ress, *slice->paths, dummy);
+            int lastk = multi.applyProcesses(ress, paths, dummy);
             if (lastk != numspecs) {
                 result->err = result->res[lastk]->err;
             }
@@ -262,9 +263,13 @@ LIBRARY_API  ResultsHandle computeResult(SharedLibrarySlice* slice, StateHandle
         }
 
     }
+}
 
+LIBRARY_API  ResultsHandle computeResult(SharedLibrarySlice* slice, StateHandle state) {
+    size_t numspecs = state->spec->numspecs;
+    SharedLibraryResult * result = new SharedLibraryResult(numspecs);
+    computeResultWith(*state->multi, numspecs, *slice->paths, result);
     return result;
-
 }
 
 LIBRARY_API  void freeInputSlice(SharedLibrarySlice* slice) {
@@ -328,6 +333,161 @@ LIBRARY_API  void freeResult(SharedLibraryResult* result) {
     if (result != NULL) delete result;
 }
 
+//structure to hold the paths of a result packed in a single buffer
+typedef struct SharedLibraryFlatPaths : public HasError {
+    std::vector<long long> offsets;
+    std::vector<clp::cInt> coords;
+} SharedLibraryFlatPaths;
+
+/*copy the coordinates of the paths, one after the other, directly into the output buffer. The paths are not
+contiguous, so this is one copy per path, but the coordinates are copied just once. Returns the end of the written data*/
+static clp::cInt *packPaths(clp::Paths &paths, clp::cInt *coords) {
+    for (auto &path : paths) {
+        if (!path.empty()) memcpy(coords, (const void*)path.data(), path.size() * 2 * sizeof(clp::cInt));
+        coords += path.size() * 2;
+    }
+    return coords;
+}
+
+LIBRARY_API FlatOutputSliceInfo getFlatOutputSliceInfo(SharedLibraryResult* result, int ntool, OutputSliceInfo_PathType pathtype) {
+    clp::Paths * paths = getDesiredPaths(result, ntool, pathtype);
+    SharedLibraryFlatPaths *flat = new SharedLibraryFlatPaths();
+
+    flat->offsets.resize(paths->size() + 1);
+    flat->offsets[0] = 0;
+    for (size_t k = 0; k < paths->size(); ++k) {
+        flat->offsets[k + 1] = flat->offsets[k] + 2 * (long long)(*paths)[k].size();
+    }
+    //make sure that coords.data() is never NULL, even if there are no paths
+    flat->coords.resize((size_t)(std::max)(flat->offsets.back(), 1LL));
+    packPaths(*paths, &flat->coords.front());
+
+    FlatOutputSliceInfo out;
+    out.flatpaths    = flat;
+    out.numpaths     = (int)paths->size();
+    out.offsetsArray = &flat->offsets.front();
+    out.coordsArray  = &flat->coords.front();
+    out.ntool        = result->ntool;
+    out.z            = result->z;
+    return out;
+}
+
+LIBRARY_API  void freeFlatPaths(SharedLibraryFlatPaths* flatpaths) {
+    if (flatpaths != NULL) delete flatpaths;
+}
+
+typedef struct SharedLibraryBatch : public HasError {
+    std::vector<std::shared_ptr<SharedLibraryResult>> results;
+} SharedLibraryBatch;
+
+LIBRARY_API  BatchHandle computeResultsBatch(StateHandle state, BatchInputInfo input, int numthreads) {
+    SharedLibraryBatch *batch = new SharedLibraryBatch();
+    if (!state->multi) {
+        batch->err = "Cannot use computeResultsBatch if the scheduler was configured in the arguments!!!!";
+        return batch;
+    }
+    if (input.numslices <= 0) return batch;
+
+    size_t numslices = input.numslices;
+    size_t numspecs  = state->spec->numspecs;
+    batch->results.resize(numslices);
+
+    //offsets of each slice in the input buffers, so the slices can be unpacked independently
+    std::vector<size_t> pathOffsets(numslices + 1), coordOffsets(numslices + 1);
+    pathOffsets[0] = coordOffsets[0] = 0;
+    for (size_t n = 0; n < numslices; ++n) {
+        pathOffsets[n + 1] = pathOffsets[n] + input.numpathsArray[n];
+        size_t numcoords = 0;
+        for (size_t p = pathOffsets[n]; p < pathOffsets[n + 1]; ++p) {
+            numcoords += 2 * (size_t)input.numpointsArray[p];
+        }
+        coordOffsets[n + 1] = coordOffsets[n] + numcoords;
+    }
+
+    numthreads = getNumThreads(numthreads, numslices);
+    if (state->batchMultis.empty()) state->batchMultis.push_back(state->multi);
+    while (state->batchMultis.size() < (size_t)numthreads) {
+        state->batchMultis.push_back(std::make_shared<Multislicer>(std::make_shared<ClippingResources>(state->spec)));
+    }
+
+    //all results are allocated in advance (and empty), so they are valid even if the computation of some slices fails
+    for (auto &result : batch->results) {
+        result = std::make_shared<SharedLibraryResult>(numspecs);
+        for (auto &res : result->res) res = std::make_shared<ResultSingleTool>();
+    }
+
+    try {
+        parallelFor(numslices, numthreads, [state, batch, &input, &pathOffsets, &coordOffsets, numspecs](size_t n, int numthread) {
+            SharedLibraryResult *result = batch->results[n].get();
+            try {
+                clp::Paths paths(pathOffsets[n + 1] - pathOffsets[n]);
+                const clp::cInt *coords = input.coordsArray + coordOffsets[n];
+                for (size_t p = 0; p < paths.size(); ++p) {
+                    size_t numpoints = input.numpointsArray[pathOffsets[n] + p];
+                    paths[p].resize(numpoints);
+                    if (numpoints > 0) memcpy((void*)paths[p].data(), coords, numpoints * 2 * sizeof(clp::cInt));
+                    coords += numpoints * 2;
+                }
+                computeResultWith(*state->batchMultis[numthread], numspecs, paths, result);
+            } catch (std::exception &e) {
+                result->err = str("Unhandled exception: ", e.what());
+            } catch (...) {
+                result->err = "Unhandled exception";
+            }
+        });
+    } catch (std::exception &e) {
+        batch->err = str("Unhandled exception: ", e.what());
+        return batch;
+    }
+
+    for (size_t n = 0; n < numslices; ++n) {
+        if (!batch->results[n]->err.empty()) {
+            batch->err = str("Error in slice ", n, ": ", batch->results[n]->err);
+            break;
+        }
+    }
+
+    return batch;
+}
+
+LIBRARY_API  ResultsHandle getBatchResult(BatchHandle batch, int nslice) {
+    return batch->results[nslice].get();
+}
+
+LIBRARY_API  BatchOutputSizes getBatchOutputSizes(BatchHandle batch, int ntool, OutputSliceInfo_PathType pathtype, int *numpathsArray) {
+    BatchOutputSizes sizes;
+    sizes.numpaths  = 0;
+    sizes.numcoords = 0;
+    if (!batch->err.empty()) {
+        for (size_t n = 0; n < batch->results.size(); ++n) numpathsArray[n] = 0;
+        return sizes;
+    }
+    for (size_t n = 0; n < batch->results.size(); ++n) {
+        clp::Paths * paths = getDesiredPaths(batch->results[n].get(), ntool, pathtype);
+        numpathsArray[n] = (int)paths->size();
+        sizes.numpaths  += (int)paths->size();
+        for (auto &path : *paths) {
+            sizes.numcoords += 2 * (long long)path.size();
+        }
+    }
+    return sizes;
+}
+
+LIBRARY_API  void copyBatchOutput(BatchHandle batch, int ntool, OutputSliceInfo_PathType pathtype, int *numpointsArray, coord_type *coordsArray) {
+    if (!batch->err.empty()) return;
+    for (auto &result : batch->results) {
+        clp::Paths * paths = getDesiredPaths(result.get(), ntool, pathtype);
+        for (auto &path : *paths) {
+            *(numpointsArray++) = (int)path.size();
+        }
+        coordsArray = packPaths(*paths, coordsArray);
+    }
+}
+
+LIBRARY_API  void freeBatch(BatchHandle batch) {
+    if (batch != NULL) delete batch;
+}
+
 void voidSlices3DSpecInfo(Slices3DSpecInfo &info) {
     info.numinputslices = info.numoutputslices = -1;
     info.zs = NULL;
@@ -340,6 +500,11 @@ LIBRARY_API Slices3DSpecInfo computeSlicesZs(StateHandle state, double zmin, dou
         voidSlices3DSpecInfo(ret);
         return ret;
     }
+    if (state->spec->global.schedMode == AdaptiveScheduling) {
+        state->err = "The adaptive scheduler requires slicing the mesh, so it is only available in the standalone application!!!!";
+        voidSlices3DSpecInfo(ret);
+        return ret;
+    }
     state->sched->createSlicingSchedule(zmin, zmax, state->spec->global.z_epsilon, ScheduleSimple);
     if (state->sched->has_err) {
         state->err = state->sched->err;
@@ -55,6 +55,8 @@ struct SharedLibraryState;    typedef SharedLibraryState    *      StateHandle;
 struct SharedLibrarySlice;    typedef SharedLibrarySlice    * InputSliceHandle;
 struct SharedLibraryResult;   typedef SharedLibraryResult   *    ResultsHandle;
 struct SharedLibraryPaths;    typedef SharedLibraryPaths    *      PathsHandle;
+struct SharedLibraryBatch;    typedef SharedLibraryBatch    *      BatchHandle;
+struct SharedLibraryFlatPaths; typedef SharedLibraryFlatPaths *  FlatPathsHandle;
 
 typedef struct Slices3DSpecInfo {
     int numinputslices;
@@ -75,6 +77,32 @@ typedef struct OutputSliceInfo {
     int ntool;
 } OutputSliceInfo;
 
+/*input for computeResultsBatch(): all the slices are laid out contiguously, slice after slice and path after path.
+The coordinates are X,Y pairs, so the size of coordsArray is 2*sum(numpointsArray)*/
+typedef struct BatchInputInfo {
+    int numslices;
+    int *numpathsArray;    //numslices elements: number of paths in each slice
+    int *numpointsArray;   //sum(numpathsArray) elements: number of points in each path
+    coord_type *coordsArray;
+} BatchInputInfo;
+
+//sizes of the output buffers required by copyBatchOutput()
+typedef struct BatchOutputSizes {
+    int numpaths;          //size of the numpointsArray buffer
+    long long numcoords;   //size of the coordsArray buffer (2 per point)
+} BatchOutputSizes;
+
+/*alternative to OutputSliceInfo, with all paths packed in a single buffer: path k is made of
+the X,Y coordinates from coordsArray[offsetsArray[k]] to coordsArray[offsetsArray[k+1]-1]*/
+typedef struct FlatOutputSliceInfo {
+    FlatPathsHandle flatpaths;
+    int numpaths;
+    long long *offsetsArray; //numpaths+1 elements
+    coord_type *coordsArray;
+    double z;
+    int ntool;
+} FlatOutputSliceInfo;
+
 typedef struct LoadPathInfo {
     int numpaths;
     int *numpointsArray;
@@ -150,12 +178,35 @@ extern "C" {
 
     LIBRARY_API  void freeResult(ResultsHandle result);
 
+    //the returned buffers are independent of the result (it can be freed before them), and are released with freeFlatPaths()
+    LIBRARY_API FlatOutputSliceInfo getFlatOutputSliceInfo(ResultsHandle result, int ntool, OutputSliceInfo_PathType pathtype);
+
+    LIBRARY_API  void freeFlatPaths(FlatPathsHandle flatpaths);
+
     LIBRARY_API  int alsoComplementary(ResultsHandle result, int ntool);
 
     // 2D FUNCTIONS
 
     LIBRARY_API  ResultsHandle computeResult(InputSliceHandle slice, StateHandle state);
 
+    // 2D BATCH FUNCTIONS (many slices computed in parallel in a single call. Not available if the scheduler is used)
+
+    //numthreads<=0 means as many threads as hardware threads. Errors for the whole batch can be queried from the BatchHandle
+    LIBRARY_API  BatchHandle computeResultsBatch(StateHandle state, BatchInputInfo input, int numthreads);
+
+    //the returned ResultsHandle is owned by the batch: do not free it! Errors for each slice can be queried from it
+    LIBRARY_API  ResultsHandle getBatchResult(BatchHandle batch, int nslice);
+
+    /*fills numpathsArray (numslices elements, preallocated by the caller) with the number of paths in each slice
+    for the requested tool and path type, and returns the sizes of the buffers required by copyBatchOutput()*/
+    LIBRARY_API  BatchOutputSizes getBatchOutputSizes(BatchHandle batch, int ntool, OutputSliceInfo_PathType pathtype, int *numpathsArray);
+
+    //copies the paths of all slices (in the same layout as BatchInputInfo) into buffers preallocated by the caller.
+    //If the batch has an error, these two functions return no paths (each slice's result is still valid, and has its own error)
+    LIBRARY_API  void copyBatchOutput(BatchHandle batch, int ntool, OutputSliceInfo_PathType pathtype, int *numpointsArray, coord_type *coordsArray);
+
+    LIBRARY_API  void freeBatch(BatchHandle batch);
+
     // 3D SCHEDULING FUNCTIONS (to do the optimal and right thing, the output interface should be different from the 2D case, but we reuse it to save LOCs)
 
     LIBRARY_API Slices3DSpecInfo computeSlicesZs(StateHandle state, double zmin, double zmax);
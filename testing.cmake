@@ -423,6 +423,34 @@ ${MINI_SCHED1}
   --medialaxis-radius 0.5 --infill linesh"
 SNAPTHIN)
 
+#same computation as mini_3d_infilling_addsub_nosnap, but the output file is written in a background thread
+set(TESTNAME mini_3d_asyncwrite)
+TEST_MULTIRES(${TESTNAME} execmini "put_mini;mini_3d_infilling_addsub_nosnap" "${TEST_DIR}/mini.stl"
+"--load \"${TEST_DIR}/mini.stl\" --save \"${TEST_DIR}/${TESTNAME}.paths\" --async-write 2
+${SCHED} --addsub
+${MINI_SCHED0}
+  --medialaxis-radius 0.1 0.05 --infill linesh
+${MINI_SCHED1}
+  --medialaxis-radius 0.5 --infill linesh")
+TEST_COMPARE(${TESTNAME}_compare execmini ${TESTNAME} "${TEST_DIR}/mini_3d_infilling_addsub_nosnap.paths" "${TEST_DIR}/${TESTNAME}.paths")
+
+#the estimated time varies from run to run, so only the execution is tested, not the output
+set(TESTNAME mini_3d_estimatecost)
+TEST_MULTIRES(${TESTNAME} execmini ${MINISTL}
+"--load \"${TEST_DIR}/mini.stl\" --estimate-cost 2
+${SCHED}
+${MINI_SCHED0}
+${MINI_SCHED1}")
+
+#the salient features are small and change in Z, while the body they are attached to does not: the slices of
+#process 1 have to be kept where the features are, and thinned out only along the vertical walls of the body
+set(TESTNAME mini_3d_adaptive)
+TEST_MULTIRES_COMPARE("" ${TESTNAME} ${MINILABELS} ${MINISALIENTSTL}
+"--load \"${TEST_DIR}/mini.salient.stl\" --save \"${TEST_DIR}/${TESTNAME}.paths\"
+--slicing-adaptive --slicing-adaptive-threshold 0.02 --save-contours --motion-planner
+${MINI_SCHED0}
+${MINI_SCHED1}")
+
 
 
 
@@ -438,10 +466,12 @@ SNAPTHIN)
 #another style of testing to validate them, even taking into account the comparison tests.
 #
 #flags not tested:
-#  standalone.cpp: --pp-save-in-grid --help --config --save-format --checkpoint-save-every --show --dry-run --dxf-toolpaths --dxf-separate-toolpaths --dxf-by-z
-#  parsing.cpp: --correct-input --z-epsilon
+#  standalone.cpp: --pp-save-in-grid --help --config --save-format --checkpoint-save-every --show --dry-run --dxf-toolpaths --dxf-separate-toolpaths --dxf-by-z --daemon
+#  parsing.cpp: --correct-input --z-epsilon --snap-strict --snap-threads --slicing-adaptive-step
 #  parsing.cpp, nanoscribe section: --nano-by-tool --nano-by-z --nano-file-begin --pp-nano-file-begin --pp-nano-file-afterbegin --pp-nano-file-afterfirstzchange --nano-file-end --pp-nano-file-end --pp-nano-global-file-begin --nano-global-file-end --pp-nano-global-file-end --nano-perimeters-begin --pp-nano-perimeters-begin --nano-perimeters-end --pp-nano-perimeters-end --nano-surfaces-begin --pp-nano-surfaces-begin --nano-surfaces-end --pp-nano-surfaces-end --nano-infillings-begin --pp-nano-infillings-begin --nano-infillings-end --pp-nano-infillings-end --pp-nano-scanmode --nano-galvocenter --pp-nano-galvocenter --pp-nano-angle --pp-nano-spacing --pp-nano-margin --pp-nano-maxsquarelen --pp-nano-origin --pp-nano-gridstep
 #  parsing.cpp, infill section: --infill-maxconcentric --surface-infill-maxconcentric --surface-infill-lineoverlap --surface-infill-byregion --surface-infill-static-mode --surface-infill-medialaxis-radius 
+#  svg.cpp (svgconv): raster output (pgm, png) and its options aa, evenodd, threads
+#  splitter.cpp (splitterp): threads
   
 
 set(FULLLABELS execfull compfull)
@@ -768,6 +798,51 @@ ${SCHED} --slicing-zbase 0 --slicing-direction down
 ${SNAPTHIN}")
 
 
+###########################################################
+###### TEST CASES FOR THE EXTERNAL SLICER PROTOCOL
+###########################################################
+
+#these tests use stubslicer instead of Slic3r, to test both the classic and the streaming protocols of the external slicer.
+#They use their own configuration files: the keys written first take precedence over the ones from the template
+PREPARE_COMMAND_NAME(stubslicer)
+FILE(READ "${CMAKE_CURRENT_SOURCE_DIR}/config.template.txt" STUBCONFIGTEMPLATE)
+string(CONFIGURE "${STUBCONFIGTEMPLATE}" STUBCONFIGTEMPLATE)
+FOREACH(STREAMING 0 3)
+  FILE(WRITE "${TEST_DIR}/config.stubslicer.${STREAMING}.txt"
+"SLICER_PATH      : ${OUTPUTDIR} ;
+SLICER_EXEC      : ${stubslicer} ;
+SLICER_STREAMING : ${STREAMING} ;
+${STUBCONFIGTEMPLATE}")
+ENDFOREACH()
+
+set(TESTNAME mini_3d_stubslicer)
+set(COMMONARGS
+"${SCHED}
+${MINI_SCHED0}
+  ${CLRNCE}
+${MINI_SCHED1}
+  ${CLRNCE}")
+TEST_MULTIRES(${TESTNAME}_classic execmini ${MINISTL}
+"--config \"${TEST_DIR}/config.stubslicer.0.txt\" --load \"${TEST_DIR}/mini.stl\" --save \"${TEST_DIR}/${TESTNAME}_classic.paths\"
+${COMMONARGS}")
+TEST_EXISTS(EXISTS_RESULT_${TESTNAME}_classic execmini ${TESTNAME}_classic "${TEST_DIR}/${TESTNAME}_classic.paths")
+TEST_MULTIRES(${TESTNAME}_streaming execmini ${MINISTL}
+"--config \"${TEST_DIR}/config.stubslicer.3.txt\" --load \"${TEST_DIR}/mini.stl\" --save \"${TEST_DIR}/${TESTNAME}_streaming.paths\"
+${COMMONARGS}")
+TEST_EXISTS(EXISTS_RESULT_${TESTNAME}_streaming execmini ${TESTNAME}_streaming "${TEST_DIR}/${TESTNAME}_streaming.paths")
+#both protocols must give the same slices
+TEST_COMPARE(${TESTNAME}_compare_streaming execmini "${TESTNAME}_classic;${TESTNAME}_streaming" "${TEST_DIR}/${TESTNAME}_classic.paths" "${TEST_DIR}/${TESTNAME}_streaming.paths")
+#in streaming mode, the slices before the checkpoint are skipped, and the ones after it are cancelled, so they are never sliced
+TEST_MULTIRES(${TESTNAME}_streaming_save_checkpoint execmini ${MINISTL}
+"--config \"${TEST_DIR}/config.stubslicer.3.txt\" --load \"${TEST_DIR}/mini.stl\" --save \"${TEST_DIR}/${TESTNAME}_streaming_checkpoint.paths\" --checkpoint-save \"${TEST_DIR}/${TESTNAME}.checkpoint\" 2
+${COMMONARGS}")
+TEST_EXISTS(EXISTS_RESULT_${TESTNAME}_streaming_save_checkpoint execmini ${TESTNAME}_streaming_save_checkpoint "${TEST_DIR}/${TESTNAME}.checkpoint")
+TEST_MULTIRES(${TESTNAME}_streaming_load_checkpoint execmini ${TESTNAME}_streaming_save_checkpoint "${TEST_DIR}/mini.stl;${TEST_DIR}/${TESTNAME}.checkpoint"
+"--config \"${TEST_DIR}/config.stubslicer.3.txt\" --load \"${TEST_DIR}/mini.stl\" --save \"${TEST_DIR}/${TESTNAME}_streaming_checkpoint.paths\" --checkpoint-load \"${TEST_DIR}/${TESTNAME}.checkpoint\"
+${COMMONARGS}")
+TEST_COMPARE(${TESTNAME}_streaming_comparecheckpoint execmini "${TESTNAME}_streaming;${TESTNAME}_streaming_load_checkpoint" "${TEST_DIR}/${TESTNAME}_streaming.paths" "${TEST_DIR}/${TESTNAME}_streaming_checkpoint.paths")
+
+
 ###########################################################
 ###### TEST CASES FOR GENERATING GWL OUTPUT (FOR NANOSCRIBE 3D PRINTERS)
 ###########################################################